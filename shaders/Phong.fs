@@ -1,4 +1,5 @@
 #version 460 core
+#extension GL_ARB_bindless_texture : enable
 
 /* final output */
 out vec4 FragColor;
@@ -10,56 +11,68 @@ in vec2 fTex;
 in vec2 fTex_2;
 in vec2 fTex_3;
 
-/* basic uniforms */
-uniform float alphaCutoff;
-
-/* camera */
-struct Camera 
+/* camera, shared by every program (FrameUniforms) */
+layout (std140, binding = 1) uniform CameraBlock
 {
+  mat4 view;
+  mat4 projection;
+  mat4 projView;
+  vec3 position;
   float minZ;
   float maxZ;
-  vec3 position;
-};
-uniform Camera camera;
+} camera;
 
-/* materials */
-struct PhongMaterial 
+/* materials, one block per material (Material::MATERIAL_BINDING) */
+layout (std140, binding = 3) uniform PhongMaterialBlock
 {
   /* colors */
   vec4 ambient;
   vec4 diffuse;
   vec4 specular;
 
-  /* textures */
+  /* uv channel of each texture, -1 if there's no texture */
   int ambientUVIndex;
-  sampler2D ambientTex;
-
   int diffuseUVIndex;
-  sampler2D diffuseTex;
-  
   int specularUVIndex;
-  sampler2D specularTex;
-  
+
   /* others */
   int shininess;
-};
-uniform PhongMaterial phongMaterial;
+  float alphaCutoff;
+
+  /* textures: bindless handles, or (array, layer) in textureArrays when the handle is 0 (TextureTable) */
+  uvec2 ambientHandle;
+  uvec2 diffuseHandle;
+  uvec2 specularHandle;
+  ivec2 ambientLayer;
+  ivec2 diffuseLayer;
+  ivec2 specularLayer;
+} phongMaterial;
+
+/* fallback for drivers without bindless textures: same size textures share an array (TextureTable::ARRAY_UNIT) */
+#define MAX_TEXTURE_ARRAYS 16
+layout (binding = 16) uniform sampler2DArray textureArrays[MAX_TEXTURE_ARRAYS];
+
+vec4 sampleMaterialTexture(uvec2 handle, ivec2 arrayLayer, vec2 texCoord)
+{
+#ifdef GL_ARB_bindless_texture
+  if (handle != uvec2(0))
+    return texture(sampler2D(handle), texCoord);
+#endif
+  return texture(textureArrays[arrayLayer.x], vec3(texCoord, arrayLayer.y));
+}
 
-/* lights */
+/* lights, shared by every program (FrameUniforms). std140: every float fills up the vec3 before it */
 #define NR_POINT_LIGHTS 4
 struct PointLight
 {
   vec3 position;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-
   float constant;
+  vec3 ambient;
   float linear;
+  vec3 diffuse;
   float quadratic;
+  vec3 specular;
 };
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-
 
 #define NR_DIR_LIGHTS 4
 struct DirLight 
@@ -69,7 +82,14 @@ struct DirLight
   vec3 diffuse;
   vec3 specular;
 };
-uniform DirLight dirLights[NR_DIR_LIGHTS];
+
+layout (std140, binding = 2) uniform LightBlock
+{
+  PointLight pointLights[NR_POINT_LIGHTS];
+  DirLight dirLights[NR_DIR_LIGHTS];
+  int numPointLights;
+  int numDirLights;
+};
 
 /* custom structs to pass around data */
 struct LightOutput 
@@ -140,7 +160,7 @@ void main()
   if (phongMaterial.diffuseUVIndex != -1) 
   {
     vec2 diffuseTexCoord = fTex;
-    vec4 texDiffuse = texture(phongMaterial.diffuseTex, diffuseTexCoord);
+    vec4 texDiffuse = sampleMaterialTexture(phongMaterial.diffuseHandle, phongMaterial.diffuseLayer, diffuseTexCoord);
     matDiffuse *= texDiffuse.xyz;
     alpha *= texDiffuse.w;
   }
@@ -148,18 +168,18 @@ void main()
   if (phongMaterial.specularUVIndex != -1) 
   {
     vec2 specularTexCoord = fTex;
-    vec4 texSpecular = texture(phongMaterial.specularTex, specularTexCoord);
+    vec4 texSpecular = sampleMaterialTexture(phongMaterial.specularHandle, phongMaterial.specularLayer, specularTexCoord);
     matSpecular *= texSpecular.xyz;
   }
   
   if (phongMaterial.ambientUVIndex != -1) 
   {
     vec2 ambientTexCoord  = fTex;
-    vec4 texAmbient = texture(phongMaterial.ambientTex, ambientTexCoord);
+    vec4 texAmbient = sampleMaterialTexture(phongMaterial.ambientHandle, phongMaterial.ambientLayer, ambientTexCoord);
     matAmbient *= texAmbient.xyz;
   }
 
-  if (alpha < alphaCutoff) 
+  if (alpha < phongMaterial.alphaCutoff) 
   {
     discard;
   }
@@ -168,7 +188,7 @@ void main()
   vec3 viewDir = normalize(surfaceToCamera);
   LightOutput total = { vec3(0), vec3(0), vec3(0) };
   
-  for (int i = 0; i < NR_POINT_LIGHTS; i++)
+  for (int i = 0; i < numPointLights; i++)
   {
     LightOutput o = CalcPointLight(pointLights[i], fNormal, fPos, viewDir);
     total.ambient += o.ambient;
@@ -176,7 +196,7 @@ void main()
     total.specular += o.specular;
   }
 
-  for (int i = 0; i < NR_DIR_LIGHTS; i++)
+  for (int i = 0; i < numDirLights; i++)
   {
     LightOutput o = CalcDirLight(dirLights[i], fNormal, viewDir);
     total.ambient += o.ambient;
@@ -1,5 +1,7 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
+
+// octahedral (only xy used) in quantized layouts, see octDecode
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTex;
 layout (location = 3) in vec3 aTangent;
@@ -26,26 +28,83 @@ uniform mat3 normalMat;
 // projectionMat * viewMat * modelMat
 uniform mat4 projViewModelMat;
 
-#define MAX_BONE_MATRICES 96
-uniform mat4 boneMatrices[MAX_BONE_MATRICES];
+// bone palettes, back to back. Immediate draws use the one at 0 when useBoneMatrices is set
+layout (std430, binding = 1) readonly buffer BoneBuffer
+{
+  mat4 bones[];
+};
 uniform int useBoneMatrices;
 
+// draws from the render queue read their matrices from here instead, at gl_BaseInstance + gl_InstanceID
+struct InstanceData
+{
+  mat4 projViewModelMat;
+  mat4 modelMat;
+  mat3 normalMat;
+
+  // first bone of the draw's palette, -1 if not skinned
+  int boneOffset;
+
+  // 1 if the mesh is in a quantized vertex layout
+  int quantizedVertices;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceBuffer
+{
+  InstanceData instances[];
+};
+
+uniform int useInstancing;
+
+// immediate draws of meshes in a quantized vertex layout
+uniform int useQuantizedVertices;
+
+// unfold a unit vector stored on an octahedron
+vec3 octDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main()
 {
+  mat4 model = modelMat;
+  mat3 normal = normalMat;
+  mat4 projViewModel = projViewModelMat;
+  int boneOffset = useBoneMatrices == 1 ? 0 : -1;
+  int quantized = useQuantizedVertices;
+
+  if (useInstancing == 1)
+  {
+    InstanceData instance = instances[gl_BaseInstance + gl_InstanceID];
+    model = instance.modelMat;
+    normal = instance.normalMat;
+    projViewModel = instance.projViewModelMat;
+    boneOffset = instance.boneOffset;
+    quantized = instance.quantizedVertices;
+  }
+
   mat4 skinMat = mat4(1.f);
 
-  if (useBoneMatrices == 1)
+  if (boneOffset >= 0)
   {
-    skinMat = aWeight.x * boneMatrices[aJoint.x]
-            + aWeight.y * boneMatrices[aJoint.y]
-            + aWeight.z * boneMatrices[aJoint.z]
-            + aWeight.w * boneMatrices[aJoint.w];
+    // unorm8 weights don't quite add up to 1 anymore
+    vec4 weight = aWeight / max(dot(aWeight, vec4(1.0)), 1e-4);
+    skinMat = weight.x * bones[boneOffset + aJoint.x]
+            + weight.y * bones[boneOffset + aJoint.y]
+            + weight.z * bones[boneOffset + aJoint.z]
+            + weight.w * bones[boneOffset + aJoint.w];
   }
 
-  gl_Position = projViewModelMat * skinMat * vec4(aPos, 1.0);
-  fPos = vec3(modelMat * skinMat * vec4(aPos, 1.0));
+  vec3 objectNormal = quantized == 1 ? octDecode(aNormal.xy) : aNormal;
+
+  gl_Position = projViewModel * skinMat * vec4(aPos, 1.0);
+  fPos = vec3(model * skinMat * vec4(aPos, 1.0));
 
-  fNormal = normalize(normalMat * mat3(skinMat) * aNormal);
+  fNormal = normalize(normal * mat3(skinMat) * objectNormal);
 
   fTex = aTex;
   fTex_2 = aTex_2;
@@ -1,9 +1,13 @@
 #include "GameState.h"
+#include "../components/GLStateCache.h"
 
 GameState::GameState(const GameResources& resources)
   : _mResources(resources)
 {
   _mResources.window.addObservable(this);
+  _mScene.setTransformWorkerPool(&_mResources.workerPool);
+  _mScene.setUploadRing(&_mResources.uploadRing);
+  _mScene.setViewportHeight(_mResources.window.getDefaultHeight());
 }
 
 GameState::~GameState()
@@ -36,18 +40,18 @@ void GameState::destroy() {
 
 void GameState::draw() {
   // render to custom window buffer
-  glBindFramebuffer(GL_FRAMEBUFFER, _mResources.window.getFrameBuffer());
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_FRAMEBUFFER_SRGB);
+  GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, _mResources.window.getFrameBuffer());
+  GLStateCache::enable(GL_DEPTH_TEST);
+  GLStateCache::enable(GL_FRAMEBUFFER_SRGB);
 
-  _mScene.prepShaderPrograms(_mResources.shaderProgramManager);
+  _mScene.updateFrameUniforms();
   _onDraw();
   _mScene.draw();
 
   // use default frame buffer
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glDisable(GL_DEPTH_TEST);
-  glDisable(GL_FRAMEBUFFER_SRGB);
+  GLStateCache::bindFramebuffer(GL_FRAMEBUFFER, 0);
+  GLStateCache::disable(GL_DEPTH_TEST);
+  GLStateCache::disable(GL_FRAMEBUFFER_SRGB);
 
   glClearColor(1.f, 1.f, 1.f, 1.f);
   glClear(GL_COLOR_BUFFER_BIT);
@@ -67,4 +71,5 @@ void GameState::onResize(int width, int height)
     screenShader->screenTextureId = _mResources.window.getColorBuffer();
   }
   glViewport(0, 0, width, height);
+  _mScene.setViewportHeight(height);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "TestTriangle.h"
 #include "../utils/Printer.hpp"
+#include "../benchmarks/CloneBenchmark.h"
 
 TestTriangle::TestTriangle(const GameResources& resources)
   : GameState(resources),
@@ -28,7 +29,7 @@ void TestTriangle::_onLoad()
     wallTexPath,
     true
   );
-  mat->specularTex = _mResources.textureManager.insert(wallTexPath, wallTex);
+  mat->setSpecularTex(_mResources.textureManager.insert(wallTexPath, wallTex));
 
   std::string fujiwaraTexPath = "assets/fujiwara.jpg";
   TextureData fujiwaraTex(
@@ -36,9 +37,9 @@ void TestTriangle::_onLoad()
     true
   );
 
-  mat->diffuseTex = _mResources.textureManager.insert(fujiwaraTexPath, fujiwaraTex);
-  mat->ambientTex = mat->diffuseTex;
-  mat->shininess = 64.f;
+  mat->setDiffuseTex(_mResources.textureManager.insert(fujiwaraTexPath, fujiwaraTex));
+  mat->setAmbientTex(mat->getDiffuseTex());
+  mat->setShininess(64);
   _mScene.addChild(model);
   model->setPosition(glm::vec3(0, 0.5f, 0));
 
@@ -60,9 +61,9 @@ void TestTriangle::_onLoad()
   Box* lightBox = new Box(_mResources.primitiveManager, .3f, .3f, .3f, true);
   PhongMaterial* mat = new PhongMaterial(&_mResources.shaderProgramManager);
   lightBox->material = mat;
-  mat->diffuse = glm::vec4(pointLight->diffuse * .3f, 1.f);
-  mat->specular = glm::vec4(pointLight->specular * .1f, 1.f);
-  mat->ambient = glm::vec4(pointLight->ambient * .1f, 1.f);
+  mat->setDiffuse(glm::vec4(pointLight->diffuse * .3f, 1.f));
+  mat->setSpecular(glm::vec4(pointLight->specular * .1f, 1.f));
+  mat->setAmbient(glm::vec4(pointLight->ambient * .1f, 1.f));
   pointLight->addChild(lightBox);
 
   pointLight = new PointLight();
@@ -94,13 +95,14 @@ void TestTriangle::_onLoad()
   // import the hell of this shit!
   importer = new AssetImporter(_mResources, "./assets/BrainStem/BrainStem.gltf");
   importer->load();
+  benchmarkImporter = importer;
   Asset* asset = importer->getOriginal();
   asset->setPosition(glm::vec3(-3, 0, 0));
   asset->forceComputeTransform();
 
   _mScene.addChild(asset);
 
-  if (asset->skeleton->getAnimationCount() > 0)
+  if (asset->getSkeleton()->getAnimationCount() > 0)
   {
     asset->currentAnimationIdx = 0;
     asset->currentAnimationMs = 0;
@@ -114,12 +116,14 @@ void TestTriangle::_onLoad()
   asset->update(0);
 
   importer = new AssetImporter(_mResources, "./assets/miku_gltf/scene.gltf");
+  importer->setQuantizeVertices(true);
   importer->load();
   asset = importer->getOriginal();
   asset->setPosition(glm::vec3(-1.5, 0, 0));
   _mScene.addChild(asset);
 
   importer = new AssetImporter(_mResources, "./assets/sponza/sponza.obj");
+  importer->setQuantizeVertices(true);
   importer->load();
   asset = importer->getOriginal();
   asset->setScale(glm::vec3(0.02f));
@@ -176,7 +180,12 @@ std::string TestTriangle::nextState() const
 }
 
 void TestTriangle::onKey(int key, int scancode, int action, int mods)
-{}
+{
+  if (key == GLFW_KEY_F2 && action == GLFW_PRESS && benchmarkImporter)
+  {
+    runCloneBenchmark(*benchmarkImporter);
+  }
+}
 
 void TestTriangle::onCursorPos(double xPos, double yPos)
 {}
@@ -24,6 +24,9 @@ protected:
 
   AssetImporter* importer = nullptr;
 
+  // glTF asset used by the clone benchmark (F2)
+  AssetImporter* benchmarkImporter = nullptr;
+
   // lights
   std::vector<PointLight*> pointLights;
   std::vector<DirLight* > dirLights;
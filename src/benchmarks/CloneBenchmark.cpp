@@ -0,0 +1,92 @@
+#include "CloneBenchmark.h"
+#include "../utils/Timer.h"
+#include "../utils/Logger.h"
+
+static int countNodes(const Node* root)
+{
+  int count = 1;
+  for (const Node* child : root->getChildren())
+    count += countNodes(child);
+  return count;
+}
+
+void runCloneBenchmark(const AssetImporter& importer, int numCopies)
+{
+  Asset* original = importer.getOriginal();
+  if (!original)
+  {
+    Log.print<Severity::warning>("Clone benchmark: the importer has not loaded an asset");
+    return;
+  }
+
+  std::vector<Asset*> copies;
+  copies.reserve(numCopies);
+
+  Timer timer;
+  timer.startTimer();
+  for (int i = 0; i < numCopies; i++)
+  {
+    copies.push_back(importer.createInstance());
+  }
+  float cloneMs = timer.stopTimer();
+
+  // every model of a copy has to live in the copy itself, not in the original
+  int badModels = 0;
+  for (Asset* copy : copies)
+  {
+    for (auto& pair : copy->getAllModels())
+    {
+      if (pair.second->getRoot() != copy) badModels++;
+    }
+  }
+
+  timer.startTimer();
+  for (Asset* copy : copies)
+  {
+    delete copy;
+  }
+  float deleteMs = timer.stopTimer();
+
+  Log.print<Severity::info>(
+    "Clone benchmark: ", numCopies, " instances of ", countNodes(original), " nodes, ",
+    cloneMs, "ms to clone (", cloneMs / numCopies, "ms each), ", deleteMs, "ms to delete",
+    badModels > 0 ? " - models not remapped: " : "", badModels > 0 ? std::to_string(badModels) : ""
+  );
+
+  // the same number of lightweight instances sharing the importer's prototype, all under one parent as they
+  // would be in a scene, so each costs its node plus one entry in the parent's TransformHierarchy
+  Node* parent = new Node();
+
+  timer.startTimer();
+  for (int i = 0; i < numCopies; i++)
+  {
+    parent->addChild(importer.createSharedInstance());
+  }
+  float instanceMs = timer.stopTimer();
+
+  delete parent;
+
+  size_t instanceBytes = sizeof(AssetInstance) + TransformHierarchy::getBytesPerEntry();
+  Log.print<Severity::info>(
+    "Clone benchmark: ", numCopies, " shared instances (", instanceBytes, " bytes each: ",
+    sizeof(AssetInstance), " node + ", TransformHierarchy::getBytesPerEntry(), " hierarchy entry), ",
+    instanceMs, "ms to create"
+  );
+
+  // and as records of a single batch node
+  AssetInstanceBatch* batch = importer.createInstanceBatch();
+
+  timer.startTimer();
+  for (int i = 0; i < numCopies; i++)
+  {
+    batch->add(AffineTransform());
+  }
+  float batchMs = timer.stopTimer();
+
+  delete batch;
+
+  Log.print<Severity::info>(
+    "Clone benchmark: ", numCopies, " batched instances (", sizeof(AssetInstanceRecord), " bytes each), ",
+    batchMs, "ms to create"
+  );
+}
\ No newline at end of file
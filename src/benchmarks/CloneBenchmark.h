@@ -0,0 +1,7 @@
+#pragma once
+#include "../importers/AssetImporter.h"
+
+// time numCopies calls to importer.createInstance(), and check that every copy points at its own models.
+// Then time the same number of importer.createSharedInstance(), and records in an importer.createInstanceBatch(), for comparison.
+// Shared instances are reported with their hierarchy entry, since that's part of what each one costs
+void runCloneBenchmark(const AssetImporter& importer, int numCopies = 1000);
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "TransformBenchmark.h"
+#include "../scene/Node.h"
+#include "../utils/Timer.h"
+#include "../utils/ThreadPool.h"
+#include "../utils/Logger.h"
+#include <random>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+// a random tree: every node picks an existing node as its parent, so it ends up wide and shallow
+static Node* buildSyntheticTree(int numNodes, std::vector<Node*>& nodes)
+{
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+  Node* root = new Node();
+  nodes.push_back(root);
+
+  for (int i = 1; i < numNodes; i++)
+  {
+    Node* node = new Node();
+    node->setPosition(glm::vec3(dist(rng), dist(rng), dist(rng)));
+    node->setRotationQuaternion(glm::normalize(glm::quat(dist(rng), dist(rng), dist(rng), dist(rng))));
+    node->setScale(glm::vec3(1.f + .1f * dist(rng)));
+    nodes[rng() % nodes.size()]->addChild(node);
+    nodes.push_back(node);
+  }
+
+  return root;
+}
+
+// moving the root forces every entry to be recomputed. Only the hierarchy sweep is timed, not the update recursion
+static float timeSweeps(Node* root, int numIterations)
+{
+  Timer timer;
+  timer.startTimer();
+  for (int i = 0; i < numIterations; i++)
+  {
+    root->setPosition(glm::vec3(float(i % 2), 0, 0));
+    root->sweepTransforms();
+  }
+  return timer.stopTimer() / numIterations;
+}
+
+// the rest of a root's update: nothing moved, so the sweep is a no-op and this is the recursion through every node
+static float timeUpdateRecursion(Node* root, int numIterations)
+{
+  root->update(0);
+
+  Timer timer;
+  timer.startTimer();
+  for (int i = 0; i < numIterations; i++)
+  {
+    root->update(0);
+  }
+  return timer.stopTimer() / numIterations;
+}
+
+static std::vector<glm::mat4> snapshot(const std::vector<Node*>& nodes)
+{
+  std::vector<glm::mat4> ret;
+  ret.reserve(nodes.size());
+  for (Node* n : nodes)
+    ret.push_back(n->getGlobalTransform());
+  return ret;
+}
+
+void runTransformBenchmark(int numNodes, int numIterations)
+{
+  std::vector<Node*> nodes;
+  Node* root = buildSyntheticTree(numNodes, nodes);
+
+  Log.print<Severity::info>("Transform benchmark: ", numNodes, " nodes, ", numIterations, " sweeps each");
+
+  root->update(0);
+  float serialMs = timeSweeps(root, numIterations);
+  std::vector<glm::mat4> expected = snapshot(nodes);
+  Log.print<Severity::info>("  serial sweep: ", serialMs, "ms");
+  Log.print<Severity::info>("  update recursion on top of the sweep (serial at any thread count): ", timeUpdateRecursion(root, numIterations), "ms");
+
+  unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int threads = 1; threads <= maxThreads; threads++)
+  {
+    ThreadPool pool(threads);
+    root->setTransformWorkerPool(&pool);
+    float ms = timeSweeps(root, numIterations);
+
+    std::vector<glm::mat4> actual = snapshot(nodes);
+    bool identical = std::memcmp(expected.data(), actual.data(), sizeof(glm::mat4) * expected.size()) == 0;
+
+    Log.print<Severity::info>(
+      "  ", threads, " thread(s): ", ms, "ms, speedup ", serialMs / ms, "x",
+      identical ? "" : " - MISMATCH with serial sweep!"
+    );
+    root->setTransformWorkerPool(nullptr);
+  }
+
+  delete root;
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#pragma once
+
+// Times a full transform sweep over a synthetic node tree, single threaded and
+// with 1 to N threads, and checks that every threaded result matches the serial one bit for bit.
+// Run with: gladSample --benchmark-transforms
+void runTransformBenchmark(int numNodes = 50000, int numIterations = 100);
\ No newline at end of file
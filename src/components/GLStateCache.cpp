@@ -0,0 +1,341 @@
+#include "GLStateCache.h"
+#include "../utils/Logger.h"
+#include <string>
+
+const GLenum GLStateCache::_sCapabilities[NUM_CAPABILITIES] = {
+  GL_BLEND,
+  GL_DEPTH_TEST,
+  GL_CULL_FACE,
+  GL_FRAMEBUFFER_SRGB,
+  GL_SCISSOR_TEST,
+  GL_STENCIL_TEST,
+  GL_POLYGON_OFFSET_FILL,
+  GL_MULTISAMPLE
+};
+
+GLuint GLStateCache::_sProgram = UNKNOWN;
+GLuint GLStateCache::_sVertexArray = UNKNOWN;
+GLuint GLStateCache::_sTextures[MAX_TEXTURE_UNITS];
+GLuint GLStateCache::_sSamplers[MAX_TEXTURE_UNITS];
+GLuint GLStateCache::_sDrawFramebuffer = UNKNOWN;
+GLuint GLStateCache::_sReadFramebuffer = UNKNOWN;
+GLuint GLStateCache::_sDrawIndirectBuffer = UNKNOWN;
+GLStateCache::BufferBinding GLStateCache::_sStorageBuffers[MAX_BUFFER_BINDINGS];
+GLStateCache::BufferBinding GLStateCache::_sUniformBuffers[MAX_BUFFER_BINDINGS];
+
+int GLStateCache::_sCapabilityStates[NUM_CAPABILITIES];
+int GLStateCache::_sDepthMask = -1;
+
+GLenum GLStateCache::_sBlendSrc = UNKNOWN;
+GLenum GLStateCache::_sBlendDst = UNKNOWN;
+GLenum GLStateCache::_sDepthFunc = UNKNOWN;
+GLenum GLStateCache::_sCullFace = UNKNOWN;
+GLenum GLStateCache::_sFrontFace = UNKNOWN;
+GLenum GLStateCache::_sPolygonMode = UNKNOWN;
+
+bool GLStateCache::_sCheckErrors = false;
+GLCallStats GLStateCache::_sFrameStats;
+
+namespace
+{
+  // the arrays can't be filled with UNKNOWN in their definitions, so do it before main
+  struct GLStateCacheInit
+  {
+    GLStateCacheInit() { GLStateCache::invalidate(); }
+  } glStateCacheInit;
+}
+
+int GLStateCache::_getCapabilityIdx(GLenum capability)
+{
+  for (int i = 0; i < NUM_CAPABILITIES; i++)
+  {
+    if (_sCapabilities[i] == capability) return i;
+  }
+  return -1;
+}
+
+bool GLStateCache::_update(GLuint& cached, GLuint value)
+{
+  if (cached == value)
+  {
+    _sFrameStats.skipped++;
+    return false;
+  }
+
+  cached = value;
+  _sFrameStats.issued++;
+  return true;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+  if (_update(_sProgram, program))
+    glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+  if (_update(_sVertexArray, vao))
+    glBindVertexArray(vao);
+}
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+  if (target == GL_FRAMEBUFFER)
+  {
+    // sets both, so it's only redundant if both already match
+    if (_sDrawFramebuffer == framebuffer && _sReadFramebuffer == framebuffer)
+    {
+      _sFrameStats.skipped++;
+      return;
+    }
+
+    _sDrawFramebuffer = _sReadFramebuffer = framebuffer;
+    _sFrameStats.issued++;
+    glBindFramebuffer(target, framebuffer);
+  }
+  else if (target == GL_DRAW_FRAMEBUFFER)
+  {
+    if (_update(_sDrawFramebuffer, framebuffer))
+      glBindFramebuffer(target, framebuffer);
+  }
+  else if (target == GL_READ_FRAMEBUFFER)
+  {
+    if (_update(_sReadFramebuffer, framebuffer))
+      glBindFramebuffer(target, framebuffer);
+  }
+}
+
+void GLStateCache::bindTextureUnit(GLuint unit, GLuint texture)
+{
+  if (unit >= MAX_TEXTURE_UNITS)
+  {
+    _sFrameStats.issued++;
+    glBindTextureUnit(unit, texture);
+    return;
+  }
+
+  if (_update(_sTextures[unit], texture))
+    glBindTextureUnit(unit, texture);
+}
+
+void GLStateCache::bindSampler(GLuint unit, GLuint sampler)
+{
+  if (unit >= MAX_TEXTURE_UNITS)
+  {
+    _sFrameStats.issued++;
+    glBindSampler(unit, sampler);
+    return;
+  }
+
+  if (_update(_sSamplers[unit], sampler))
+    glBindSampler(unit, sampler);
+}
+
+void GLStateCache::bindDrawIndirectBuffer(GLuint buffer)
+{
+  if (_update(_sDrawIndirectBuffer, buffer))
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+}
+
+GLStateCache::BufferBinding* GLStateCache::_getBufferBinding(GLenum target, GLuint index)
+{
+  if (index >= MAX_BUFFER_BINDINGS) return nullptr;
+  if (target == GL_SHADER_STORAGE_BUFFER) return &_sStorageBuffers[index];
+  if (target == GL_UNIFORM_BUFFER) return &_sUniformBuffers[index];
+  return nullptr;
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+  bindBufferRange(target, index, buffer, 0, 0);
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+  BufferBinding* binding = _getBufferBinding(target, index);
+  if (binding && binding->buffer == buffer && binding->offset == offset && binding->size == size)
+  {
+    _sFrameStats.skipped++;
+    return;
+  }
+
+  if (binding)
+    *binding = { buffer, offset, size };
+
+  _sFrameStats.issued++;
+  if (size == 0)
+    glBindBufferBase(target, index, buffer);
+  else
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLStateCache::enable(GLenum capability)
+{
+  int idx = _getCapabilityIdx(capability);
+  if (idx >= 0 && _sCapabilityStates[idx] == 1)
+  {
+    _sFrameStats.skipped++;
+    return;
+  }
+
+  if (idx >= 0) _sCapabilityStates[idx] = 1;
+  _sFrameStats.issued++;
+  glEnable(capability);
+}
+
+void GLStateCache::disable(GLenum capability)
+{
+  int idx = _getCapabilityIdx(capability);
+  if (idx >= 0 && _sCapabilityStates[idx] == 0)
+  {
+    _sFrameStats.skipped++;
+    return;
+  }
+
+  if (idx >= 0) _sCapabilityStates[idx] = 0;
+  _sFrameStats.issued++;
+  glDisable(capability);
+}
+
+void GLStateCache::blendFunc(GLenum src, GLenum dst)
+{
+  if (_sBlendSrc == src && _sBlendDst == dst)
+  {
+    _sFrameStats.skipped++;
+    return;
+  }
+
+  _sBlendSrc = src;
+  _sBlendDst = dst;
+  _sFrameStats.issued++;
+  glBlendFunc(src, dst);
+}
+
+void GLStateCache::depthMask(bool write)
+{
+  int value = write ? 1 : 0;
+  if (_sDepthMask == value)
+  {
+    _sFrameStats.skipped++;
+    return;
+  }
+
+  _sDepthMask = value;
+  _sFrameStats.issued++;
+  glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::depthFunc(GLenum func)
+{
+  if (_update(_sDepthFunc, func))
+    glDepthFunc(func);
+}
+
+void GLStateCache::cullFace(GLenum face)
+{
+  if (_update(_sCullFace, face))
+    glCullFace(face);
+}
+
+void GLStateCache::frontFace(GLenum winding)
+{
+  if (_update(_sFrontFace, winding))
+    glFrontFace(winding);
+}
+
+void GLStateCache::polygonMode(GLenum mode)
+{
+  // core profile only has GL_FRONT_AND_BACK
+  if (_update(_sPolygonMode, mode))
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLStateCache::invalidate()
+{
+  _sProgram = UNKNOWN;
+  _sVertexArray = UNKNOWN;
+  _sDrawFramebuffer = UNKNOWN;
+  _sReadFramebuffer = UNKNOWN;
+  _sDrawIndirectBuffer = UNKNOWN;
+
+  for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+  {
+    _sTextures[i] = UNKNOWN;
+    _sSamplers[i] = UNKNOWN;
+  }
+
+  for (int i = 0; i < MAX_BUFFER_BINDINGS; i++)
+  {
+    _sStorageBuffers[i] = { UNKNOWN, 0, 0 };
+    _sUniformBuffers[i] = { UNKNOWN, 0, 0 };
+  }
+
+  for (int i = 0; i < NUM_CAPABILITIES; i++)
+    _sCapabilityStates[i] = -1;
+  _sDepthMask = -1;
+
+  _sBlendSrc = UNKNOWN;
+  _sBlendDst = UNKNOWN;
+  _sDepthFunc = UNKNOWN;
+  _sCullFace = UNKNOWN;
+  _sFrontFace = UNKNOWN;
+  _sPolygonMode = UNKNOWN;
+}
+
+void GLStateCache::forgetProgram(GLuint program)
+{
+  if (_sProgram == program) _sProgram = UNKNOWN;
+}
+
+void GLStateCache::forgetVertexArray(GLuint vao)
+{
+  if (_sVertexArray == vao) _sVertexArray = UNKNOWN;
+}
+
+void GLStateCache::forgetTexture(GLuint texture)
+{
+  for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+  {
+    if (_sTextures[i] == texture) _sTextures[i] = UNKNOWN;
+  }
+}
+
+void GLStateCache::forgetFramebuffer(GLuint framebuffer)
+{
+  if (_sDrawFramebuffer == framebuffer) _sDrawFramebuffer = UNKNOWN;
+  if (_sReadFramebuffer == framebuffer) _sReadFramebuffer = UNKNOWN;
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer)
+{
+  if (_sDrawIndirectBuffer == buffer) _sDrawIndirectBuffer = UNKNOWN;
+
+  for (int i = 0; i < MAX_BUFFER_BINDINGS; i++)
+  {
+    if (_sStorageBuffers[i].buffer == buffer) _sStorageBuffers[i].buffer = UNKNOWN;
+    if (_sUniformBuffers[i].buffer == buffer) _sUniformBuffers[i].buffer = UNKNOWN;
+  }
+}
+
+void GLStateCache::checkErrors(const char* location)
+{
+  if (!_sCheckErrors) return;
+
+  GLenum err;
+  while ((err = glGetError()) != GL_NO_ERROR)
+  {
+    std::string error;
+    switch (err)
+    {
+    case GL_INVALID_ENUM:                  error = "INVALID_ENUM"; break;
+    case GL_INVALID_VALUE:                 error = "INVALID_VALUE"; break;
+    case GL_INVALID_OPERATION:             error = "INVALID_OPERATION"; break;
+    case GL_STACK_OVERFLOW:                error = "STACK_OVERFLOW"; break;
+    case GL_STACK_UNDERFLOW:               error = "STACK_UNDERFLOW"; break;
+    case GL_OUT_OF_MEMORY:                 error = "OUT_OF_MEMORY"; break;
+    case GL_INVALID_FRAMEBUFFER_OPERATION: error = "INVALID_FRAMEBUFFER_OPERATION"; break;
+    }
+    Log.print<Severity::warning>("Encountered a GL error in ", location, ": ", err, " (", error, ")");
+  }
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+#include <glad/glad.h>
+
+// GL calls that went through to the driver vs ones dropped because the state was already set
+struct GLCallStats
+{
+  unsigned int issued = 0;
+  unsigned int skipped = 0;
+};
+
+// Remembers the GL state set through it (there's only ever one context) and drops calls that wouldn't change anything.
+// Everything starts out unknown, so the first call of each kind always goes through.
+// Code that changes state behind its back should call invalidate(), and deleted objects should be forgotten,
+// since GL unbinds them and may hand the same name out again.
+class GLStateCache
+{
+public:
+  static const int MAX_TEXTURE_UNITS = 32;
+  static const int MAX_BUFFER_BINDINGS = 16;
+
+protected:
+  static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+  // an indexed buffer binding. size 0 is the whole buffer (glBindBufferBase)
+  struct BufferBinding
+  {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+
+  // capabilities tracked by enable / disable
+  static const int NUM_CAPABILITIES = 8;
+  static const GLenum _sCapabilities[NUM_CAPABILITIES];
+
+  static GLuint _sProgram;
+  static GLuint _sVertexArray;
+  static GLuint _sTextures[MAX_TEXTURE_UNITS];
+  static GLuint _sSamplers[MAX_TEXTURE_UNITS];
+  static GLuint _sDrawFramebuffer;
+  static GLuint _sReadFramebuffer;
+  static GLuint _sDrawIndirectBuffer;
+  static BufferBinding _sStorageBuffers[MAX_BUFFER_BINDINGS];
+  static BufferBinding _sUniformBuffers[MAX_BUFFER_BINDINGS];
+
+  // 1 enabled, 0 disabled, -1 unknown
+  static int _sCapabilityStates[NUM_CAPABILITIES];
+  static int _sDepthMask;
+
+  static GLenum _sBlendSrc;
+  static GLenum _sBlendDst;
+  static GLenum _sDepthFunc;
+  static GLenum _sCullFace;
+  static GLenum _sFrontFace;
+  static GLenum _sPolygonMode;
+
+  static bool _sCheckErrors;
+  static GLCallStats _sFrameStats;
+
+  static int _getCapabilityIdx(GLenum capability);
+
+  // true (and counted as issued) if cached differs from value, which it then becomes
+  static bool _update(GLuint& cached, GLuint value);
+
+  // the tracked binding of an indexed target, nullptr if it isn't tracked
+  static BufferBinding* _getBufferBinding(GLenum target, GLuint index);
+
+public:
+  // programs, vertex arrays and framebuffers
+  static void useProgram(GLuint program);
+  static void bindVertexArray(GLuint vao);
+  static void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+  // textures and samplers, by unit
+  static void bindTextureUnit(GLuint unit, GLuint texture);
+  static void bindSampler(GLuint unit, GLuint sampler);
+
+  // buffers. Only GL_SHADER_STORAGE_BUFFER and GL_UNIFORM_BUFFER are tracked for indexed bindings
+  static void bindDrawIndirectBuffer(GLuint buffer);
+  static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+  static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+  // blend / depth / raster state
+  static void enable(GLenum capability);
+  static void disable(GLenum capability);
+  static void blendFunc(GLenum src, GLenum dst);
+  static void depthMask(bool write);
+  static void depthFunc(GLenum func);
+  static void cullFace(GLenum face);
+  static void frontFace(GLenum winding);
+  static void polygonMode(GLenum mode);
+
+  // forget everything, e.g. after calls made behind the cache's back
+  static void invalidate();
+
+  // deleted objects are unbound by GL, and their names can be reused
+  static void forgetProgram(GLuint program);
+  static void forgetVertexArray(GLuint vao);
+  static void forgetTexture(GLuint texture);
+  static void forgetFramebuffer(GLuint framebuffer);
+  static void forgetBuffer(GLuint buffer);
+
+  // glGetError makes the driver sync with the GPU, so it's only checked when asked for (off by default)
+  static void setErrorChecking(bool enabled) { _sCheckErrors = enabled; }
+  static bool isErrorChecking() { return _sCheckErrors; }
+
+  // log every pending GL error, if error checking is on
+  static void checkErrors(const char* location);
+
+  static const GLCallStats& getFrameStats() { return _sFrameStats; }
+  static void resetFrameStats() { _sFrameStats = GLCallStats(); }
+};
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "Texture.h"
 #include "Primitive.h"
 #include "Window.h"
+#include "UploadRing.h"
+#include "../utils/ThreadPool.h"
 
 struct GameResources {
   ShaderManager& shaderManager;
@@ -11,18 +13,24 @@ struct GameResources {
   TextureManager& textureManager;
   PrimitiveManager& primitiveManager;
   Window& window;
+  ThreadPool& workerPool;
+  UploadRing& uploadRing;
 
   GameResources(
     ShaderManager& shaderManager,
     ShaderProgramManager& shaderProgramManager,
     TextureManager& textureManager,
     PrimitiveManager& primitiveManager,
-    Window& window
+    Window& window,
+    ThreadPool& workerPool,
+    UploadRing& uploadRing
   ) : shaderManager(shaderManager),
     shaderProgramManager(shaderProgramManager),
     textureManager(textureManager),
     primitiveManager(primitiveManager),
-    window(window)
+    window(window),
+    workerPool(workerPool),
+    uploadRing(uploadRing)
   {}
 
   GameResources(const GameResources& other)
@@ -30,6 +38,8 @@ struct GameResources {
     shaderProgramManager(other.shaderProgramManager),
     textureManager(other.textureManager),
     primitiveManager(other.primitiveManager),
-    window(other.window)
+    window(other.window),
+    workerPool(other.workerPool),
+    uploadRing(other.uploadRing)
   {}
 };
\ No newline at end of file
@@ -0,0 +1,355 @@
+#include "GeometryArena.h"
+#include "Primitive.h"
+#include "GLStateCache.h"
+#include <algorithm>
+
+namespace
+{
+  // one attribute of a mesh: its values, and how many make up a vertex
+  struct AttributeSource
+  {
+    const void* data;
+    size_t size;
+    unsigned int components;
+  };
+
+  AttributeSource getAttributeSource(const PrimitiveData& data, int attribute)
+  {
+    switch (attribute)
+    {
+    case Primitive::ATTRIBUTE_POSITION:   return { data.vertices.data(), data.vertices.size(), Primitive::SIZE_POSITION };
+    case Primitive::ATTRIBUTE_NORMAL:     return { data.normals.data(), data.normals.size(), Primitive::SIZE_NORMAL };
+    case Primitive::ATTRIBUTE_TEX:        return { data.texCoords.data(), data.texCoords.size(), data.numComponents };
+    case Primitive::ATTRIBUTE_TANGENT:    return { data.tangents.data(), data.tangents.size(), Primitive::SIZE_TANGENT };
+    case Primitive::ATTRIBUTE_BITANGENT:  return { data.bitangents.data(), data.bitangents.size(), Primitive::SIZE_BITANGENT };
+    case Primitive::ATTRIBUTE_WEIGHT:     return { data.weights.data(), data.weights.size(), Primitive::SIZE_WEIGHT };
+    case Primitive::ATTRIBUTE_JOINT:      return { data.joints.data(), data.joints.size(), Primitive::SIZE_JOINT };
+    case Primitive::ATTRIBUTE_TEX_2:      return { data.texCoords_2.data(), data.texCoords_2.size(), data.numComponents_2 };
+    case Primitive::ATTRIBUTE_TEX_3:      return { data.texCoords_3.data(), data.texCoords_3.size(), data.numComponents_3 };
+    }
+    return { nullptr, 0, 0 };
+  }
+
+  // the attributes of a mesh that can be uploaded, indexed by location. Ones with the wrong number of values are
+  // left out (Primitive warns about them)
+  unsigned int getStreams(const PrimitiveData& data, VertexStream* streams)
+  {
+    unsigned int mask = 0;
+    size_t numVertices = data.vertices.size() / Primitive::SIZE_POSITION;
+    if (numVertices == 0) return mask;
+
+    for (int i = 0; i < GeometryArena::NUM_ATTRIBUTES; i++)
+    {
+      AttributeSource source = getAttributeSource(data, i);
+      if (source.components == 0 || source.size != numVertices * source.components) continue;
+
+      streams[i].data = source.data;
+      streams[i].components = source.components;
+      mask |= 1u << i;
+    }
+    return mask;
+  }
+
+  // every layout a mesh can be stored in, smallest first
+  const std::vector<VertexLayoutInfo>& getLayouts(bool quantized)
+  {
+    static const std::vector<VertexLayoutInfo> layouts = {
+      VertexLayoutInfo::of<StaticVertexLayout>("static"),
+      VertexLayoutInfo::of<TangentVertexLayout>("tangent"),
+      VertexLayoutInfo::of<SkinnedVertexLayout>("skinned"),
+      VertexLayoutInfo::of<SkinnedTangentVertexLayout>("skinned tangent"),
+      VertexLayoutInfo::of<FullVertexLayout>("full")
+    };
+
+    static const std::vector<VertexLayoutInfo> quantizedLayouts = {
+      VertexLayoutInfo::of<QuantizedStaticVertexLayout>("quantized static", true),
+      VertexLayoutInfo::of<QuantizedTangentVertexLayout>("quantized tangent", true),
+      VertexLayoutInfo::of<QuantizedSkinnedVertexLayout>("quantized skinned", true),
+      VertexLayoutInfo::of<QuantizedSkinnedTangentVertexLayout>("quantized skinned tangent", true),
+      VertexLayoutInfo::of<QuantizedFullVertexLayout>("quantized full", true)
+    };
+    return quantized ? quantizedLayouts : layouts;
+  }
+}
+
+// VertexFormat implementation
+VertexFormat VertexFormat::fromData(const PrimitiveData& data)
+{
+  return fromData(data, data.quantize);
+}
+
+VertexFormat VertexFormat::fromData(const PrimitiveData& data, bool quantize)
+{
+  VertexStream streams[GeometryArena::NUM_ATTRIBUTES];
+  unsigned int mask = getStreams(data, streams);
+  size_t numVertices = data.vertices.size() / Primitive::SIZE_POSITION;
+
+  // joints only get 8 bits
+  if (quantize && streams[Primitive::ATTRIBUTE_JOINT].data &&
+    std::any_of(data.joints.begin(), data.joints.end(), [](unsigned int joint) { return joint > 255; }))
+  {
+    quantize = false;
+  }
+
+  // the full layouts have every attribute, so there's always a match
+  VertexFormat format;
+  for (const VertexLayoutInfo& layout : getLayouts(quantize))
+  {
+    if ((layout.attributeMask & mask) != mask) continue;
+
+    format.layout = &layout;
+    break;
+  }
+
+  // indices are relative to the mesh's first vertex, so only the mesh's own size matters
+  if (quantize && numVertices <= 65536)
+    format.indexType = GL_UNSIGNED_SHORT;
+  return format;
+}
+
+bool VertexFormat::hasAttribute(int attribute) const
+{
+  return layout && layout->hasAttribute(attribute);
+}
+
+bool VertexFormat::isQuantized() const
+{
+  return layout && layout->isQuantized;
+}
+
+size_t VertexFormat::getSize(size_t numVertices, size_t numIndices) const
+{
+  return (layout ? numVertices * layout->stride : 0) + numIndices * getIndexSize();
+}
+
+// RangeAllocator implementation
+bool RangeAllocator::allocate(unsigned int size, unsigned int& offset)
+{
+  for (size_t i = 0; i < _mFree.size(); i++)
+  {
+    Range& range = _mFree[i];
+    if (range.size < size) continue;
+
+    offset = range.offset;
+    range.offset += size;
+    range.size -= size;
+    if (range.size == 0)
+      _mFree.erase(_mFree.begin() + i);
+
+    _mUsed += size;
+    return true;
+  }
+  return false;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int size)
+{
+  if (size == 0) return;
+  _mUsed -= size;
+
+  auto it = std::lower_bound(_mFree.begin(), _mFree.end(), offset,
+    [](const Range& range, unsigned int offset) { return range.offset < offset; });
+  it = _mFree.insert(it, { offset, size });
+
+  // merge with the next range, then the previous one
+  auto next = it + 1;
+  if (next != _mFree.end() && it->offset + it->size == next->offset)
+  {
+    it->size += next->size;
+    _mFree.erase(next);
+  }
+
+  if (it != _mFree.begin())
+  {
+    auto prev = it - 1;
+    if (prev->offset + prev->size == it->offset)
+    {
+      prev->size += it->size;
+      _mFree.erase(it);
+    }
+  }
+}
+
+void RangeAllocator::grow(unsigned int newCapacity)
+{
+  if (newCapacity <= _mCapacity) return;
+
+  unsigned int added = newCapacity - _mCapacity;
+  if (!_mFree.empty() && _mFree.back().offset + _mFree.back().size == _mCapacity)
+    _mFree.back().size += added;
+  else
+    _mFree.push_back({ _mCapacity, added });
+
+  _mCapacity = newCapacity;
+}
+
+// GeometryArena implementation
+GeometryArena::GeometryArena(const VertexFormat& format, int id)
+  : _mFormat(format), _mId(id)
+{
+  glCreateVertexArrays(1, &_mVao);
+
+  // every attribute reads from binding 0, at its offset into the vertex
+  _mStride = _mFormat.layout->stride;
+  _mFormat.layout->setupAttributes(_mVao, 0, 0);
+  Log.print<Severity::info>("Geometry arena ", _mId, " uses the ", _mFormat.layout->name, " vertex layout (", _mStride,
+    " bytes) with ", _mFormat.getIndexSize() * 8, " bit indices");
+
+  _growVertices(INITIAL_VERTICES);
+  _growIndices(INITIAL_INDICES);
+}
+
+GeometryArena::~GeometryArena()
+{
+  if (_mVbo)
+  {
+    GLStateCache::forgetBuffer(_mVbo);
+    glDeleteBuffers(1, &_mVbo);
+  }
+
+  if (_mEbo)
+  {
+    GLStateCache::forgetBuffer(_mEbo);
+    glDeleteBuffers(1, &_mEbo);
+  }
+
+  GLStateCache::forgetVertexArray(_mVao);
+  glDeleteVertexArrays(1, &_mVao);
+}
+
+unsigned int GeometryArena::_growBuffer(unsigned int buffer, size_t oldSize, size_t newSize)
+{
+  unsigned int grown;
+  glCreateBuffers(1, &grown);
+  glNamedBufferData(grown, newSize, nullptr, GL_STATIC_DRAW);
+
+  if (buffer)
+  {
+    glCopyNamedBufferSubData(buffer, grown, 0, 0, oldSize);
+    GLStateCache::forgetBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+  }
+  return grown;
+}
+
+void GeometryArena::_growVertices(unsigned int minVertices)
+{
+  unsigned int capacity = _mVertexRanges.getCapacity();
+  unsigned int newCapacity = std::max(capacity * 2, capacity + minVertices);
+
+  _mVbo = _growBuffer(_mVbo, (size_t)capacity * _mStride, (size_t)newCapacity * _mStride);
+  glVertexArrayVertexBuffer(_mVao, 0, _mVbo, 0, _mStride);
+
+  _mVertexRanges.grow(newCapacity);
+}
+
+void GeometryArena::_growIndices(unsigned int minIndices)
+{
+  unsigned int capacity = _mIndexRanges.getCapacity();
+  unsigned int newCapacity = std::max(capacity * 2, capacity + minIndices);
+
+  _mEbo = _growBuffer(_mEbo, (size_t)capacity * _mFormat.getIndexSize(), (size_t)newCapacity * _mFormat.getIndexSize());
+  glVertexArrayElementBuffer(_mVao, _mEbo);
+
+  _mIndexRanges.grow(newCapacity);
+}
+
+bool GeometryArena::allocate(const PrimitiveData& data, GeometryRange& range)
+{
+  if (!(VertexFormat::fromData(data) == _mFormat))
+  {
+    Log.print<Severity::warning>("Trying to put a mesh into a geometry arena of a different vertex format!");
+    return false;
+  }
+
+  unsigned int numVertices = (unsigned int)(data.vertices.size() / Primitive::SIZE_POSITION);
+  unsigned int numIndices = data.indices.empty() ? numVertices : (unsigned int)data.indices.size();
+  if (numVertices == 0) return false;
+
+  unsigned int baseVertex, firstIndex;
+  if (!_mVertexRanges.allocate(numVertices, baseVertex))
+  {
+    _growVertices(numVertices);
+    _mVertexRanges.allocate(numVertices, baseVertex);
+  }
+
+  if (!_mIndexRanges.allocate(numIndices, firstIndex))
+  {
+    _growIndices(numIndices);
+    _mIndexRanges.allocate(numIndices, firstIndex);
+  }
+
+  // interleave on the CPU, then upload the whole mesh at once
+  VertexStream streams[NUM_ATTRIBUTES];
+  getStreams(data, streams);
+
+  std::vector<char> vertices((size_t)numVertices * _mStride, 0);
+  _mFormat.layout->interleave(streams, numVertices, vertices.data());
+  glNamedBufferSubData(_mVbo, (size_t)baseVertex * _mStride, vertices.size(), vertices.data());
+
+  // everything is drawn indexed, so meshes without indices just get 0..n-1
+  std::vector<unsigned int> sequential;
+  const unsigned int* indices = data.indices.data();
+  if (data.indices.empty())
+  {
+    sequential.resize(numVertices);
+    for (unsigned int i = 0; i < numVertices; i++) sequential[i] = i;
+    indices = sequential.data();
+  }
+
+  _uploadIndices(firstIndex, indices, numIndices);
+
+  range.arena = this;
+  range.baseVertex = baseVertex;
+  range.numVertices = numVertices;
+  range.firstIndex = firstIndex;
+  range.numIndices = numIndices;
+  return true;
+}
+
+void GeometryArena::_uploadIndices(unsigned int firstIndex, const unsigned int* indices, unsigned int numIndices)
+{
+  size_t indexSize = _mFormat.getIndexSize();
+  if (_mFormat.indexType == GL_UNSIGNED_SHORT)
+  {
+    std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+    glNamedBufferSubData(_mEbo, (size_t)firstIndex * indexSize, numIndices * indexSize, shortIndices.data());
+  }
+  else
+  {
+    glNamedBufferSubData(_mEbo, (size_t)firstIndex * indexSize, numIndices * indexSize, indices);
+  }
+}
+
+bool GeometryArena::allocateIndices(const std::vector<unsigned int>& indices, unsigned int& firstIndex)
+{
+  unsigned int numIndices = (unsigned int)indices.size();
+  if (numIndices == 0) return false;
+
+  if (!_mIndexRanges.allocate(numIndices, firstIndex))
+  {
+    _growIndices(numIndices);
+    _mIndexRanges.allocate(numIndices, firstIndex);
+  }
+
+  _uploadIndices(firstIndex, indices.data(), numIndices);
+  return true;
+}
+
+void GeometryArena::freeIndices(unsigned int firstIndex, unsigned int numIndices)
+{
+  _mIndexRanges.free(firstIndex, numIndices);
+}
+
+void GeometryArena::free(const GeometryRange& range)
+{
+  if (range.arena != this) return;
+
+  _mVertexRanges.free(range.baseVertex, range.numVertices);
+  _mIndexRanges.free(range.firstIndex, range.numIndices);
+}
+
+void GeometryArena::bind() const
+{
+  GLStateCache::bindVertexArray(_mVao);
+}
\ No newline at end of file
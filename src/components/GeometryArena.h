@@ -0,0 +1,120 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include "../utils/Logger.h"
+
+struct PrimitiveData;
+struct VertexLayoutInfo;
+class GeometryArena;
+
+// the interleaved layout a mesh is stored in (the smallest one of Primitive.h's layouts with all of its attributes),
+// and its index type. Meshes with the same format share one VAO
+struct VertexFormat
+{
+  const VertexLayoutInfo* layout = nullptr;
+
+  // GL_UNSIGNED_INT, or GL_UNSIGNED_SHORT for quantized meshes with at most 65536 vertices
+  GLenum indexType = GL_UNSIGNED_INT;
+
+  static VertexFormat fromData(const PrimitiveData& data);
+
+  // the format the mesh would get with or without PrimitiveData::quantize
+  static VertexFormat fromData(const PrimitiveData& data, bool quantize);
+
+  bool hasAttribute(int attribute) const;
+  bool isQuantized() const;
+  unsigned int getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+  // bytes taken up by a mesh in this format
+  size_t getSize(size_t numVertices, size_t numIndices) const;
+
+  bool operator==(const VertexFormat& other) const { return layout == other.layout && indexType == other.indexType; }
+};
+
+// where a mesh lives inside an arena. Indices are relative to baseVertex
+struct GeometryRange
+{
+  GeometryArena* arena = nullptr;
+  unsigned int baseVertex = 0;
+  unsigned int numVertices = 0;
+  unsigned int firstIndex = 0;
+  unsigned int numIndices = 0;
+};
+
+// first fit free list over [0, capacity), in elements. Neighbouring free ranges are merged
+class RangeAllocator
+{
+protected:
+  struct Range
+  {
+    unsigned int offset;
+    unsigned int size;
+  };
+
+  // sorted by offset
+  std::vector<Range> _mFree;
+  unsigned int _mCapacity = 0;
+  unsigned int _mUsed = 0;
+
+public:
+  bool allocate(unsigned int size, unsigned int& offset);
+  void free(unsigned int offset, unsigned int size);
+
+  // add [capacity, newCapacity) to the free list
+  void grow(unsigned int newCapacity);
+
+  unsigned int getCapacity() const { return _mCapacity; }
+  unsigned int getUsed() const { return _mUsed; }
+};
+
+// Vertex and index storage shared by every mesh of one vertex format.
+// The vertices are interleaved in one big buffer and all the indices are in one element buffer, so every mesh of the
+// format draws from the same VAO (with just 2 buffers), and a whole group of them can go in one glMultiDrawElementsIndirect.
+// Buffers start out small and double (copied on the GPU) whenever they run out.
+class GeometryArena
+{
+public:
+  static const int NUM_ATTRIBUTES = 9;
+  static const unsigned int INITIAL_VERTICES = 1 << 16;
+  static const unsigned int INITIAL_INDICES = 1 << 18;
+
+protected:
+  VertexFormat _mFormat;
+  int _mId;
+
+  unsigned int _mVao = 0;
+  unsigned int _mVbo = 0;
+  unsigned int _mStride = 0;
+  unsigned int _mEbo = 0;
+
+  RangeAllocator _mVertexRanges;
+  RangeAllocator _mIndexRanges;
+
+  // reallocate a buffer with a bigger size, keeping its contents
+  static unsigned int _growBuffer(unsigned int buffer, size_t oldSize, size_t newSize);
+  void _growVertices(unsigned int minVertices);
+  void _growIndices(unsigned int minIndices);
+  void _uploadIndices(unsigned int firstIndex, const unsigned int* indices, unsigned int numIndices);
+
+public:
+  GeometryArena(const VertexFormat& format, int id);
+  GeometryArena(const GeometryArena& other) = delete;
+  ~GeometryArena();
+
+  // upload a mesh, which has to match the arena's format. Meshes without indices get 0..n-1
+  bool allocate(const PrimitiveData& data, GeometryRange& range);
+  void free(const GeometryRange& range);
+
+  // more indices over a range's vertices, e.g. levels of detail. Freed separately from the range
+  bool allocateIndices(const std::vector<unsigned int>& indices, unsigned int& firstIndex);
+  void freeIndices(unsigned int firstIndex, unsigned int numIndices);
+
+  void bind() const;
+
+  const VertexFormat& getFormat() const { return _mFormat; }
+  GLenum getIndexType() const { return _mFormat.indexType; }
+  int getId() const { return _mId; }
+  unsigned int getVao() const { return _mVao; }
+  unsigned int getUsedVertices() const { return _mVertexRanges.getUsed(); }
+  unsigned int getUsedIndices() const { return _mIndexRanges.getUsed(); }
+};
\ No newline at end of file
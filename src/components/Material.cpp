@@ -1,4 +1,7 @@
 #include "Material.h"
+#include "GLStateCache.h"
+
+int MaterialBase::objectCount = 0;
 
 void MaterialBase::copyTo(Cloneable* cloned) const
 {
@@ -91,18 +94,50 @@ Material::Material(ShaderProgramManager* manager)
   modelMatUniform = _mProgram->getUniformByName("modelMat");
   normalMatUniform = _mProgram->getUniformByName("normalMat");
   projViewModelMatUniform = _mProgram->getUniformByName("projViewModelMat");
-  alphaCutoffUniform = _mProgram->getUniformByName("alphaCutoff");
-  boneMatricesUniform = _mProgram->getUniformByName("boneMatrices");
   useBoneMatricesUniform = _mProgram->getUniformByName("useBoneMatrices");
+  useInstancingUniform = _mProgram->getUniformByName("useInstancing");
+  useQuantizedVerticesUniform = _mProgram->getUniformByName("useQuantizedVertices");
 }
 
 Material::~Material()
 {}
 
+UniformBlockPool& Material::_getBlockPool()
+{
+  static UniformBlockPool pool(MATERIAL_BINDING, sizeof(PhongMaterialBlock));
+  return pool;
+}
+
+void Material::_writeBlock(PhongMaterialBlock& block) const
+{
+  block.ambient = glm::vec4(1);
+  block.diffuse = glm::vec4(1);
+  block.specular = glm::vec4(1);
+  block.ambientUVIndex = -1;
+  block.diffuseUVIndex = -1;
+  block.specularUVIndex = -1;
+  block.shininess = 32;
+  block.alphaCutoff = _mAlphaCutoff;
+}
+
 void Material::preRender()
 {
-  if (alphaCutoffUniform)
-    alphaCutoffUniform->setUniform(.5f);
+  if (_mBlock.isDirty())
+  {
+    PhongMaterialBlock block = {};
+    _writeBlock(block);
+    _mBlock.write(&block);
+  }
+  _mBlock.bind();
+}
+
+void Material::setAlphaCutoff(float alphaCutoff)
+{
+  if (_mAlphaCutoff != alphaCutoff)
+  {
+    _mAlphaCutoff = alphaCutoff;
+    _mBlock.markDirty();
+  }
 }
 
 void Material::setModelMatrix(const glm::mat4& model)
@@ -126,10 +161,23 @@ void Material::setNormalMatrix(const glm::mat3& normal)
 // for skeletal animation
 void Material::setBoneMatrices(const std::vector<glm::mat4>& matrices)
 {
-  if (boneMatricesUniform)
+  // shared by every immediate draw, and kept for as long as the context
+  static GLuint buffer = 0;
+  static size_t capacity = 0;
+
+  size_t size = matrices.size() * sizeof(glm::mat4);
+  if (size == 0) return;
+
+  if (!buffer)
+    glCreateBuffers(1, &buffer);
+
+  if (size > capacity)
   {
-    boneMatricesUniform->setUniform(matrices);
+    capacity = size * 2;
+    glNamedBufferData(buffer, capacity, nullptr, GL_STREAM_DRAW);
   }
+  glNamedBufferSubData(buffer, 0, size, matrices.data());
+  GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, BONE_BUFFER_BINDING, buffer);
 }
 
 void Material::setUseBoneTransform(bool use)
@@ -140,6 +188,18 @@ void Material::setUseBoneTransform(bool use)
   }
 }
 
+void Material::setUseInstancing(bool use)
+{
+  if (useInstancingUniform)
+    useInstancingUniform->setUniform(use ? 1 : 0);
+}
+
+void Material::setUseQuantizedVertices(bool use)
+{
+  if (useQuantizedVerticesUniform)
+    useQuantizedVerticesUniform->setUniform(use ? 1 : 0);
+}
+
 void Material::copyTo(Cloneable* cloned) const
 {
   MaterialBase::copyTo(cloned);
@@ -162,97 +222,98 @@ Material* Material::clone() const
 
 // ----------- phoon material ---------------
 PhongMaterial::PhongMaterial()
-  : diffuse(1), specular(1), ambient(1)
+  : _mDiffuse(1), _mSpecular(1), _mAmbient(1)
 {}
 
 PhongMaterial::PhongMaterial(ShaderProgramManager* manager)
-  : diffuse(1), specular(1), ambient(1)
-{
-  _mProgramManager = manager;
-  static std::string vsPath = "./shaders/Phong.vs";
-  static std::string fsPath = "./shaders/Phong.fs";
-  static std::string programKey = vsPath + "___" + fsPath;
-  _mProgram = getShaderProgram(*_mProgramManager, programKey, vsPath, fsPath);
-
-  modelMatUniform = _mProgram->getUniformByName("modelMat");
-  normalMatUniform = _mProgram->getUniformByName("normalMat");
-  projViewModelMatUniform = _mProgram->getUniformByName("projViewModelMat");
-  boneMatricesUniform = _mProgram->getUniformByName("boneMatrices");
-  useBoneMatricesUniform = _mProgram->getUniformByName("useBoneMatrices");
-
-  diffuseTexUniform = _mProgram->getUniformByName("phongMaterial.diffuseTex");
-  specularTexUniform = _mProgram->getUniformByName("phongMaterial.specularTex");
-  ambientTexUniform = _mProgram->getUniformByName("phongMaterial.ambientTex");
-  diffuseUniform = _mProgram->getUniformByName("phongMaterial.diffuse");
-  specularUniform = _mProgram->getUniformByName("phongMaterial.specular");
-  ambientUniform = _mProgram->getUniformByName("phongMaterial.ambient");
-
-  shininessUniform = _mProgram->getUniformByName("phongMaterial.shininess");
-  alphaCutoffUniform = _mProgram->getUniformByName("alphaCutoff");
-
-  diffuseUVIndexUniform = _mProgram->getUniformByName("phongMaterial.diffuseUVIndex");
-  specularUVIndexUniform = _mProgram->getUniformByName("phongMaterial.specularUVIndex");
-  ambientUVIndexUniform = _mProgram->getUniformByName("phongMaterial.ambientUVIndex");
-}
+  : Material(manager), _mDiffuse(1), _mSpecular(1), _mAmbient(1)
+{}
 
 PhongMaterial::~PhongMaterial()
 {}
 
-void bindTexUniform(Uniform* texUniform, Uniform* colorUniform, Texture* tex, glm::vec4 color, int texIdx)
+namespace
 {
-  if (texUniform)
+  void writeTexture(Texture* tex, int uvIndex, int& blockUVIndex, glm::uvec2& blockHandle, glm::ivec2& blockLayer)
   {
-    if (tex)
+    // textures that couldn't be made reachable are treated as missing
+    if (!tex || !tex->getRef().isValid())
     {
-      texUniform->setUniform(texIdx);
-      tex->bind(texIdx);
+      blockUVIndex = -1;
+      return;
     }
-    else
-    {
-      texUniform->setUniform(texIdx);
-      glActiveTexture(GL_TEXTURE0 + texIdx);
-      glBindTexture(GL_TEXTURE_2D, 0);
-    }
-  }
 
-  if (colorUniform)
-  {
-    colorUniform->setUniform(color);
+    const TextureRef& ref = tex->getRef();
+    blockUVIndex = uvIndex;
+    blockHandle = ref.getHandle();
+    blockLayer = glm::ivec2(ref.array, ref.layer);
   }
 }
 
+void PhongMaterial::_writeBlock(PhongMaterialBlock& block) const
+{
+  Material::_writeBlock(block);
+
+  block.ambient = _mAmbient;
+  block.diffuse = _mDiffuse;
+  block.specular = _mSpecular;
+  block.shininess = _mShininess;
+  writeTexture(_mAmbientTex, _mAmbientUVIndex, block.ambientUVIndex, block.ambientHandle, block.ambientLayer);
+  writeTexture(_mDiffuseTex, _mDiffuseUVIndex, block.diffuseUVIndex, block.diffuseHandle, block.diffuseLayer);
+  writeTexture(_mSpecularTex, _mSpecularUVIndex, block.specularUVIndex, block.specularHandle, block.specularLayer);
+}
+
 void PhongMaterial::preRender()
 {
   Material::preRender();
 
-  bindTexUniform(diffuseTexUniform, diffuseUniform, diffuseTex, diffuse, DIFFUSE_TEX_IDX);
-  bindTexUniform(specularTexUniform, specularUniform, specularTex, specular, SPECULAR_TEX_IDX);
-  bindTexUniform(ambientTexUniform, ambientUniform, ambientTex, ambient, AMBIENT_TEX_IDX);
+  // the textures are reached through the block, only the fallback arrays need to be bound
+  TextureTable::bindArrays();
+}
 
-  if (diffuseUVIndexUniform) {
-    if (!diffuseTex)
-      diffuseUVIndexUniform->setUniform(-1);
-    else
-      diffuseUVIndexUniform->setUniform(diffuseUVIndex);
-  }
+void PhongMaterial::setDiffuseTex(Texture* tex, int uvIndex)
+{
+  _mDiffuseTex = tex;
+  _mDiffuseUVIndex = uvIndex;
+  _mBlock.markDirty();
+}
 
-  if (specularUVIndexUniform) {
-    if (!specularTex)
-      specularUVIndexUniform->setUniform(-1);
-    else
-      specularUVIndexUniform->setUniform(specularUVIndex);
-  }
+void PhongMaterial::setSpecularTex(Texture* tex, int uvIndex)
+{
+  _mSpecularTex = tex;
+  _mSpecularUVIndex = uvIndex;
+  _mBlock.markDirty();
+}
 
-  if (ambientUVIndexUniform) 
-  {
-    if (!ambientTex)
-      ambientUVIndexUniform->setUniform(-1);
-    else
-      ambientUVIndexUniform->setUniform(ambientUVIndex);
-  }
+void PhongMaterial::setAmbientTex(Texture* tex, int uvIndex)
+{
+  _mAmbientTex = tex;
+  _mAmbientUVIndex = uvIndex;
+  _mBlock.markDirty();
+}
+
+void PhongMaterial::setDiffuse(const glm::vec4& diffuse)
+{
+  _mDiffuse = diffuse;
+  _mBlock.markDirty();
+}
+
+void PhongMaterial::setSpecular(const glm::vec4& specular)
+{
+  _mSpecular = specular;
+  _mBlock.markDirty();
+}
 
-  if (shininessUniform)
-    shininessUniform->setUniform(shininess);
+void PhongMaterial::setAmbient(const glm::vec4& ambient)
+{
+  _mAmbient = ambient;
+  _mBlock.markDirty();
+}
+
+void PhongMaterial::setShininess(int shininess)
+{
+  _mShininess = shininess;
+  _mBlock.markDirty();
 }
 
 void PhongMaterial::copyTo(Cloneable* cloned) const
@@ -313,6 +374,6 @@ void ScreenShader::preRender()
 {
   if (_mScreenTextureUniform) {
     _mScreenTextureUniform->setUniform(0);
-    glBindTextureUnit(0, screenTextureId);
+    GLStateCache::bindTextureUnit(0, screenTextureId);
   }
 }
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 #include "../components/ShaderProgram.h"
 #include "../components/Texture.h"
+#include "../components/UniformBlockPool.h"
 #include "../utils/Cloneable.hpp"
 
 // an interface for all materials
 class MaterialBase : public Cloneable
 {
+private:
+  // for keeping track of number of materials made
+  static int objectCount;
+
+  // unique material id, based on objectCount
+  int _mUniqueId = ++objectCount;
+
 protected:
   ShaderProgram* _mProgram = nullptr;
   ShaderProgramManager* _mProgramManager = nullptr;
@@ -18,23 +26,69 @@ public:
   void use();
   virtual MaterialBase* clone() const override = 0;
   const ShaderProgram* getProgram() const { return _mProgram; }
+  int getUniqueId() const { return _mUniqueId; }
 
   std::string name;
 };
 
+// std140 layout of PhongMaterialBlock in Phong.fs. UV indices are -1 when there's no texture.
+// Textures are either bindless handles, or (texture array, layer) pairs when the handle is 0 - see TextureTable
+struct PhongMaterialBlock
+{
+  glm::vec4 ambient;
+  glm::vec4 diffuse;
+  glm::vec4 specular;
+  int ambientUVIndex;
+  int diffuseUVIndex;
+  int specularUVIndex;
+  int shininess;
+  float alphaCutoff;
+  float _pad0;
+  glm::uvec2 ambientHandle;
+  glm::uvec2 diffuseHandle;
+  glm::uvec2 specularHandle;
+  glm::ivec2 ambientLayer;
+  glm::ivec2 diffuseLayer;
+  glm::ivec2 specularLayer;
+  float _pad1[2];
+};
+
+static_assert(sizeof(PhongMaterialBlock) == 128, "PhongMaterialBlock doesn't match the std140 layout");
+
 class Material : public MaterialBase
 {
+public:
+  // uniform buffer binding of PhongMaterialBlock
+  static const GLuint MATERIAL_BINDING = 3;
+
+  // shader storage binding of the bone palettes (BoneBuffer in Phong.vs)
+  static const GLuint BONE_BUFFER_BINDING = 1;
+
 protected:
   Uniform* modelMatUniform = nullptr;
   Uniform* normalMatUniform = nullptr;
   Uniform* projViewModelMatUniform = nullptr;
-  Uniform* alphaCutoffUniform = nullptr;
-  Uniform* boneMatricesUniform = nullptr;
   Uniform* useBoneMatricesUniform = nullptr;
+  Uniform* useInstancingUniform = nullptr;
+  Uniform* useQuantizedVerticesUniform = nullptr;
+
+  // the material's parameters on the GPU, only rewritten after a setter changed something
+  UniformBlockHandle _mBlock{ _getBlockPool() };
+
+  // fragments with a lower alpha are discarded
+  float _mAlphaCutoff = .5f;
+
+  // every material of the Phong program shares one pool of parameter blocks
+  static UniformBlockPool& _getBlockPool();
+
+  // pack the parameters for the block
+  virtual void _writeBlock(PhongMaterialBlock& block) const;
 
 protected:
   // not public: has to generated with a factory method!
   Material();
+
+  // rewrite the parameter block if it's dirty, then bind it
   virtual void preRender() override;
   virtual void copyTo(Cloneable* cloned) const override;
 
@@ -48,14 +102,26 @@ public:
   void setProjViewModelMatrix(const glm::mat4& projViewModel);
   void setNormalMatrix(const glm::mat3& normal);
 
-  // for skeletal animation
-  void setBoneMatrices(const std::vector<glm::mat4>& matrices);
+  // for skeletal animation in immediate draws: upload the one palette that programs with setUseBoneTransform(true)
+  // read. Draws from the render queue carry their own palette offsets instead
+  static void setBoneMatrices(const std::vector<glm::mat4>& matrices);
   void setUseBoneTransform(bool use);
 
+  // for draws from the render queue: the matrices come from the instance buffer
+  void setUseInstancing(bool use);
+
+  // for immediate draws of quantized meshes: the normals have to be decoded. Queued draws carry this per instance
+  void setUseQuantizedVertices(bool use);
+
   // alpha cutoff of the material
-  float alphaCutoff = 0.f;
+  void setAlphaCutoff(float alphaCutoff);
+  float getAlphaCutoff() const { return _mAlphaCutoff; }
+
   bool useAlphaBlending = false;
 
+  // single sided: queued draws are drawn with GL_CULL_FACE on, and their meshlets facing away are culled up front
+  bool cullBackFaces = false;
+
   virtual Material* clone() const override;
 };
 
@@ -81,53 +147,48 @@ public:
 class PhongMaterial : public Material 
 {
 private:
-  // uniforms
-  Uniform* ambientTexUniform = nullptr;
-  static const int AMBIENT_TEX_IDX = 2;
-
-  Uniform* specularTexUniform = nullptr;
-  static const int SPECULAR_TEX_IDX = 1;
+  int _mDiffuseUVIndex = 0;
+  Texture* _mDiffuseTex = nullptr;
 
-  Uniform* diffuseTexUniform = nullptr;
-  static const int DIFFUSE_TEX_IDX = 0;
+  int _mSpecularUVIndex = 0;
+  Texture* _mSpecularTex = nullptr;
 
-  Uniform* diffuseUVIndexUniform = nullptr;
-  Uniform* diffuseUniform = nullptr;
+  int _mAmbientUVIndex = 0;
+  Texture* _mAmbientTex = nullptr;
 
-  Uniform* specularUVIndexUniform = nullptr;
-  Uniform* specularUniform = nullptr;
+  glm::vec4 _mDiffuse;
+  glm::vec4 _mSpecular;
+  glm::vec4 _mAmbient;
 
-  Uniform* ambientUVIndexUniform = nullptr;
-  Uniform* ambientUniform = nullptr;
-
-  Uniform* shininessUniform = nullptr;
+  int _mShininess = 32;
 
 protected:
   PhongMaterial();
   virtual void preRender();
   virtual void copyTo(Cloneable* cloned) const override;
-
-public:
-  // diffuse texture of the material
-  int diffuseUVIndex = 0;
-  Texture* diffuseTex = nullptr;
-  
-  int specularUVIndex = 0;
-  Texture* specularTex = nullptr;
-
-  int ambientUVIndex = 0;
-  Texture* ambientTex = nullptr;
-
-  glm::vec4 diffuse;
-  glm::vec4 specular;
-  glm::vec4 ambient;
-
-  int shininess = 32;
+  virtual void _writeBlock(PhongMaterialBlock& block) const override;
 
 public:
   PhongMaterial(ShaderProgramManager* manager);
   PhongMaterial(const PhongMaterial& other) = default;
   virtual ~PhongMaterial();
 
+  // textures of the material, and which UV channel they're sampled with
+  void setDiffuseTex(Texture* tex, int uvIndex = 0);
+  void setSpecularTex(Texture* tex, int uvIndex = 0);
+  void setAmbientTex(Texture* tex, int uvIndex = 0);
+  Texture* getDiffuseTex() const { return _mDiffuseTex; }
+  Texture* getSpecularTex() const { return _mSpecularTex; }
+  Texture* getAmbientTex() const { return _mAmbientTex; }
+
+  void setDiffuse(const glm::vec4& diffuse);
+  void setSpecular(const glm::vec4& specular);
+  void setAmbient(const glm::vec4& ambient);
+  void setShininess(int shininess);
+  const glm::vec4& getDiffuse() const { return _mDiffuse; }
+  const glm::vec4& getSpecular() const { return _mSpecular; }
+  const glm::vec4& getAmbient() const { return _mAmbient; }
+  int getShininess() const { return _mShininess; }
+
   virtual PhongMaterial* clone() const override;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Primitive.h"
 #include "../utils/Printer.hpp"
+#include "GLStateCache.h"
 
 // Primitive implementation
 int Primitive::objectCount = 0;
@@ -10,19 +11,19 @@ Primitive::Primitive()
 Primitive::~Primitive() 
 {}
 
-void Primitive::initArrayObject(const PrimitiveData* data)
+void Primitive::initArrayObject(const PrimitiveData* data, GeometryArena& arena)
 {
   // assuming all triangles
-  numVertices = data->vertices.size() / SIZE_POSITION;
-  numTexCoords = data->texCoords.size() / data->numComponents;
-  numTexCoords_2 = data->texCoords_2.size() / data->numComponents_2;
-  numTexCoords_3 = data->texCoords_3.size() / data->numComponents_3;
-  numNormals = data->normals.size() / SIZE_NORMAL;
-  numTangents = data->tangents.size() / SIZE_TANGENT;
-  numBitangents = data->bitangents.size() / SIZE_BITANGENT;
-  numFaces = data->indices.size() / SIZE_FACE;
-  numWeights = data->weights.size() / SIZE_WEIGHT;
-  numJoints = data->joints.size() / SIZE_JOINT;
+  unsigned int numVertices = data->vertices.size() / SIZE_POSITION;
+  unsigned int numTexCoords = data->texCoords.size() / data->numComponents;
+  unsigned int numTexCoords_2 = data->texCoords_2.size() / data->numComponents_2;
+  unsigned int numTexCoords_3 = data->texCoords_3.size() / data->numComponents_3;
+  unsigned int numNormals = data->normals.size() / SIZE_NORMAL;
+  unsigned int numTangents = data->tangents.size() / SIZE_TANGENT;
+  unsigned int numBitangents = data->bitangents.size() / SIZE_BITANGENT;
+  unsigned int numFaces = data->indices.size() / SIZE_FACE;
+  unsigned int numWeights = data->weights.size() / SIZE_WEIGHT;
+  unsigned int numJoints = data->joints.size() / SIZE_JOINT;
 
   if (numVertices == 0) 
   {
@@ -71,9 +72,17 @@ void Primitive::initArrayObject(const PrimitiveData* data)
 
   if (numFaces == 0) 
   {
-    Log.print<Severity::warning>("Trying to initialize a mesh without faces - using drawArrays by default!");
+    Log.print<Severity::warning>("Trying to initialize a mesh without faces - drawing the vertices in order by default!");
   }
 
+  // keep the bounds around, the vertices themselves are gone after the upload
+  _mLocalBounds = AABB();
+  for (unsigned int v = 0; v < numVertices; v++)
+  {
+    _mLocalBounds.expand(glm::vec3(data->vertices[v * 3], data->vertices[v * 3 + 1], data->vertices[v * 3 + 2]));
+  }
+  _mLocalSphere = BoundingSphere::fromPoints(data->vertices, _mLocalBounds);
+
   //Log.print<Severity::debug>("Printing vertices list for a primtive ---------------------!");
   //for (int v = 0; v < numVertices; v++) {
   //  int i = v * 3;
@@ -92,273 +101,62 @@ void Primitive::initArrayObject(const PrimitiveData* data)
   //  Log.print<Severity::debug>("Vertex: ", glmPrint::printVec(position), "\t joint: ", glmPrint::printVec(joint), "\t weight: ", glmPrint::printVec(weight));
   //}
 
-  glGenVertexArrays(1, &_mObjectVao);
-  glBindVertexArray(_mObjectVao);
-  _mHasObjectVao = true;
-
-  if (numVertices) 
-  {
-    // generate buffer object
-    glGenBuffers(1, &_mVerticesVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mVerticesVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->vertices[0]) * data->vertices.size(),
-      static_cast<const void*>(data->vertices.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define position vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_POSITION,  
-      Primitive::SIZE_POSITION,      
-      GL_FLOAT,                       
-      GL_FALSE,                        
-      Primitive::SIZE_POSITION * sizeof(data->vertices[0]),  
-      (void*)0                         
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_POSITION);
-
-    _mHasVerticesVbo = true;
-  }
-
-  if (numNormals) 
-  {
-    // generate buffer object
-    glGenBuffers(1, &_mNormalsVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mNormalsVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->normals[0]) * data->normals.size(),
-      static_cast<const void*>(data->normals.data()),
-      GL_STATIC_DRAW
-    );
-    // define normal vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_NORMAL,
-      Primitive::SIZE_NORMAL,
-      GL_FLOAT,
-      GL_FALSE,
-      Primitive::SIZE_NORMAL * sizeof(data->normals[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_NORMAL);
-
-    _mHasNormalsVbo = true;
-  }
-
-  if (numTexCoords) 
+  if ((numWeights > 0) != (numJoints > 0))
   {
-    // generate buffer object
-    glGenBuffers(1, &_mTexVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mTexVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->texCoords[0]) * data->texCoords.size(),
-      static_cast<const void*>(data->texCoords.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define texture vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_TEX,
-      data->numComponents,
-      GL_FLOAT,
-      GL_FALSE,
-      data->numComponents * sizeof(data->texCoords[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_TEX);
-
-    _mHasTexVbo = true;
-  }
-
-  if (numTexCoords_2)
-  {
-    // generate buffer object
-    glGenBuffers(1, &_mTexVbo_2);
-    glBindBuffer(GL_ARRAY_BUFFER, _mTexVbo_2);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->texCoords_2[0]) * data->texCoords_2.size(),
-      static_cast<const void*>(data->texCoords_2.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define texture vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_TEX_2,
-      data->numComponents_2,
-      GL_FLOAT,
-      GL_FALSE,
-      data->numComponents_2 * sizeof(data->texCoords_2[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_TEX_2);
-
-    _mHasTexVbo_2 = true;
-  }
-
-  if (numTexCoords_3)
-  {
-    // generate buffer object
-    glGenBuffers(1, &_mTexVbo_3);
-    glBindBuffer(GL_ARRAY_BUFFER, _mTexVbo_3);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->texCoords_3[0]) * data->texCoords_3.size(),
-      static_cast<const void*>(data->texCoords_3.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define texture vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_TEX_3,
-      data->numComponents_3,
-      GL_FLOAT,
-      GL_FALSE,
-      data->numComponents_3 * sizeof(data->texCoords_3[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_TEX_3);
-
-    _mHasTexVbo_3 = true;
+    Log.print<Severity::warning>("Only has one of weights and joints!");
   }
 
-  if (numTangents)
+  _mHasGeometry = arena.allocate(*data, _mGeometry);
+  if (!_mHasGeometry)
   {
-    // generate buffer object
-    glGenBuffers(1, &_mTangentsVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mTangentsVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->tangents[0])* data->tangents.size(),
-      static_cast<const void*>(data->tangents.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define texture vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_TANGENT,
-      Primitive::SIZE_TANGENT,
-      GL_FLOAT,
-      GL_FALSE,
-      Primitive::SIZE_TANGENT * sizeof(data->tangents[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_TANGENT);
-
-    _mHasTangentsVbo = true;
+    Log.print<Severity::warning>("Mesh ", _mUniqueId, " could not be uploaded into its geometry arena!");
+    return;
   }
 
-  if (numBitangents)
-  {
-    // generate buffer object
-    glGenBuffers(1, &_mBitangentsVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mBitangentsVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->bitangents[0]) * data->bitangents.size(),
-      static_cast<const void*>(data->bitangents.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define texture vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_BITANGENT,
-      Primitive::SIZE_BITANGENT,
-      GL_FLOAT,
-      GL_FALSE,
-      Primitive::SIZE_BITANGENT * sizeof(data->bitangents[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_BITANGENT);
-
-    _mHasBitangentsVbo = true;
-  }
+  PrimitiveLod full;
+  full.firstIndex = _mGeometry.firstIndex;
+  full.numIndices = _mGeometry.numIndices;
+  _mLods.push_back(full);
 
-  if (numWeights)
-  {
-    // generate buffer object
-    glGenBuffers(1, &_mWeightsVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mWeightsVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->weights[0])* data->weights.size(),
-      static_cast<const void*>(data->weights.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define texture vertex attribute
-    glVertexAttribPointer(
-      Primitive::ATTRIBUTE_WEIGHT,
-      Primitive::SIZE_WEIGHT,
-      GL_FLOAT,
-      GL_FALSE,
-      Primitive::SIZE_WEIGHT * sizeof(data->weights[0]),
-      nullptr
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_WEIGHT);
-
-    _mHasWeightsVbo = true;
-  }
+  _mMeshlets = data->meshlets;
+  for (Meshlet& meshlet : _mMeshlets)
+    meshlet.firstIndex += _mGeometry.firstIndex;
 
-  if (numJoints)
+  // the simplified levels go right after it in the same arena, over the same vertices
+  for (const PrimitiveLodData& lodData : data->lods)
   {
-    // generate buffer object
-    glGenBuffers(1, &_mJointsVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _mJointsVbo);
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(data->joints[0])* data->joints.size(),
-      static_cast<const void*>(data->joints.data()),
-      GL_STATIC_DRAW
-    );
-
-    // define INTEGER vertex attribute pointer
-    glVertexAttribIPointer(
-      Primitive::ATTRIBUTE_JOINT,
-      Primitive::SIZE_JOINT,
-      GL_UNSIGNED_INT,
-      Primitive::SIZE_JOINT * sizeof(data->joints[0]),
-      (void*)0
-    );
-    glEnableVertexAttribArray(Primitive::ATTRIBUTE_JOINT);
-
-    _mHasJointsVbo = true;
-  }
+    PrimitiveLod lod;
+    if (!arena.allocateIndices(lodData.indices, lod.firstIndex)) break;
 
-  if (_mHasJointsVbo != _mHasWeightsVbo)
-  {
-    Log.print<Severity::warning>("Only has one of weights and joints!");
+    lod.numIndices = (unsigned int)lodData.indices.size();
+    lod.error = lodData.error;
+    _mLods.push_back(lod);
   }
+}
 
-  if (numFaces)
+int Primitive::selectLod(float pixelsPerUnit, float maxPixelError) const
+{
+  for (int lod = (int)_mLods.size() - 1; lod > 0; lod--)
   {
-    glGenBuffers(1, &_mIndicesEbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _mIndicesEbo);
-    glBufferData(
-      GL_ELEMENT_ARRAY_BUFFER,
-      sizeof(data->indices[0]) * data->indices.size(),
-      static_cast<const void*>(data->indices.data()),
-      GL_STATIC_DRAW
-    );
-
-    _mHasIndicesEbo = true;
+    if (_mLods[lod].error * pixelsPerUnit <= maxPixelError) return lod;
   }
-
-  glBindVertexArray(0);
+  return 0;
 }
 
 void Primitive::bindVao() const
 {
-  if (!_mHasObjectVao)
+  if (!_mHasGeometry)
   {
     Log.print<Severity::warning>("Mesh ", _mUniqueId, "'s VAO is not initialized yet!");
     return;
   }
 
-  glBindVertexArray(_mObjectVao);
+  _mGeometry.arena->bind();
+}
+
+bool Primitive::isQuantized() const
+{
+  return _mHasGeometry && _mGeometry.arena->getFormat().isQuantized();
 }
 
 void Primitive::addObservable(PrimitiveObservable* o)
@@ -372,118 +170,78 @@ void Primitive::removeObservable(PrimitiveObservable* o)
 }
 
 void Primitive::render() const
+{
+  renderInstanced(1);
+}
+
+void Primitive::prepareRender() const
 {
   for (auto observer : observers)
   {
     observer->onShouldRender(this);
   }
-
-  if (_mHasIndicesEbo) 
-  {
-    glDrawElements(GL_TRIANGLES, numFaces * 3, GL_UNSIGNED_INT, 0);
-  }
-  else if (_mHasVerticesVbo) 
-  {
-    glDrawArrays(GL_TRIANGLES, 0, numVertices);
-  }
-  else 
-  {
-    Log.print<Severity::warning>("Mesh ", _mUniqueId, " does not have vertices!");
-  }
-
-  GLenum err;
-  while ((err = glGetError()) != GL_NO_ERROR)
-  {
-    Log.print<Severity::warning>("Encountered a GL error: ", err);
-    std::string error;
-    switch (err)
-    {
-    case GL_INVALID_ENUM:                  error = "INVALID_ENUM"; break;
-    case GL_INVALID_VALUE:                 error = "INVALID_VALUE"; break;
-    case GL_INVALID_OPERATION:             error = "INVALID_OPERATION"; break;
-    case GL_STACK_OVERFLOW:                error = "STACK_OVERFLOW"; break;
-    case GL_STACK_UNDERFLOW:               error = "STACK_UNDERFLOW"; break;
-    case GL_OUT_OF_MEMORY:                 error = "OUT_OF_MEMORY"; break;
-    case GL_INVALID_FRAMEBUFFER_OPERATION: error = "INVALID_FRAMEBUFFER_OPERATION"; break;
-    }
-    //std::cout << error << " | " << file << " (" << line << ")" << std::endl;
-    Log.print<Severity::warning>("Error summary: ", error);
-  }
 }
 
-void Primitive::deleteArrayObject()
+void Primitive::renderInstanced(int instanceCount, int baseInstance, int lod) const
 {
-  if (_mHasVerticesVbo)
+  // renderRange warns about the missing vertices
+  if (_mLods.empty())
   {
-    glDeleteBuffers(1, &_mVerticesVbo);
-    _mHasVerticesVbo = false;
+    renderRange(0, 0, instanceCount, baseInstance);
+    return;
   }
 
-  if (_mHasNormalsVbo)
-  {
-    glDeleteBuffers(1, &_mNormalsVbo);
-    _mHasNormalsVbo = false;
-  }
+  const PrimitiveLod& range = _mLods[glm::clamp(lod, 0, (int)_mLods.size() - 1)];
+  renderRange(range.firstIndex, range.numIndices, instanceCount, baseInstance);
+}
 
-  if (_mHasTangentsVbo)
-  {
-    glDeleteBuffers(1, &_mTangentsVbo);
-    _mHasTangentsVbo = false;
-  }
+void Primitive::renderRange(unsigned int firstIndex, unsigned int numIndices, int instanceCount, int baseInstance) const
+{
+  if (instanceCount <= 0) return;
 
-  if (_mHasBitangentsVbo)
-  {
-    glDeleteBuffers(1, &_mBitangentsVbo);
-    _mHasBitangentsVbo = false;
-  }
+  prepareRender();
 
-  if (_mHasTexVbo)
+  if (!_mHasGeometry)
   {
-    glDeleteBuffers(1, &_mTexVbo);
-    _mTexVbo = false;
+    Log.print<Severity::warning>("Mesh ", _mUniqueId, " does not have vertices!");
+    return;
   }
 
-  if (_mHasTexVbo_2)
+  // indices are relative to the mesh's first vertex in the arena
+  const VertexFormat& format = _mGeometry.arena->getFormat();
+  const void* indexOffset = (const void*)((size_t)firstIndex * format.getIndexSize());
+  if (instanceCount == 1 && baseInstance == 0)
   {
-    glDeleteBuffers(1, &_mTexVbo_2);
-    _mTexVbo_2 = false;
+    glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, format.indexType, indexOffset, _mGeometry.baseVertex);
   }
-
-  if (_mHasTexVbo_3)
+  else
   {
-    glDeleteBuffers(1, &_mTexVbo_3);
-    _mTexVbo_3 = false;
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, numIndices, format.indexType, indexOffset,
+      instanceCount, _mGeometry.baseVertex, baseInstance);
   }
 
-  if (_mHasWeightsVbo)
-  {
-    glDeleteBuffers(1, &_mWeightsVbo);
-    _mWeightsVbo = false;
-  }
-
-  if (_mHasJointsVbo)
-  {
-    glDeleteBuffers(1, &_mJointsVbo);
-    _mJointsVbo = false;
-  }
+  GLStateCache::checkErrors("Primitive::render");
+}
 
-  if (_mHasIndicesEbo)
+void Primitive::deleteArrayObject()
+{
+  if (_mHasGeometry)
   {
-    glDeleteBuffers(1, &_mIndicesEbo);
-    _mIndicesEbo = false;
-  }
+    for (size_t lod = 1; lod < _mLods.size(); lod++)
+      _mGeometry.arena->freeIndices(_mLods[lod].firstIndex, _mLods[lod].numIndices);
+    _mLods.clear();
+    _mMeshlets.clear();
 
-  if (_mHasObjectVao)
-  {
-    glDeleteVertexArrays(1, &_mObjectVao);
-    _mHasObjectVao = false;
+    _mGeometry.arena->free(_mGeometry);
+    _mGeometry = GeometryRange();
+    _mHasGeometry = false;
   }
 }
 
 Primitive* const PrimitiveManager::create(const std::string& key, const PrimitiveData& data)
 {
   Primitive* p = new Primitive();
-  p->initArrayObject(&data);
+  p->initArrayObject(&data, *_getArena(VertexFormat::fromData(data)));
   p->addObservable(this);
   return p;
 }
@@ -497,17 +255,32 @@ void PrimitiveManager::destroy(Primitive* const value)
 PrimitiveManager::PrimitiveManager()
 {}
 
-void PrimitiveManager::onShouldRender(const Primitive* d)
+PrimitiveManager::~PrimitiveManager()
 {
-  if (_lastDrawnPrimitive != d)
+  // the primitives have to give their ranges back before the arenas go
+  clear();
+
+  for (GeometryArena* arena : _mArenas)
+    delete arena;
+}
+
+GeometryArena* PrimitiveManager::_getArena(const VertexFormat& format)
+{
+  for (GeometryArena* arena : _mArenas)
   {
-    _lastDrawnPrimitive = d;
-    _lastDrawnPrimitive->bindVao();
+    if (arena->getFormat() == format) return arena;
   }
+
+  GeometryArena* arena = new GeometryArena(format, (int)_mArenas.size());
+  _mArenas.push_back(arena);
+  return arena;
 }
 
-void PrimitiveManager::update(float deltaT)
+void PrimitiveManager::onShouldRender(const Primitive* d)
 {
-  // resets the last drawn primitive to prevent errors
-  _lastDrawnPrimitive = nullptr;
-}
\ No newline at end of file
+  // every primitive in an arena shares its VAO, and GLStateCache drops the bind if it's already bound
+  d->bindVao();
+}
+
+void PrimitiveManager::update(float deltaT)
+{}
\ No newline at end of file
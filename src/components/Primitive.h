@@ -7,6 +7,35 @@
 #include <set>
 #include "../utils/Logger.h"
 #include "../utils/ResourceManager.hpp"
+#include "../utils/Bounds.h"
+#include "GeometryArena.h"
+#include "VertexLayout.h"
+
+// a simplified version of a mesh: its own indices over the same vertices, and how far it strays from the full mesh
+struct PrimitiveLodData
+{
+  std::vector<unsigned int> indices;
+
+  // in the mesh's own units
+  float error = 0.f;
+};
+
+// a cluster of nearby triangles (see MeshOptimizer::buildMeshlets), culled on its own and drawn as a range of the
+// mesh's full detail indices
+struct Meshlet
+{
+  // relative to the mesh's indices in PrimitiveData, to the arena's index buffer in a Primitive
+  unsigned int firstIndex = 0;
+  unsigned int numIndices = 0;
+
+  glm::vec3 center = glm::vec3(0);
+  float radius = 0.f;
+
+  // every triangle faces away from a viewer at p if dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius.
+  // A cutoff of 1 never passes, for normals spread too wide to bound
+  glm::vec3 coneAxis = glm::vec3(0, 0, 1);
+  float coneCutoff = 1.f;
+};
 
 // used for storing primitive data
 struct PrimitiveData {
@@ -25,6 +54,24 @@ struct PrimitiveData {
   std::vector<float> weights;
   std::vector<unsigned int> joints;
   std::vector<unsigned int> indices;
+
+  // store the mesh in a quantized layout, with 16 bit indices if it has few enough vertices.
+  // Meshes with joints past 255 keep the full layout
+  bool quantize = false;
+
+  // coarser and coarser levels of detail after the full mesh, see MeshOptimizer::buildLods
+  std::vector<PrimitiveLodData> lods;
+
+  // clusters of the full detail indices, back to back in index order. Empty to always draw the mesh whole
+  std::vector<Meshlet> meshlets;
+};
+
+// one level of detail in the arena. Level 0 is the full mesh
+struct PrimitiveLod
+{
+  unsigned int firstIndex = 0;
+  unsigned int numIndices = 0;
+  float error = 0.f;
 };
 
 class Primitive;
@@ -34,9 +81,9 @@ public:
   virtual void onShouldRender(const Primitive* p) = 0;
 };
 
-// NOTE: this class does not support interleaved buffer for now...
-// Only reason for an interleaved buffer would be performance gain
-// But I will not focus on getting more performance for now
+// The vertices and indices live in a GeometryArena shared with every other mesh of the same vertex layout,
+// so a primitive is just a range in the arena's buffers. Vertices are interleaved (see the layouts below),
+// PrimitiveData only keeps the attributes apart until the upload.
 class Primitive
 {
 private:
@@ -46,62 +93,22 @@ private:
   // unique object id, based on objectCount
   int _mUniqueId;
 
-  // vertex position
-  unsigned int numVertices    = 0;
-  bool _mHasVerticesVbo       = false;
-  unsigned int _mVerticesVbo  = 0;
-
-  // vertex normal
-  unsigned int numNormals     = 0;
-  bool _mHasNormalsVbo        = false;
-  unsigned int _mNormalsVbo   = 0;
-
-  // vertex texture coordinate
-  unsigned int numTexCoords   = 0;
-  bool _mHasTexVbo            = false;
-  unsigned int _mTexVbo       = 0;
-
-  // vertex texture coordinate 2
-  unsigned int numTexCoords_2 = 0;
-  bool _mHasTexVbo_2          = false;
-  unsigned int _mTexVbo_2     = 0;
-
-  // vertex texture coordinate 3
-  unsigned int numTexCoords_3 = 0;
-  bool _mHasTexVbo_3          = false;
-  unsigned int _mTexVbo_3     = 0;
-
-  // vertex tangent
-  unsigned int numTangents    = 0;
-  bool _mHasTangentsVbo       = false;
-  unsigned int _mTangentsVbo  = 0;
-
-  // vertex bitangent
-  unsigned int numBitangents  = 0;
-  bool _mHasBitangentsVbo     = false;
-  unsigned int _mBitangentsVbo = 0;
-
-  // bone weights
-  unsigned int numWeights     = 0;
-  bool _mHasWeightsVbo        = false;
-  unsigned int _mWeightsVbo   = 0;
-
-  // bone joints
-  unsigned int numJoints      = 0;
-  bool _mHasJointsVbo         = false;
-  unsigned int _mJointsVbo    = 0;
-
-  // triangular faces
-  unsigned int numFaces       = 0;
-  bool _mHasIndicesEbo        = false;
-  unsigned int _mIndicesEbo   = 0;
-
-  // object VAO
-  bool _mHasObjectVao         = false;
-  unsigned int _mObjectVao    = 0;
+  // where the vertices and indices are
+  GeometryRange _mGeometry;
+  bool _mHasGeometry = false;
+
+  // the full mesh first, then the simplified ones. All of them index the same vertices
+  std::vector<PrimitiveLod> _mLods;
+
+  // clusters of the full mesh, in the order of their index ranges
+  std::vector<Meshlet> _mMeshlets;
 
   std::set<PrimitiveObservable*> observers;
 
+  // bounds of the vertex positions, computed when the data is uploaded
+  AABB _mLocalBounds;
+  BoundingSphere _mLocalSphere;
+
 public:
   static const int ATTRIBUTE_POSITION   = 0;
   static const int ATTRIBUTE_NORMAL     = 1;
@@ -125,32 +132,116 @@ public:
   static const int MAX_TEX_COORDINATE_SUPPORTED = 3;
 
 public:
+  int getUniqueId() const { return _mUniqueId; }
+
   virtual void bindVao() const;
   virtual void render() const;
 
+  // draw instanceCount copies of a level of detail in one call. The shader finds its per-instance data at
+  // gl_BaseInstance + gl_InstanceID
+  virtual void renderInstanced(int instanceCount, int baseInstance = 0, int lod = 0) const;
+
+  // same, for any range of the arena's index buffer, e.g. the visible meshlets
+  virtual void renderRange(unsigned int firstIndex, unsigned int numIndices, int instanceCount, int baseInstance = 0) const;
+
+  // let the observers know this primitive is about to be drawn (the manager binds the VAO), without drawing it.
+  // For draws issued by someone else, e.g. indirect draws of the whole arena
+  void prepareRender() const;
+
+  // the arena range with the vertices and indices
+  const GeometryRange& getGeometry() const { return _mGeometry; }
+
+  // true if the vertices are in a quantized layout, which the shaders have to decode
+  bool isQuantized() const;
+
+  int getLodCount() const { return (int)_mLods.size(); }
+  const PrimitiveLod& getLod(int lod) const { return _mLods[lod]; }
+
+  // the coarsest level whose error stays under maxPixelError, for a mesh covering pixelsPerUnit pixels per unit of
+  // its own space
+  int selectLod(float pixelsPerUnit, float maxPixelError) const;
+
+  const std::vector<Meshlet>& getMeshlets() const { return _mMeshlets; }
+
   void addObservable(PrimitiveObservable* o);
   void removeObservable(PrimitiveObservable* o);
 
-  // should be called after setting all the vertex attributes below!
-  void initArrayObject(const PrimitiveData* data);
+  // upload the mesh into an arena with its vertex format, and free it again
+  void initArrayObject(const PrimitiveData* data, GeometryArena& arena);
   void deleteArrayObject();
 
+  // bounds in the primitive's own space. Skinned meshes are bounded in their bind pose
+  const AABB& getLocalBounds() const { return _mLocalBounds; }
+  const BoundingSphere& getLocalSphere() const { return _mLocalSphere; }
+
   Primitive();
   virtual ~Primitive();
 };
 
+// The layouts meshes are stored in, smallest first. A mesh goes into the first one with every attribute it has;
+// anything the layout has on top of that is zero. Tex coordinates are kept as 2 components, which is all the shaders read
+typedef VertexAttribute<Primitive::ATTRIBUTE_POSITION, VertexEncoding::Float, Primitive::SIZE_POSITION> PositionAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_NORMAL, VertexEncoding::Float, Primitive::SIZE_NORMAL> NormalAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TEX, VertexEncoding::Float, 2> TexAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TANGENT, VertexEncoding::Float, Primitive::SIZE_TANGENT> TangentAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_BITANGENT, VertexEncoding::Float, Primitive::SIZE_BITANGENT> BitangentAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_WEIGHT, VertexEncoding::Float, Primitive::SIZE_WEIGHT> WeightAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_JOINT, VertexEncoding::UInt, Primitive::SIZE_JOINT> JointAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TEX_2, VertexEncoding::Float, 2> Tex2Attribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TEX_3, VertexEncoding::Float, 2> Tex3Attribute;
+
+typedef VertexLayout<PositionAttribute, NormalAttribute, TexAttribute> StaticVertexLayout;
+typedef VertexLayout<PositionAttribute, NormalAttribute, TexAttribute, TangentAttribute, BitangentAttribute> TangentVertexLayout;
+typedef VertexLayout<PositionAttribute, NormalAttribute, TexAttribute, WeightAttribute, JointAttribute> SkinnedVertexLayout;
+typedef VertexLayout<PositionAttribute, NormalAttribute, TexAttribute, TangentAttribute, BitangentAttribute,
+  WeightAttribute, JointAttribute> SkinnedTangentVertexLayout;
+typedef VertexLayout<PositionAttribute, NormalAttribute, TexAttribute, TangentAttribute, BitangentAttribute,
+  WeightAttribute, JointAttribute, Tex2Attribute, Tex3Attribute> FullVertexLayout;
+
+// quantized versions of the same layouts (PrimitiveData::quantize): octahedral normals and tangents, half float
+// tex coordinates, unorm8 weights and 8 bit joints. Positions stay full floats. Phong.vs decodes the normals when
+// useQuantizedVertices is set, everything else comes out of the attribute fetch as is
+typedef VertexAttribute<Primitive::ATTRIBUTE_NORMAL, VertexEncoding::Octahedral, 2> QuantizedNormalAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TEX, VertexEncoding::Half, 2> QuantizedTexAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TANGENT, VertexEncoding::Octahedral, 2> QuantizedTangentAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_BITANGENT, VertexEncoding::Octahedral, 2> QuantizedBitangentAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_WEIGHT, VertexEncoding::Unorm8, Primitive::SIZE_WEIGHT> QuantizedWeightAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_JOINT, VertexEncoding::UByte, Primitive::SIZE_JOINT> QuantizedJointAttribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TEX_2, VertexEncoding::Half, 2> QuantizedTex2Attribute;
+typedef VertexAttribute<Primitive::ATTRIBUTE_TEX_3, VertexEncoding::Half, 2> QuantizedTex3Attribute;
+
+typedef VertexLayout<PositionAttribute, QuantizedNormalAttribute, QuantizedTexAttribute> QuantizedStaticVertexLayout;
+typedef VertexLayout<PositionAttribute, QuantizedNormalAttribute, QuantizedTexAttribute,
+  QuantizedTangentAttribute, QuantizedBitangentAttribute> QuantizedTangentVertexLayout;
+typedef VertexLayout<PositionAttribute, QuantizedNormalAttribute, QuantizedTexAttribute,
+  QuantizedWeightAttribute, QuantizedJointAttribute> QuantizedSkinnedVertexLayout;
+typedef VertexLayout<PositionAttribute, QuantizedNormalAttribute, QuantizedTexAttribute, QuantizedTangentAttribute,
+  QuantizedBitangentAttribute, QuantizedWeightAttribute, QuantizedJointAttribute> QuantizedSkinnedTangentVertexLayout;
+typedef VertexLayout<PositionAttribute, QuantizedNormalAttribute, QuantizedTexAttribute, QuantizedTangentAttribute,
+  QuantizedBitangentAttribute, QuantizedWeightAttribute, QuantizedJointAttribute,
+  QuantizedTex2Attribute, QuantizedTex3Attribute> QuantizedFullVertexLayout;
+
+static_assert(StaticVertexLayout::stride() == 32, "StaticVertexLayout should be 32 bytes");
+static_assert(FullVertexLayout::stride() == 104, "FullVertexLayout should be 104 bytes");
+static_assert(QuantizedStaticVertexLayout::stride() == 20, "QuantizedStaticVertexLayout should be 20 bytes");
+static_assert(QuantizedFullVertexLayout::stride() == 44, "QuantizedFullVertexLayout should be 44 bytes");
+
 class PrimitiveManager : public ResourceManager<std::string, PrimitiveData, Primitive>, public PrimitiveObservable
 {
 protected:
   Primitive* const create(const std::string& key, const PrimitiveData& data) override;
   void destroy(Primitive* const value);
 
-  // manages when a primitive is drawn...
-  const Primitive* _lastDrawnPrimitive = nullptr;
+  // one arena per vertex format
+  std::vector<GeometryArena*> _mArenas;
+
+  GeometryArena* _getArena(const VertexFormat& format);
 
 public:
   PrimitiveManager();
-  virtual ~PrimitiveManager() { clear(); }
+  virtual ~PrimitiveManager();
   virtual void onShouldRender(const Primitive* p) override;
   virtual void update(float deltaT);
+
+  const std::vector<GeometryArena*>& getArenas() const { return _mArenas; }
 };
\ No newline at end of file
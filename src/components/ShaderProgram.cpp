@@ -1,4 +1,5 @@
 #include "ShaderProgram.h"
+#include "GLStateCache.h"
 
 // ShaderProgramInfo
 ShaderProgramData::ShaderProgramData(
@@ -57,6 +58,7 @@ void checkProgramLinkingError(unsigned int programId)
     Log.print<Severity::error>("Linking of shader program failed!");
     Log.print<Severity::error>(infoLog);
 
+    GLStateCache::forgetProgram(programId);
     glDeleteProgram(programId);
     throw std::exception("Failed to link shader program");
   }
@@ -75,6 +77,12 @@ void ShaderProgram::parseProgramInfo()
     GLenum type;    // data type
     glGetActiveUniform(_mId, idx, sizeof(name), &length, &size, &type, name);
 
+    // members of uniform blocks have no location, they're filled through buffers instead
+    GLuint uIdx = (GLuint)idx;
+    GLint blockIdx;
+    glGetActiveUniformsiv(_mId, 1, &uIdx, GL_UNIFORM_BLOCK_INDEX, &blockIdx);
+    if (blockIdx != -1) continue;
+
     std::string sName(name);
     Uniform* uniform = new Uniform(_mId, idx, type, size, sName);
     _mUniforms.push_back(uniform);
@@ -167,6 +175,7 @@ void ShaderProgram::deleteShaderProgram()
 {
   if (_mIsLoaded)
   {
+    GLStateCache::forgetProgram(_mId);
     glDeleteProgram(_mId);
     Log.print<Severity::info>("Shader Program successfully deleted!");
 
@@ -219,7 +228,7 @@ bool ShaderProgram::isLoaded() const
 
 void ShaderProgram::use() const
 {
-  glUseProgram(_mId);
+  GLStateCache::useProgram(_mId);
 }
 
 // Shader Program Manager
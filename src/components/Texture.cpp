@@ -1,4 +1,6 @@
 #include "Texture.h"
+#include "GLStateCache.h"
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -21,7 +23,12 @@ Texture::~Texture()
 {
   if (_mIsLoaded)
   {
-    glDeleteTextures(1, &_mId);
+    TextureTable::remove(_mRef);
+    if (_mId)
+    {
+      GLStateCache::forgetTexture(_mId);
+      glDeleteTextures(1, &_mId);
+    }
   }
 }
 
@@ -53,7 +60,15 @@ bool Texture::processStbiData(unsigned char* data)
   }
   glTextureParameteri(_mId, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  glTextureStorage2D(_mId, 1, GL_RGBA8, _mWidth, _mHeight);
+  // room for the whole mip chain, otherwise there's nothing to generate the mipmaps into
+  _mLevels = 1;
+  if (_mUseMipMap)
+  {
+    while ((std::max(_mWidth, _mHeight) >> _mLevels) > 0)
+      _mLevels++;
+  }
+
+  glTextureStorage2D(_mId, _mLevels, GL_RGBA8, _mWidth, _mHeight);
   glTextureSubImage2D(_mId, 0, 0, 0, _mWidth, _mHeight, imageType, GL_UNSIGNED_BYTE, data);
 
   // generate mipmap
@@ -65,6 +80,15 @@ bool Texture::processStbiData(unsigned char* data)
 
   // remember the settings
   _mIsLoaded = true;
+  _mRef = TextureTable::add(*this);
+
+  // copied into a texture array layer, which is all the shaders sample. Keeping the original would double the memory
+  if (_mRef.array >= 0)
+  {
+    GLStateCache::forgetTexture(_mId);
+    glDeleteTextures(1, &_mId);
+    _mId = 0;
+  }
   return true;
 }
 
@@ -148,9 +172,7 @@ glm::ivec2 Texture::getDimension() const
 
 void Texture::bind(GLenum activeTarget) const 
 {
-  glBindTextureUnit(activeTarget, _mId);
-  //glActiveTexture(GL_TEXTURE0 + activeTarget);
-  //glBindTexture(GL_TEXTURE_2D, _mId);
+  GLStateCache::bindTextureUnit(activeTarget, _mId);
 }
 
 // texture manager implementation
@@ -5,6 +5,7 @@
 #include <assimp/scene.h>
 #include "../utils/ResourceManager.hpp"
 #include "../utils/Logger.h"
+#include "TextureTable.h"
 
 // information needed to initialize a texture
 class TextureData
@@ -48,6 +49,10 @@ protected:
 
   std::string _mPath;
   bool _mUseMipMap = false;
+  int _mLevels = 1;
+
+  // how material blocks reach the texture
+  TextureRef _mRef;
 
   bool processStbiData(unsigned char* data);
 
@@ -61,8 +66,11 @@ public:
   // getters
   glm::ivec2 getDimension() const;
   unsigned int getId() const { return _mId; }
+  int getLevels() const { return _mLevels; }
+  const TextureRef& getRef() const { return _mRef; }
 
-  // bind texture to an active target
+  // bind texture to an active target. Textures that went into a TextureTable array have no texture of their own
+  // (getId() is 0), use their ref instead
   virtual void bind(GLenum activeTarget) const;
 };
 
@@ -0,0 +1,174 @@
+#include "TextureTable.h"
+#include "Texture.h"
+#include "GLStateCache.h"
+#include "../utils/Logger.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+
+namespace
+{
+  // ARB_bindless_texture isn't part of the generated glad loader, so its entry points are fetched here
+  typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+  typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+  typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+  PFNGLGETTEXTUREHANDLEARBPROC getTextureHandle = nullptr;
+  PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeTextureHandleResident = nullptr;
+  PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeTextureHandleNonResident = nullptr;
+}
+
+bool TextureTable::_sIsInitialized = false;
+bool TextureTable::_sUseBindless = false;
+std::vector<TextureTable::Bucket> TextureTable::_sBuckets;
+
+void TextureTable::_init()
+{
+  _sIsInitialized = true;
+
+  if (glfwExtensionSupported("GL_ARB_bindless_texture"))
+  {
+    getTextureHandle = (PFNGLGETTEXTUREHANDLEARBPROC)glfwGetProcAddress("glGetTextureHandleARB");
+    makeTextureHandleResident = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)glfwGetProcAddress("glMakeTextureHandleResidentARB");
+    makeTextureHandleNonResident = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+    _sUseBindless = getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident;
+  }
+
+  if (_sUseBindless)
+    Log.print<Severity::info>("Using bindless textures");
+  else
+    Log.print<Severity::info>("Bindless textures are not supported, using texture arrays");
+}
+
+bool TextureTable::isBindless()
+{
+  if (!_sIsInitialized) _init();
+  return _sUseBindless;
+}
+
+void TextureTable::_growBucket(Bucket& bucket)
+{
+  int capacity = bucket.capacity ? bucket.capacity * 2 : 4;
+
+  GLuint array;
+  glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array);
+  glTextureParameteri(array, GL_TEXTURE_WRAP_S, bucket.sampler.wrapS);
+  glTextureParameteri(array, GL_TEXTURE_WRAP_T, bucket.sampler.wrapT);
+  glTextureParameteri(array, GL_TEXTURE_MIN_FILTER, bucket.sampler.minFilter);
+  glTextureParameteri(array, GL_TEXTURE_MAG_FILTER, bucket.sampler.magFilter);
+  glTextureStorage3D(array, bucket.levels, GL_RGBA8, bucket.width, bucket.height, capacity);
+
+  if (bucket.array)
+  {
+    // move every layer over, all mip levels
+    if (bucket.numLayers > 0)
+    {
+      for (int level = 0; level < bucket.levels; level++)
+      {
+        glCopyImageSubData(bucket.array, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, array, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+          std::max(1, bucket.width >> level), std::max(1, bucket.height >> level), bucket.numLayers);
+      }
+    }
+    GLStateCache::forgetTexture(bucket.array);
+    glDeleteTextures(1, &bucket.array);
+  }
+
+  bucket.array = array;
+  bucket.capacity = capacity;
+}
+
+void TextureTable::_allocateLayer(int width, int height, int levels, const SamplerState& sampler, int& array, int& layer)
+{
+  array = -1;
+  layer = -1;
+
+  for (int i = 0; i < (int)_sBuckets.size(); i++)
+  {
+    Bucket& bucket = _sBuckets[i];
+    if (bucket.width != width || bucket.height != height || bucket.levels != levels || !(bucket.sampler == sampler)) continue;
+
+    array = i;
+    if (!bucket.freeLayers.empty())
+    {
+      layer = bucket.freeLayers.back();
+      bucket.freeLayers.pop_back();
+      return;
+    }
+
+    if (bucket.numLayers == bucket.capacity)
+      _growBucket(bucket);
+    layer = bucket.numLayers++;
+    return;
+  }
+
+  if ((int)_sBuckets.size() == MAX_ARRAYS) return;
+
+  Bucket bucket;
+  bucket.width = width;
+  bucket.height = height;
+  bucket.levels = levels;
+  bucket.sampler = sampler;
+  bucket.array = 0;
+  bucket.capacity = 0;
+  bucket.numLayers = 0;
+  _growBucket(bucket);
+
+  array = (int)_sBuckets.size();
+  layer = bucket.numLayers++;
+  _sBuckets.push_back(bucket);
+}
+
+TextureRef TextureTable::add(const Texture& texture)
+{
+  if (!_sIsInitialized) _init();
+
+  TextureRef ref;
+  if (_sUseBindless)
+  {
+    ref.handle = getTextureHandle(texture.getId());
+    if (ref.handle)
+      makeTextureHandleResident(ref.handle);
+    else
+      Log.print<Severity::warning>("Failed to get a bindless handle for texture ", texture.getId());
+    return ref;
+  }
+
+  glm::ivec2 size = texture.getDimension();
+  int levels = texture.getLevels();
+
+  // the array samples every layer the same way, so textures only share one if they'd be sampled the same on their own
+  SamplerState sampler;
+  glGetTextureParameteriv(texture.getId(), GL_TEXTURE_WRAP_S, &sampler.wrapS);
+  glGetTextureParameteriv(texture.getId(), GL_TEXTURE_WRAP_T, &sampler.wrapT);
+  glGetTextureParameteriv(texture.getId(), GL_TEXTURE_MIN_FILTER, &sampler.minFilter);
+  glGetTextureParameteriv(texture.getId(), GL_TEXTURE_MAG_FILTER, &sampler.magFilter);
+
+  _allocateLayer(size.x, size.y, levels, sampler, ref.array, ref.layer);
+  if (ref.array < 0)
+  {
+    Log.print<Severity::warning>("All ", MAX_ARRAYS, " texture arrays are taken, a ", size.x, "x", size.y,
+      " texture will not be sampled");
+    return ref;
+  }
+
+  GLuint array = _sBuckets[ref.array].array;
+  for (int level = 0; level < levels; level++)
+  {
+    glCopyImageSubData(texture.getId(), GL_TEXTURE_2D, level, 0, 0, 0, array, GL_TEXTURE_2D_ARRAY, level, 0, 0, ref.layer,
+      std::max(1, size.x >> level), std::max(1, size.y >> level), 1);
+  }
+  return ref;
+}
+
+void TextureTable::remove(const TextureRef& ref)
+{
+  if (ref.handle)
+    makeTextureHandleNonResident(ref.handle);
+  else if (ref.array >= 0)
+    _sBuckets[ref.array].freeLayers.push_back(ref.layer);
+}
+
+void TextureTable::bindArrays()
+{
+  for (int i = 0; i < (int)_sBuckets.size(); i++)
+    GLStateCache::bindTextureUnit(ARRAY_UNIT + i, _sBuckets[i].array);
+}
\ No newline at end of file
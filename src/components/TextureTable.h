@@ -0,0 +1,82 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Texture;
+
+// where a shader finds a texture without it being bound to a unit:
+// a resident bindless handle, or else a layer of one of the texture arrays
+struct TextureRef
+{
+  GLuint64 handle = 0;
+  int array = -1;
+  int layer = -1;
+
+  bool isValid() const { return handle != 0 || array >= 0; }
+
+  // the handle as the uvec2 a std140 block stores it
+  glm::uvec2 getHandle() const { return glm::uvec2((GLuint)(handle & 0xFFFFFFFF), (GLuint)(handle >> 32)); }
+};
+
+// Makes every loaded texture reachable from material parameter blocks, so switching materials binds no textures.
+// With ARB_bindless_texture each texture gets a resident 64 bit handle. Without it, textures are copied into
+// GL_TEXTURE_2D_ARRAYs bucketed by size and sampler state, which stay bound to fixed units (ARRAY_UNIT onwards, see
+// Phong.fs). The copy is the only one kept: the texture's own GL_TEXTURE_2D is released once it's in its layer.
+// There's only ever one context, so this is all static like GLStateCache.
+class TextureTable
+{
+public:
+  // textureArrays in Phong.fs
+  static const int MAX_ARRAYS = 16;
+  static const GLuint ARRAY_UNIT = 16;
+
+protected:
+  // the wrap and filter state an array samples its layers with
+  struct SamplerState
+  {
+    GLint wrapS;
+    GLint wrapT;
+    GLint minFilter;
+    GLint magFilter;
+
+    bool operator==(const SamplerState& other) const
+    {
+      return wrapS == other.wrapS && wrapT == other.wrapT && minFilter == other.minFilter && magFilter == other.magFilter;
+    }
+  };
+
+  // textures of one size, mip count and sampler state, in the layers of one array
+  struct Bucket
+  {
+    int width;
+    int height;
+    int levels;
+    SamplerState sampler;
+    GLuint array;
+    int capacity;
+    int numLayers;
+    std::vector<int> freeLayers;
+  };
+
+  static bool _sIsInitialized;
+  static bool _sUseBindless;
+  static std::vector<Bucket> _sBuckets;
+
+  static void _init();
+
+  // a layer of the array for textures like this one, or -1 / -1 if every array is taken
+  static void _allocateLayer(int width, int height, int levels, const SamplerState& sampler, int& array, int& layer);
+  static void _growBucket(Bucket& bucket);
+
+public:
+  // make a newly created texture reachable from shaders. With the array fallback the texture is copied into a layer,
+  // after which its own GL texture isn't needed anymore
+  static TextureRef add(const Texture& texture);
+  static void remove(const TextureRef& ref);
+
+  // the fallback arrays are bound once here instead of per texture. Does nothing with bindless textures
+  static void bindArrays();
+
+  static bool isBindless();
+};
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "UniformBlockPool.h"
+#include "GLStateCache.h"
+
+UniformBlockPool::UniformBlockPool(GLuint binding, size_t blockSize)
+  : _mBinding(binding), _mBlockSize(blockSize)
+{}
+
+void UniformBlockPool::_grow(int capacity)
+{
+  GLuint buffer;
+  glCreateBuffers(1, &buffer);
+  glNamedBufferStorage(buffer, capacity * _mStride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+  if (_mBuffer)
+  {
+    glCopyNamedBufferSubData(_mBuffer, buffer, 0, 0, _mNumSlots * _mStride);
+    GLStateCache::forgetBuffer(_mBuffer);
+    glDeleteBuffers(1, &_mBuffer);
+  }
+
+  _mBuffer = buffer;
+  _mCapacity = capacity;
+}
+
+int UniformBlockPool::allocate()
+{
+  if (_mStride == 0)
+  {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _mStride = (_mBlockSize + alignment - 1) / alignment * alignment;
+  }
+
+  _mNumUsed++;
+  if (!_mFreeSlots.empty())
+  {
+    int slot = _mFreeSlots.back();
+    _mFreeSlots.pop_back();
+    return slot;
+  }
+
+  if (_mNumSlots == _mCapacity)
+    _grow(_mCapacity ? _mCapacity * 2 : 64);
+  return _mNumSlots++;
+}
+
+void UniformBlockPool::free(int slot)
+{
+  _mFreeSlots.push_back(slot);
+
+  // last one out releases the buffer
+  if (--_mNumUsed == 0 && _mBuffer)
+  {
+    GLStateCache::forgetBuffer(_mBuffer);
+    glDeleteBuffers(1, &_mBuffer);
+    _mBuffer = 0;
+    _mCapacity = 0;
+    _mNumSlots = 0;
+    _mFreeSlots.clear();
+  }
+}
+
+void UniformBlockPool::write(int slot, const void* data)
+{
+  glNamedBufferSubData(_mBuffer, slot * _mStride, _mBlockSize, data);
+}
+
+void UniformBlockPool::bind(int slot) const
+{
+  GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER, _mBinding, _mBuffer, slot * _mStride, _mBlockSize);
+}
+
+// --------------- handle ---------------
+UniformBlockHandle& UniformBlockHandle::operator=(const UniformBlockHandle& other)
+{
+  if (this != &other)
+  {
+    if (_mSlot >= 0)
+      _mPool->free(_mSlot);
+
+    _mPool = other._mPool;
+    _mSlot = -1;
+    _mIsDirty = true;
+  }
+  return *this;
+}
+
+UniformBlockHandle::~UniformBlockHandle()
+{
+  if (_mSlot >= 0)
+    _mPool->free(_mSlot);
+}
+
+void UniformBlockHandle::write(const void* data)
+{
+  if (_mSlot < 0)
+    _mSlot = _mPool->allocate();
+
+  _mPool->write(_mSlot, data);
+  _mIsDirty = false;
+}
+
+void UniformBlockHandle::bind() const
+{
+  if (_mSlot >= 0)
+    _mPool->bind(_mSlot);
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+
+// Fixed size uniform blocks packed into one buffer, each bound on its own with glBindBufferRange.
+// Slots are spaced by GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and the buffer doubles (keeping its contents) when full.
+// The buffer is released once the last slot is freed, so a static pool doesn't touch GL after the context is gone
+// as long as its users are cleaned up first.
+class UniformBlockPool
+{
+protected:
+  GLuint _mBinding;
+  size_t _mBlockSize;
+  size_t _mStride = 0;
+
+  GLuint _mBuffer = 0;
+  int _mCapacity = 0;
+  int _mNumSlots = 0;
+  int _mNumUsed = 0;
+  std::vector<int> _mFreeSlots;
+
+  void _grow(int capacity);
+
+public:
+  UniformBlockPool(GLuint binding, size_t blockSize);
+  UniformBlockPool(const UniformBlockPool& other) = delete;
+  virtual ~UniformBlockPool() {}
+
+  int allocate();
+  void free(int slot);
+
+  // overwrite the whole block of a slot
+  void write(int slot, const void* data);
+
+  // bind the block of a slot to the pool's binding point
+  void bind(int slot) const;
+
+  GLuint getBinding() const { return _mBinding; }
+  int getNumUsed() const { return _mNumUsed; }
+};
+
+// A block owned by one object. It's allocated on the first write, and copies get a (dirty) block of their own,
+// so owners can keep their default copy constructors.
+class UniformBlockHandle
+{
+protected:
+  UniformBlockPool* _mPool;
+  int _mSlot = -1;
+  bool _mIsDirty = true;
+
+public:
+  UniformBlockHandle(UniformBlockPool& pool) : _mPool(&pool) {}
+  UniformBlockHandle(const UniformBlockHandle& other) : _mPool(other._mPool) {}
+  UniformBlockHandle& operator=(const UniformBlockHandle& other);
+  ~UniformBlockHandle();
+
+  // the block has to be written again before the next bind
+  void markDirty() { _mIsDirty = true; }
+  bool isDirty() const { return _mIsDirty; }
+
+  void write(const void* data);
+  void bind() const;
+};
\ No newline at end of file
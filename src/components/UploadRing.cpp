@@ -0,0 +1,142 @@
+#include "UploadRing.h"
+#include "GLStateCache.h"
+#include "../utils/Logger.h"
+#include <chrono>
+
+UploadStats UploadRing::_sFrameStats;
+
+UploadRing::UploadRing(size_t regionSize)
+  : _mRegionSize(regionSize)
+{}
+
+UploadRing::~UploadRing()
+{
+  for (GLuint buffer : _mRetired)
+    _releaseBuffer(buffer);
+
+  for (GLsync& fence : _mFences)
+  {
+    if (fence)
+      glDeleteSync(fence);
+  }
+
+  if (_mBuffer)
+    _releaseBuffer(_mBuffer);
+}
+
+void UploadRing::_createBuffer(size_t regionSize)
+{
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  _mRegionSize = regionSize;
+  glCreateBuffers(1, &_mBuffer);
+  glNamedBufferStorage(_mBuffer, _mRegionSize * NUM_REGIONS, nullptr, flags);
+  _mMapping = (char*)glMapNamedBufferRange(_mBuffer, 0, _mRegionSize * NUM_REGIONS, flags);
+}
+
+void UploadRing::_releaseBuffer(GLuint buffer)
+{
+  glUnmapNamedBuffer(buffer);
+  GLStateCache::forgetBuffer(buffer);
+  glDeleteBuffers(1, &buffer);
+}
+
+void UploadRing::beginFrame()
+{
+  // the draws that read these were issued last frame, GL keeps the storage until they're done
+  for (GLuint buffer : _mRetired)
+    _releaseBuffer(buffer);
+  _mRetired.clear();
+
+  if (!_mBuffer)
+    _createBuffer(_mRegionSize);
+
+  _mRegion = (_mRegion + 1) % NUM_REGIONS;
+  _mHead = 0;
+  _mIsInFrame = true;
+
+  GLsync& fence = _mFences[_mRegion];
+  if (!fence) return;
+
+  // only a stall if the GPU is still NUM_REGIONS frames behind
+  if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+    std::chrono::duration<float, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+
+    _sFrameStats.stalls++;
+    _sFrameStats.stallMs += waited.count();
+  }
+
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+void UploadRing::endFrame()
+{
+  if (!_mIsInFrame) return;
+
+  _mFences[_mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _mIsInFrame = false;
+}
+
+UploadAllocation UploadRing::allocate(size_t size, size_t alignment)
+{
+  UploadAllocation allocation;
+  if (size == 0) return allocation;
+
+  if (!_mIsInFrame)
+  {
+    Log.print<Severity::warning>("Upload ring allocation outside of beginFrame / endFrame");
+    return allocation;
+  }
+
+  size_t offset = (_mHead + alignment - 1) & ~(alignment - 1);
+  if (offset + size > _mRegionSize)
+  {
+    // start over in a bigger buffer. Its regions were never used, so there's nothing to wait for
+    size_t regionSize = _mRegionSize * 2;
+    while (regionSize < size + alignment)
+      regionSize *= 2;
+
+    Log.print<Severity::info>("Upload ring region grew to ", regionSize, " bytes");
+    _sFrameStats.overflows++;
+
+    _mRetired.push_back(_mBuffer);
+    for (GLsync& fence : _mFences)
+    {
+      if (fence)
+        glDeleteSync(fence);
+      fence = nullptr;
+    }
+
+    _createBuffer(regionSize);
+    offset = 0;
+  }
+
+  _mHead = offset + size;
+  _sFrameStats.bytes += size;
+
+  allocation.buffer = _mBuffer;
+  allocation.offset = _mRegion * _mRegionSize + offset;
+  allocation.size = size;
+  allocation.pointer = _mMapping + allocation.offset;
+  return allocation;
+}
+
+size_t UploadRing::getUniformAlignment()
+{
+  static GLint alignment = 0;
+  if (!alignment)
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  return alignment > 0 ? (size_t)alignment : 256;
+}
+
+size_t UploadRing::getStorageAlignment()
+{
+  static GLint alignment = 0;
+  if (!alignment)
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  return alignment > 0 ? (size_t)alignment : 256;
+}
\ No newline at end of file
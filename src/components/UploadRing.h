@@ -0,0 +1,76 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+
+// space handed out by UploadRing::allocate, valid until the end of the frame
+struct UploadAllocation
+{
+  GLuint buffer = 0;
+  size_t offset = 0;
+  size_t size = 0;
+
+  // where to write the data, nullptr if nothing was allocated
+  void* pointer = nullptr;
+};
+
+// bytes streamed, and time spent waiting for the GPU to let go of a region
+struct UploadStats
+{
+  size_t bytes = 0;
+  unsigned int stalls = 0;
+  float stallMs = 0.f;
+  unsigned int overflows = 0;
+};
+
+// One big buffer for data that's rewritten every frame, mapped once (persistent and coherent) and split into
+// NUM_REGIONS regions. Each frame allocates linearly out of the next region, and fences it when done, so the CPU only
+// waits if it gets NUM_REGIONS frames ahead of the GPU. Data is written with plain memcpy, then bound by range.
+// If a frame needs more than a region, the buffer is replaced by one twice as big; the old one is kept until the next
+// frame, since draws already recorded this frame still read it.
+class UploadRing
+{
+public:
+  static const int NUM_REGIONS = 3;
+
+protected:
+  // totals over all rings since the last resetFrameStats()
+  static UploadStats _sFrameStats;
+
+  size_t _mRegionSize;
+  GLuint _mBuffer = 0;
+  char* _mMapping = nullptr;
+  GLsync _mFences[NUM_REGIONS] = {};
+
+  int _mRegion = 0;
+  size_t _mHead = 0;
+  bool _mIsInFrame = false;
+
+  // buffers that overflowed this frame, released at the start of the next one
+  std::vector<GLuint> _mRetired;
+
+  void _createBuffer(size_t regionSize);
+  void _releaseBuffer(GLuint buffer);
+
+public:
+  UploadRing(size_t regionSize = 4 << 20);
+  UploadRing(const UploadRing& other) = delete;
+  virtual ~UploadRing();
+
+  // move on to the next region, waiting for the GPU to finish with it if needed
+  void beginFrame();
+
+  // fence the region, once every draw reading it has been issued
+  void endFrame();
+
+  // size bytes at an offset that's a multiple of alignment (a power of two)
+  UploadAllocation allocate(size_t size, size_t alignment = 16);
+
+  // offset alignments for binding ranges as uniform / shader storage buffers
+  static size_t getUniformAlignment();
+  static size_t getStorageAlignment();
+
+  size_t getRegionSize() const { return _mRegionSize; }
+
+  static const UploadStats& getFrameStats() { return _sFrameStats; }
+  static void resetFrameStats() { _sFrameStats = UploadStats(); }
+};
\ No newline at end of file
@@ -0,0 +1,223 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// How an attribute is stored in a vertex and described to glVertexArrayAttrib*Format.
+// encode turns one vertex's source components (4 byte floats, or unsigned ints for the integer encodings) into
+// `components` stored ones. Source components that don't fit are dropped, missing ones are zero
+namespace VertexEncoding
+{
+  struct Float
+  {
+    typedef float Stored;
+    static constexpr GLenum type() { return GL_FLOAT; }
+    static constexpr bool isInteger() { return false; }
+    static constexpr GLboolean isNormalized() { return GL_FALSE; }
+
+    static void encode(const void* source, unsigned int sourceComponents, Stored* out, unsigned int components)
+    {
+      std::memcpy(out, source, std::min(sourceComponents, components) * sizeof(float));
+    }
+  };
+
+  struct UInt
+  {
+    typedef unsigned int Stored;
+    static constexpr GLenum type() { return GL_UNSIGNED_INT; }
+    static constexpr bool isInteger() { return true; }
+    static constexpr GLboolean isNormalized() { return GL_FALSE; }
+
+    static void encode(const void* source, unsigned int sourceComponents, Stored* out, unsigned int components)
+    {
+      std::memcpy(out, source, std::min(sourceComponents, components) * sizeof(unsigned int));
+    }
+  };
+
+  // integers up to 255, e.g. joint indices. Larger values have to be ruled out before encoding
+  struct UByte
+  {
+    typedef uint8_t Stored;
+    static constexpr GLenum type() { return GL_UNSIGNED_BYTE; }
+    static constexpr bool isInteger() { return true; }
+    static constexpr GLboolean isNormalized() { return GL_FALSE; }
+
+    static void encode(const void* source, unsigned int sourceComponents, Stored* out, unsigned int components)
+    {
+      const unsigned int* values = (const unsigned int*)source;
+      for (unsigned int i = 0; i < std::min(sourceComponents, components); i++)
+        out[i] = (Stored)std::min(values[i], 255u);
+    }
+  };
+
+  // [0, 1] in 8 bits, e.g. bone weights
+  struct Unorm8
+  {
+    typedef uint8_t Stored;
+    static constexpr GLenum type() { return GL_UNSIGNED_BYTE; }
+    static constexpr bool isInteger() { return false; }
+    static constexpr GLboolean isNormalized() { return GL_TRUE; }
+
+    static void encode(const void* source, unsigned int sourceComponents, Stored* out, unsigned int components)
+    {
+      const float* values = (const float*)source;
+      for (unsigned int i = 0; i < std::min(sourceComponents, components); i++)
+        out[i] = (Stored)(glm::clamp(values[i], 0.f, 1.f) * 255.f + .5f);
+    }
+  };
+
+  // half floats, e.g. tex coordinates (which can go past [0, 1] when they tile)
+  struct Half
+  {
+    typedef uint16_t Stored;
+    static constexpr GLenum type() { return GL_HALF_FLOAT; }
+    static constexpr bool isInteger() { return false; }
+    static constexpr GLboolean isNormalized() { return GL_FALSE; }
+
+    static void encode(const void* source, unsigned int sourceComponents, Stored* out, unsigned int components)
+    {
+      const float* values = (const float*)source;
+      for (unsigned int i = 0; i < std::min(sourceComponents, components); i++)
+        out[i] = glm::packHalf1x16(values[i]);
+    }
+  };
+
+  // a unit vector folded onto an octahedron and stored as 2 snorm16s. Decoded by octDecode in Phong.vs
+  struct Octahedral
+  {
+    typedef int16_t Stored;
+    static constexpr GLenum type() { return GL_SHORT; }
+    static constexpr bool isInteger() { return false; }
+    static constexpr GLboolean isNormalized() { return GL_TRUE; }
+
+    static void encode(const void* source, unsigned int sourceComponents, Stored* out, unsigned int components)
+    {
+      if (sourceComponents < 3 || components < 2) return;
+
+      const float* values = (const float*)source;
+      glm::vec3 v(values[0], values[1], values[2]);
+      float sum = glm::abs(v.x) + glm::abs(v.y) + glm::abs(v.z);
+      if (sum == 0.f) return;
+
+      // project onto the octahedron, then fold the lower half over the upper one
+      glm::vec2 e = glm::vec2(v) / sum;
+      if (v.z < 0.f)
+      {
+        glm::vec2 folded = 1.f - glm::abs(glm::vec2(e.y, e.x));
+        e.x = e.x >= 0.f ? folded.x : -folded.x;
+        e.y = e.y >= 0.f ? folded.y : -folded.y;
+      }
+
+      out[0] = (Stored)glm::round(glm::clamp(e.x, -1.f, 1.f) * 32767.f);
+      out[1] = (Stored)glm::round(glm::clamp(e.y, -1.f, 1.f) * 32767.f);
+    }
+  };
+}
+
+// one attribute of a mesh as it comes in: a tightly packed array of 4 byte components, nullptr if the mesh doesn't have it
+struct VertexStream
+{
+  const void* data = nullptr;
+  unsigned int components = 0;
+};
+
+// one attribute of an interleaved vertex: the shader location it feeds, and how many components it stores in which encoding
+template <int Location, typename Encoding, unsigned int Components>
+struct VertexAttribute
+{
+  typedef Encoding EncodingType;
+
+  static constexpr int location() { return Location; }
+  static constexpr unsigned int components() { return Components; }
+
+  // rounded up to 4 bytes, so every attribute starts aligned
+  static constexpr unsigned int size() { return (sizeof(typename Encoding::Stored) * Components + 3) & ~3u; }
+};
+
+// A vertex format fixed at compile time. The attributes are interleaved in the order they're listed, so the stride,
+// every offset and the whole VAO setup are known up front, and a vertex is one contiguous fetch.
+template <typename... Attributes> struct VertexLayout;
+
+template <>
+struct VertexLayout<>
+{
+  static constexpr unsigned int stride() { return 0; }
+  static constexpr unsigned int attributeMask() { return 0; }
+
+  static void setupAttributes(GLuint, GLuint, unsigned int) {}
+  static void interleaveAt(const VertexStream*, size_t, char*, unsigned int, unsigned int) {}
+};
+
+template <typename First, typename... Rest>
+struct VertexLayout<First, Rest...>
+{
+  typedef typename First::EncodingType Encoding;
+
+  static constexpr unsigned int stride() { return First::size() + VertexLayout<Rest...>::stride(); }
+
+  // one bit per attribute location
+  static constexpr unsigned int attributeMask() { return (1u << First::location()) | VertexLayout<Rest...>::attributeMask(); }
+
+  // describe the attributes (from offset into the vertex onwards) to a VAO, all reading from one binding
+  static void setupAttributes(GLuint vao, GLuint binding, unsigned int offset = 0)
+  {
+    glEnableVertexArrayAttrib(vao, First::location());
+    if (Encoding::isInteger())
+      glVertexArrayAttribIFormat(vao, First::location(), First::components(), Encoding::type(), offset);
+    else
+      glVertexArrayAttribFormat(vao, First::location(), First::components(), Encoding::type(), Encoding::isNormalized(), offset);
+    glVertexArrayAttribBinding(vao, First::location(), binding);
+
+    VertexLayout<Rest...>::setupAttributes(vao, binding, offset + First::size());
+  }
+
+  // encode numVertices vertices out of streams (indexed by attribute location) into out, which has to be zeroed.
+  // Attributes the mesh doesn't have stay zero
+  static void interleave(const VertexStream* streams, size_t numVertices, char* out)
+  {
+    interleaveAt(streams, numVertices, out, stride(), 0);
+  }
+
+  static void interleaveAt(const VertexStream* streams, size_t numVertices, char* out, unsigned int stride, unsigned int offset)
+  {
+    const VertexStream& stream = streams[First::location()];
+    if (stream.data)
+    {
+      const char* source = (const char*)stream.data;
+      size_t sourceStride = stream.components * 4;
+
+      for (size_t v = 0; v < numVertices; v++)
+      {
+        typename Encoding::Stored* stored = (typename Encoding::Stored*)(out + v * stride + offset);
+        Encoding::encode(source + v * sourceStride, stream.components, stored, First::components());
+      }
+    }
+
+    VertexLayout<Rest...>::interleaveAt(streams, numVertices, out, stride, offset + First::size());
+  }
+};
+
+// a VertexLayout behind plain function pointers, so the layout of a mesh can be picked at runtime
+struct VertexLayoutInfo
+{
+  const char* name;
+  unsigned int attributeMask;
+  unsigned int stride;
+
+  // normals and tangents are octahedral, and the rest is packed, see Primitive.h
+  bool isQuantized;
+
+  void (*setupAttributes)(GLuint vao, GLuint binding, unsigned int offset);
+  void (*interleave)(const VertexStream* streams, size_t numVertices, char* out);
+
+  bool hasAttribute(int location) const { return (attributeMask & (1u << location)) != 0; }
+
+  template <typename Layout>
+  static VertexLayoutInfo of(const char* name, bool isQuantized = false)
+  {
+    return { name, Layout::attributeMask(), Layout::stride(), isQuantized, &Layout::setupAttributes, &Layout::interleave };
+  }
+};
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "Window.h"
 #include <stdexcept>
 #include "../utils/Logger.h"
+#include "GLStateCache.h"
 
 void Window::onKeyCb(GLFWwindow* w, int key, int scancode, int action, int mods)
 {
@@ -98,30 +99,27 @@ void Window::setupFrameBuffer(int width, int height) {
   GLuint prevColor = color;
   GLuint prevDepth = depthStencil;
 
-  glGenTextures(1, &color);
-  glBindTexture(GL_TEXTURE_2D, color);
-  glTexStorage2D(GL_TEXTURE_2D, 1, GL_SRGB8_ALPHA8, width, height);
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  glGenRenderbuffers(1, &depthStencil);
-  glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH32F_STENCIL8, width, height);
-  glGenRenderbuffers(GL_RENDERBUFFER, 0);
-
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  // direct state access all the way, so none of the bindings GLStateCache tracks are touched
+  glCreateTextures(GL_TEXTURE_2D, 1, &color);
+  glTextureStorage2D(color, 1, GL_SRGB8_ALPHA8, width, height);
+
+  glCreateRenderbuffers(1, &depthStencil);
+  glNamedRenderbufferStorage(depthStencil, GL_DEPTH32F_STENCIL8, width, height);
+
+  glCreateFramebuffers(1, &fbo);
+  glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, color, 0);
+  glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+  GLenum status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
   if (status != GL_FRAMEBUFFER_COMPLETE) {
     Log.print<Severity::error>("glCheckFramebufferStatus: ", status);
   }
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
+  // the old ones, not the ones just made
   if (prevFb) {
-    glDeleteFramebuffers(1, &fbo);
-    glDeleteTextures(1, &color);
+    GLStateCache::forgetFramebuffer(prevFb);
+    GLStateCache::forgetTexture(prevColor);
+    glDeleteFramebuffers(1, &prevFb);
+    glDeleteTextures(1, &prevColor);
     glDeleteRenderbuffers(1, &prevDepth);
   }
 }
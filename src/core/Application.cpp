@@ -6,6 +6,10 @@
  */
 
 #include "Application.h"
+#include "../scene/TransformHierarchy.h"
+#include "../scene/Scene.h"
+#include "../components/GLStateCache.h"
+#include "../components/UploadRing.h"
 #include <stdexcept>
 
 // NON STATIC MEMBERS
@@ -61,6 +65,30 @@ int Application::runMainLoop()
         Log.print<Severity::debug>("Number of frames passed since last report: ", numFrames);
         Log.print<Severity::debug>("Update Time Elapsed: ", updateElapsed.stopTimer(), "ms");
         Log.print<Severity::debug>("Render Time Elapsed: ", renderElapsed.stopTimer(), "ms");
+
+        const TransformUpdateStats& transformStats = TransformHierarchy::getFrameStats();
+        Log.print<Severity::debug>("Transforms recomputed/skipped last frame: ", transformStats.recomputed, "/", transformStats.skipped);
+
+        const CullStats& cullStats = Scene::getFrameCullStats();
+        Log.print<Severity::debug>("Nodes visible/culled last frame: ", cullStats.visible, "/", cullStats.culled);
+
+        const RenderStats& renderStats = RenderQueue::getFrameStats();
+        Log.print<Severity::debug>("Draws/draw calls last frame: ", renderStats.draws, "/", renderStats.drawCalls,
+          " (", renderStats.instancedDrawCalls, " instanced, ", renderStats.multiDrawCalls, " multi-draw indirect)");
+        Log.print<Severity::debug>("Triangles drawn last frame: ", renderStats.triangles, " of ", renderStats.fullTriangles,
+          " at full detail (lod bias ", RenderQueue::getLodBias(), ")");
+        if (renderStats.clusterTriangles > 0)
+        {
+          Log.print<Severity::debug>("Cluster culling skipped ", 100.0 * renderStats.culledTriangles / renderStats.clusterTriangles,
+            "% of ", renderStats.clusterTriangles, " meshlet triangles last frame");
+        }
+
+        const GLCallStats& glStats = GLStateCache::getFrameStats();
+        Log.print<Severity::debug>("GL state calls issued/skipped last frame: ", glStats.issued, "/", glStats.skipped);
+
+        const UploadStats& uploadStats = UploadRing::getFrameStats();
+        Log.print<Severity::debug>("Upload ring bytes/fence stalls last frame: ", uploadStats.bytes, "/", uploadStats.stalls,
+          " (", uploadStats.stallMs, "ms waited, ", uploadStats.overflows, " overflows)");
       }
 
       updateElapsed.startTimer(true);
@@ -68,6 +96,11 @@ int Application::runMainLoop()
     }
 
     // update the game
+    TransformHierarchy::resetFrameStats();
+    Scene::resetFrameCullStats();
+    RenderQueue::resetFrameStats();
+    GLStateCache::resetFrameStats();
+    UploadRing::resetFrameStats();
     updateElapsed.resumeTimer();
     game.update(timeElapsedF);
     updateElapsed.pauseTimer();
@@ -14,13 +14,17 @@ Game::Game() :
   _mProgramManager(_mShaderManager),
   _mPrimitiveManager(),
   _mWindow(1920, 1080, "Window"),
+  _mWorkerPool(),
+  _mUploadRing(),
   _mCurrentState(nullptr),
   resources(
     _mShaderManager, 
     _mProgramManager, 
     _mTextureManager, 
     _mPrimitiveManager, 
-    _mWindow
+    _mWindow,
+    _mWorkerPool,
+    _mUploadRing
   )
 {}
 
@@ -48,7 +52,9 @@ void Game::render()
 {
   if (_mCurrentState)
   {
+    _mUploadRing.beginFrame();
     _mCurrentState->draw();
+    _mUploadRing.endFrame();
   }
 
   _mWindow.nextFrame();
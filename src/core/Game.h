@@ -33,6 +33,10 @@ private:
   TextureManager _mTextureManager;
   PrimitiveManager _mPrimitiveManager;
   Window _mWindow;
+  ThreadPool _mWorkerPool;
+
+  // per-frame GPU data. Declared after the window, so it is released while the context is still alive
+  UploadRing _mUploadRing;
 
   GameState* _mCurrentState;
   GameResources resources;
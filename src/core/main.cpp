@@ -8,10 +8,39 @@
 #include <iostream>
 #include "../utils/Logger.h"
 #include "Application.h"
+#include "../benchmarks/TransformBenchmark.h"
+#include "../components/GLStateCache.h"
+#include "../utils/AffineTransform.h"
+#include <cstring>
 
 int main(int argc, char **argv)
 {
   int retCode = 0;
+
+  // the build uses AVX, which older CPUs would crash on. Straight to stderr, nothing else has been set up yet
+  if (!AffineTransform::isCpuSupported())
+  {
+    std::cerr << "This build needs a CPU with AVX support" << std::endl;
+    return 1;
+  }
+
+  // headless benchmarks
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--benchmark-transforms") == 0)
+    {
+      runTransformBenchmark();
+      return 0;
+    }
+  }
+
+  // check glGetError after every draw (slow: it syncs with the driver)
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--gl-debug") == 0)
+      GLStateCache::setErrorChecking(true);
+  }
+
   Application app;
 
   Log.print<Severity::info>("Starting the application...");
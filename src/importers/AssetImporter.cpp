@@ -15,6 +15,9 @@ AssetImporter::~AssetImporter()
   {
     delete _mRoot;
   }
+
+  delete _mPrototype;
+  _mPrototype = nullptr;
 }
 
 void AssetImporter::load(unsigned int flags)
@@ -34,17 +37,38 @@ void AssetImporter::load(unsigned int flags)
     return;
   }
 
-  _mRoot = new Asset();
-  processBones(scene);
-  processNode(scene->mRootNode, scene, _mRoot);
+  // the bone tree belongs to the skeleton, so it gets an arena of its own
+  {
+    NodeArena::Scope boneScope(new NodeArena());
+    processBones(scene);
+  }
+
+  buildMeshData(scene);
+
+  // the node tree goes into one arena, freed once the whole tree is deleted
+  {
+    NodeArena::Scope nodeScope(new NodeArena());
+    _mRoot = new Asset();
+    processNode(scene->mRootNode, scene, _mRoot);
+  }
 
   if (_mSkeleton)
   {
-    _mRoot->skeleton = _mSkeleton;
+    std::vector<Material*> materials;
     for (auto& it : _mMaterials)
     {
-      _mRoot->allMaterials.push_back(it.second);
+      materials.push_back(it.second);
     }
+    _mRoot->setSkeleton(_mSkeleton, materials);
+  }
+
+  _mPrototype = new AssetPrototype(_mRoot);
+  _mMeshData.clear();
+
+  if (_mQuantizeVertices)
+  {
+    Log.print<Severity::info>("Quantized vertex data of ", _mPath, ": ", _mVertexBytes, " bytes, ",
+      _mUnquantizedVertexBytes - _mVertexBytes, " of ", _mUnquantizedVertexBytes, " bytes saved");
   }
 }
 
@@ -81,8 +105,8 @@ void processBoneNode(aiNode* node, Bone* parent, std::unordered_map<std::string,
     current->setParent(parent);
     current->inverseBindPoseTransform = glm::mat4(1.f);
     current->setBindPoseTransform(aiMatrixToGlm(node->mTransformation));
-    current->name = std::string(node->mName.C_Str());
-    allBones[current->name] = current;
+    current->setName(nodeName);
+    allBones[nodeName] = current;
   }
 
   for (int i = 0; i < node->mNumChildren; i++)
@@ -105,8 +129,8 @@ void AssetImporter::processBones(const aiScene* scene)
       {
         Bone* myBone = new Bone();
         myBone->inverseBindPoseTransform = aiMatrixToGlm(bone->mOffsetMatrix);
-        myBone->name = bone->mName.C_Str();
-        allBones[myBone->name] = myBone;
+        myBone->setName(bone->mName.C_Str());
+        allBones[myBone->getName()] = myBone;
       }
     }
   }
@@ -126,7 +150,7 @@ void AssetImporter::processBones(const aiScene* scene)
     Log.print<Severity::warning>("Found skeleton with multiple root bones!");
 
     root = new Bone();
-    root->name = _mPath + ":joint_root";
+    root->setName(_mPath + ":joint_root");
     root->inverseBindPoseTransform = glm::mat4(1.f);
     root->setBindPoseTransform(glm::mat4(1.f));
 
@@ -209,8 +233,8 @@ void AssetImporter::processNode(aiNode* node, const aiScene* scene, Asset* asset
   assetNode->setRotationQuaternion(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
   assetNode->setScale(glm::vec3(scaling.x, scaling.y, scaling.z));
   
-  assetNode->name = node->mName.C_Str();
-  Log.print<Severity::debug>("Processing node: ", assetNode->name);
+  assetNode->setName(node->mName.C_Str());
+  Log.print<Severity::debug>("Processing node: ", assetNode->getName());
 
   // meshes
   for (unsigned int i = 0; i < node->mNumMeshes; i++) 
@@ -242,10 +266,78 @@ void AssetImporter::processNode(aiNode* node, const aiScene* scene, Asset* asset
   }
 }
 
+std::string AssetImporter::getPrimitiveName(const aiMesh* mesh) const
+{
+  return _mPath + "___" + mesh->mName.C_Str();
+}
+
+void AssetImporter::buildMeshData(const aiScene* scene)
+{
+  int numMeshes = (int)scene->mNumMeshes;
+  _mMeshData.assign(numMeshes, PrimitiveData());
+
+  // meshes already in the manager (from an earlier import) are reused, so they're skipped
+  std::vector<bool> isNeeded(numMeshes);
+  for (int i = 0; i < numMeshes; i++)
+    isNeeded[i] = !_mResources.primitiveManager.find(getPrimitiveName(scene->mMeshes[i]));
+
+  // written from the workers, so not a vector<bool>
+  std::vector<MeshOptimizationStats> stats(numMeshes);
+  std::vector<char> isOptimized(numMeshes, 0);
+
+  _mResources.workerPool.parallelFor(numMeshes, 1, [&](int begin, int end)
+  {
+    for (int i = begin; i < end; i++)
+    {
+      if (!isNeeded[i]) continue;
+
+      const aiMesh* mesh = scene->mMeshes[i];
+      buildPrimitiveData(mesh, _mMeshData[i]);
+
+      // points and lines are left as they are
+      if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) continue;
+
+      if (_mOptimizeMeshes)
+      {
+        stats[i] = MeshOptimizer::optimize(_mMeshData[i], _mBuildMeshlets);
+        isOptimized[i] = stats[i].before.acmr > 0.f;
+      }
+      else if (_mBuildMeshlets)
+      {
+        MeshOptimizer::buildMeshlets(_mMeshData[i]);
+      }
+      if (_mGenerateLods)
+        MeshOptimizer::buildLods(_mMeshData[i]);
+    }
+  });
+
+  for (int i = 0; i < numMeshes; i++)
+  {
+    if (isOptimized[i])
+    {
+      Log.print<Severity::debug>("Optimized mesh ", getPrimitiveName(scene->mMeshes[i]),
+        ": ACMR ", stats[i].before.acmr, " -> ", stats[i].after.acmr,
+        ", ATVR ", stats[i].before.atvr, " -> ", stats[i].after.atvr);
+    }
+
+    if (!_mMeshData[i].meshlets.empty())
+    {
+      Log.print<Severity::debug>("Split mesh ", getPrimitiveName(scene->mMeshes[i]), " into ",
+        _mMeshData[i].meshlets.size(), " meshlets");
+    }
+
+    for (size_t lod = 0; lod < _mMeshData[i].lods.size(); lod++)
+    {
+      const PrimitiveLodData& lodData = _mMeshData[i].lods[lod];
+      Log.print<Severity::debug>("LOD ", lod + 1, " of mesh ", getPrimitiveName(scene->mMeshes[i]),
+        ": ", lodData.indices.size() / 3, " of ", _mMeshData[i].indices.size() / 3, " triangles, error ", lodData.error);
+    }
+  }
+}
+
 std::string AssetImporter::processMesh(aiMesh* mesh, const aiScene* scene, Asset* assetNode)
 {
-  std::string primitiveName(mesh->mName.C_Str());
-  primitiveName = _mPath + "___" + primitiveName;
+  std::string primitiveName = getPrimitiveName(mesh);
 
   Log.print<Severity::debug>("Processing mesh: ", primitiveName, " now!");
 
@@ -269,9 +361,8 @@ std::string AssetImporter::processMesh(aiMesh* mesh, const aiScene* scene, Asset
   return primitiveName;
 }
 
-Primitive* AssetImporter::createPrimitiveFromAiMesh(const std::string& name, aiMesh* mesh, const aiScene* scene)
+void AssetImporter::buildPrimitiveData(const aiMesh* mesh, PrimitiveData& data) const
 {
-  PrimitiveData data;
   auto numChannels = mesh->GetNumUVChannels();
   numChannels = glm::min(numChannels, (unsigned int)Primitive::MAX_TEX_COORDINATE_SUPPORTED);
   std::vector< unsigned int* > numComponents;
@@ -410,6 +501,21 @@ Primitive* AssetImporter::createPrimitiveFromAiMesh(const std::string& name, aiM
       data.indices.push_back(face.mIndices[j]);
     }
   }
+}
+
+Primitive* AssetImporter::createPrimitiveFromAiMesh(const std::string& name, aiMesh* mesh, const aiScene* scene)
+{
+  // built (and optimized) by buildMeshData already
+  size_t meshIdx = std::find(scene->mMeshes, scene->mMeshes + scene->mNumMeshes, mesh) - scene->mMeshes;
+  PrimitiveData data = std::move(_mMeshData[meshIdx]);
+  _mMeshData[meshIdx] = PrimitiveData();
+
+  data.quantize = _mQuantizeVertices;
+
+  size_t numVertices = data.vertices.size() / Primitive::SIZE_POSITION;
+  size_t numIndices = data.indices.empty() ? numVertices : data.indices.size();
+  _mVertexBytes += VertexFormat::fromData(data).getSize(numVertices, numIndices);
+  _mUnquantizedVertexBytes += VertexFormat::fromData(data, false).getSize(numVertices, numIndices);
 
   return _mResources.primitiveManager.insert(name, data);
 }
@@ -424,8 +530,8 @@ Material* AssetImporter::createMaterialFromAiMesh(aiMesh* mesh, const aiScene* s
   PhongMaterial* phongMat = new PhongMaterial(&_mResources.shaderProgramManager);
   if (diffuseMaps.size() > 0)
   {
-    phongMat->diffuseTex = diffuseMaps[0];
-    phongMat->ambientTex = diffuseMaps[0];
+    phongMat->setDiffuseTex(diffuseMaps[0]);
+    phongMat->setAmbientTex(diffuseMaps[0]);
 
     if (diffuseMaps.size() > 1)
       Log.print<Severity::warning>("Multiple diffuse maps is not supported!");
@@ -433,14 +539,14 @@ Material* AssetImporter::createMaterialFromAiMesh(aiMesh* mesh, const aiScene* s
 
   if (specularMaps.size() > 0)
   {
-    phongMat->specularTex = specularMaps[0];
+    phongMat->setSpecularTex(specularMaps[0]);
     if (specularMaps.size() > 1)
       Log.print <Severity::warning>("Multiple specular maps is not supported!");
   }
 
   if (ambientMaps.size() > 0)
   {
-    phongMat->ambientTex = ambientMaps[0];
+    phongMat->setAmbientTex(ambientMaps[0]);
     if (ambientMaps.size() > 1)
       Log.print<Severity::warning>("Multiple ambient maps is not supported!");
   }
@@ -470,22 +576,26 @@ Material* AssetImporter::createMaterialFromAiMesh(aiMesh* mesh, const aiScene* s
   int blendMode;
   material->Get(AI_MATKEY_BLEND_FUNC, blendMode);
 
-  phongMat->diffuse = glm::vec4(diffuse.r, diffuse.g, diffuse.b, 1.f);
-  phongMat->specular = glm::vec4(specular.r, specular.g, specular.b, 0) * shininessStrength;
-  phongMat->specular.a = 1.f;
-  phongMat->ambient = glm::vec4(ambient.r, ambient.g, ambient.b, 1.f);
-  phongMat->shininess = shininess;
+  phongMat->setDiffuse(glm::vec4(diffuse.r, diffuse.g, diffuse.b, 1.f));
+  phongMat->setSpecular(glm::vec4(glm::vec3(specular.r, specular.g, specular.b) * shininessStrength, 1.f));
+  phongMat->setAmbient(glm::vec4(ambient.r, ambient.g, ambient.b, 1.f));
+  phongMat->setShininess((int)shininess);
   phongMat->name = name.C_Str();
 
   if (blendMode == aiBlendMode::aiBlendMode_Default) {
-    phongMat->alphaCutoff = 0;
+    phongMat->setAlphaCutoff(0);
     phongMat->useAlphaBlending = true;
   }
   else {
-    phongMat->alphaCutoff = 0.5f;
+    phongMat->setAlphaCutoff(0.5f);
     phongMat->useAlphaBlending = false;
   }
 
+  // only what the file says is single sided. Formats without the flag keep drawing both sides
+  int twoSided = 1;
+  if (material->Get(AI_MATKEY_TWOSIDED, twoSided) == AI_SUCCESS)
+    phongMat->cullBackFaces = !twoSided && !phongMat->useAlphaBlending;
+
   return phongMat;
 }
 
@@ -563,10 +673,28 @@ void AssetImporter::cleanupAllResources()
   _mTextures.clear();
 }
 
+AssetInstance* AssetImporter::createSharedInstance() const
+{
+  if (!_mPrototype) return nullptr;
+
+  AssetInstance* instance = new AssetInstance(_mPrototype);
+  instance->currentAnimationIdx = _mRoot->currentAnimationIdx;
+  instance->isAnimationStarted = _mRoot->isAnimationStarted;
+  return instance;
+}
+
+AssetInstanceBatch* AssetImporter::createInstanceBatch() const
+{
+  if (!_mPrototype) return nullptr;
+  return new AssetInstanceBatch(_mPrototype);
+}
+
 Asset* AssetImporter::createInstance(bool cloneMaterial) const
 {
   if (!_mRoot) return nullptr;
 
+  // each instance gets its own arena, so it can be deleted independently
+  NodeArena::Scope scope(new NodeArena());
   Asset* clone = _mRoot->clone();
 
   if (cloneMaterial) 
@@ -8,7 +8,9 @@
 #include "../components/Material.h"
 #include "../scene/Model.h"
 #include "../scene/Asset.h"
+#include "../scene/AssetInstance.h"
 #include "../scene/Skeleton.h"
+#include "MeshOptimizer.h"
 
 
 class AssetImporter {
@@ -24,13 +26,40 @@ private:
   Asset* _mRoot = nullptr;
   Skeleton* _mSkeleton = nullptr;
 
+  // snapshot of _mRoot right after loading, shared by every instance from createSharedInstance
+  AssetPrototype* _mPrototype = nullptr;
+
+  // store the meshes in quantized vertex layouts, see PrimitiveData::quantize
+  bool _mQuantizeVertices = false;
+
+  // reorder every mesh's triangles and vertices with MeshOptimizer
+  bool _mOptimizeMeshes = true;
+
+  // simplify every mesh into a chain of levels of detail with MeshOptimizer
+  bool _mGenerateLods = true;
+
+  // split big meshes into meshlets for cluster culling with MeshOptimizer
+  bool _mBuildMeshlets = true;
+
+  // vertex data of every mesh in the scene (by mesh index), built before the node tree is processed
+  std::vector<PrimitiveData> _mMeshData;
+
+  // GPU bytes of the meshes' vertices and indices, and what they'd take up without quantizing
+  size_t _mVertexBytes = 0;
+  size_t _mUnquantizedVertexBytes = 0;
+
 private:
   void processBones(const aiScene* scene);
   void processAnimations(const aiScene* scene);
   void processNode(aiNode* node, const aiScene* scene, Asset* assetNode);
 
+  // convert (and optimize / simplify) the scene's meshes that aren't loaded yet, one mesh per task on the worker pool
+  void buildMeshData(const aiScene* scene);
+  void buildPrimitiveData(const aiMesh* mesh, PrimitiveData& data) const;
+
   // process mesh, then returns the name of the mesh, which must be inserted into _mPrimitives and _mMaterials
   std::string processMesh(aiMesh* mesh, const aiScene* scene, Asset* assetNode);
+  std::string getPrimitiveName(const aiMesh* mesh) const;
   Primitive* createPrimitiveFromAiMesh(const std::string& name, aiMesh* mesh, const aiScene* scene);
   Material* createMaterialFromAiMesh(aiMesh* mesh, const aiScene* scene);
   std::vector<Texture*> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const aiScene* scene);
@@ -41,10 +70,25 @@ public:
   virtual ~AssetImporter();
   void load(unsigned int flags = 0);
 
+  // have to be set before load
+  void setQuantizeVertices(bool quantize) { _mQuantizeVertices = quantize; }
+  void setOptimizeMeshes(bool optimize) { _mOptimizeMeshes = optimize; }
+  void setGenerateLods(bool generate) { _mGenerateLods = generate; }
+  void setBuildMeshlets(bool build) { _mBuildMeshlets = build; }
+
   // create a brand new asset instance (will not be managed internally, caller responsible for deleting it)
   Asset* createInstance(bool cloneMaterial = false) const;
   Asset* getOriginal() const { return _mRoot; }
 
+  // create a lightweight instance that draws the loaded asset without copying its tree (caller responsible for deleting it).
+  // Instances share the importer's prototype, so the importer has to outlive them
+  AssetInstance* createSharedInstance() const;
+
+  // an empty batch for many copies of the loaded asset, each a compact record instead of a node (caller responsible for deleting it).
+  // Same as shared instances, the importer has to outlive it
+  AssetInstanceBatch* createInstanceBatch() const;
+  const AssetPrototype* getPrototype() const { return _mPrototype; }
+
   // Note: this will remove the asset from memory, so don't call it until done using it.
   // If there's duplicate asset, the cleanup will also clean the resources shared by the other asset, don't use this if possible.
   // Instead, opt to manually remove the assets through the getters
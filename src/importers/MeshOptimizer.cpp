@@ -0,0 +1,832 @@
+#include "MeshOptimizer.h"
+#include "../components/Primitive.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <unordered_map>
+
+constexpr float MeshOptimizer::OVERDRAW_THRESHOLD;
+constexpr float MeshOptimizer::LOD_REDUCTION;
+constexpr float MeshOptimizer::LOD_MAX_RELATIVE_ERROR;
+constexpr float MeshOptimizer::MESHLET_MIN_CONE_DOT;
+
+namespace
+{
+  // Forsyth's scoring: the last triangle's vertices get a flat score (so the next triangle doesn't just fan around
+  // them), older cache entries decay, and vertices with few triangles left get a boost so they're finished off
+  const float CACHE_DECAY_POWER = 1.5f;
+  const float LAST_TRIANGLE_SCORE = .75f;
+  const float VALENCE_BOOST_SCALE = 2.f;
+  const float VALENCE_BOOST_POWER = .5f;
+
+  const unsigned int UNUSED_VERTEX = ~0u;
+
+  float vertexScore(int cachePosition, unsigned int remainingTriangles)
+  {
+    // nothing left to draw with it
+    if (remainingTriangles == 0) return -1.f;
+
+    float score = 0.f;
+    if (cachePosition >= 0)
+    {
+      if (cachePosition < 3)
+        score = LAST_TRIANGLE_SCORE;
+      else
+        score = std::pow(1.f - float(cachePosition - 3) / (MeshOptimizer::CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+
+    return score + VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+  }
+
+  // a FIFO cache simulated with timestamps: a vertex is cached if it went in at most cacheSize insertions ago
+  struct FifoCache
+  {
+    std::vector<unsigned int> insertedAt;
+    unsigned int cacheSize;
+    unsigned int timestamp;
+
+    FifoCache(unsigned int numVertices, unsigned int cacheSize)
+      : insertedAt(numVertices, 0), cacheSize(cacheSize), timestamp(cacheSize + 1)
+    {}
+
+    // misses of one triangle
+    unsigned int update(const unsigned int* triangle)
+    {
+      unsigned int misses = 0;
+      for (int k = 0; k < 3; k++)
+      {
+        unsigned int& vertex = insertedAt[triangle[k]];
+        if (timestamp - vertex > cacheSize)
+        {
+          vertex = timestamp++;
+          misses++;
+        }
+      }
+      return misses;
+    }
+
+    void clear() { timestamp += cacheSize + 1; }
+  };
+
+  // sum of squared distances to a set of planes, weighted by the planes' triangle areas:
+  // p^T A p + 2 b.p + c, with A symmetric, stored as its upper triangle
+  struct Quadric
+  {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(const glm::dvec3& n, double d, double weight)
+    {
+      Quadric q;
+      q.a00 = n.x * n.x * weight; q.a01 = n.x * n.y * weight; q.a02 = n.x * n.z * weight;
+      q.a11 = n.y * n.y * weight; q.a12 = n.y * n.z * weight; q.a22 = n.z * n.z * weight;
+      q.b0 = n.x * d * weight; q.b1 = n.y * d * weight; q.b2 = n.z * d * weight;
+      q.c = d * d * weight;
+      q.weight = weight;
+      return q;
+    }
+
+    void add(const Quadric& q)
+    {
+      a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+      b0 += q.b0; b1 += q.b1; b2 += q.b2;
+      c += q.c;
+      weight += q.weight;
+    }
+
+    // mean squared distance of p to the planes
+    double error(const glm::dvec3& p) const
+    {
+      if (weight <= 0) return 0;
+
+      double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+        + 2 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+        + 2 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+      return std::max(e, 0.0) / weight;
+    }
+  };
+
+  struct Collapse
+  {
+    unsigned int from;
+    unsigned int to;
+    double error;
+  };
+
+  // reorder one attribute to the new vertex numbering. Attributes with the wrong size are left alone (Primitive drops them)
+  template <typename T>
+  void remapStream(std::vector<T>& stream, unsigned int components, const std::vector<unsigned int>& remap, unsigned int numUsed)
+  {
+    if (components == 0 || stream.size() != remap.size() * components) return;
+
+    std::vector<T> remapped((size_t)numUsed * components);
+    for (size_t v = 0; v < remap.size(); v++)
+    {
+      if (remap[v] == UNUSED_VERTEX) continue;
+      std::copy(stream.begin() + v * components, stream.begin() + (v + 1) * components, remapped.begin() + (size_t)remap[v] * components);
+    }
+    stream.swap(remapped);
+  }
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int numVertices, unsigned int cacheSize)
+{
+  VertexCacheStats stats;
+  size_t numTriangles = indices.size() / 3;
+  if (numTriangles == 0 || numVertices == 0) return stats;
+
+  FifoCache cache(numVertices, cacheSize);
+  size_t misses = 0;
+  for (size_t t = 0; t < numTriangles; t++)
+    misses += cache.update(&indices[t * 3]);
+
+  std::vector<bool> isUsed(numVertices, false);
+  size_t numUsed = 0;
+  for (unsigned int index : indices)
+  {
+    if (!isUsed[index]) numUsed++;
+    isUsed[index] = true;
+  }
+
+  stats.acmr = float(misses) / numTriangles;
+  stats.atvr = float(misses) / numUsed;
+  return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices)
+{
+  size_t numTriangles = indices.size() / 3;
+  if (numTriangles == 0) return;
+
+  // triangles of every vertex, back to back. The first `remaining` of a vertex's triangles are the ones not drawn yet
+  std::vector<unsigned int> remaining(numVertices, 0);
+  for (unsigned int index : indices)
+    remaining[index]++;
+
+  std::vector<unsigned int> firstTriangle(numVertices + 1, 0);
+  for (unsigned int v = 0; v < numVertices; v++)
+    firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++)
+    adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+  std::vector<int> cachePosition(numVertices, -1);
+  std::vector<float> vertexScores(numVertices);
+  for (unsigned int v = 0; v < numVertices; v++)
+    vertexScores[v] = vertexScore(-1, remaining[v]);
+
+  std::vector<float> triangleScores(numTriangles);
+  for (size_t t = 0; t < numTriangles; t++)
+    triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+  std::vector<bool> isEmitted(numTriangles, false);
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+
+  std::vector<unsigned int> cache, nextCache;
+  cache.reserve(CACHE_SIZE + 3);
+  nextCache.reserve(CACHE_SIZE + 3);
+
+  // start with the best triangle of the whole mesh
+  size_t best = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+  size_t nextUnemitted = 0;
+
+  while (best < numTriangles)
+  {
+    const unsigned int* triangle = &indices[best * 3];
+    isEmitted[best] = true;
+    result.insert(result.end(), triangle, triangle + 3);
+
+    // take the triangle out of its vertices' lists
+    for (int k = 0; k < 3; k++)
+    {
+      unsigned int v = triangle[k];
+      unsigned int* begin = &adjacency[firstTriangle[v]];
+      unsigned int* end = begin + remaining[v];
+      unsigned int* it = std::find(begin, end, (unsigned int)best);
+      if (it != end)
+      {
+        std::swap(*it, *(end - 1));
+        remaining[v]--;
+      }
+    }
+
+    // the triangle's vertices go to the front of the cache, everything else moves back
+    nextCache.clear();
+    for (int k = 0; k < 3; k++)
+    {
+      if (std::find(nextCache.begin(), nextCache.end(), triangle[k]) == nextCache.end())
+        nextCache.push_back(triangle[k]);
+    }
+
+    size_t numFront = nextCache.size();
+    for (unsigned int v : cache)
+    {
+      if (std::find(nextCache.begin(), nextCache.begin() + numFront, v) == nextCache.begin() + numFront)
+        nextCache.push_back(v);
+    }
+
+    // rescore everything that moved, including what fell out, and pass the change on to their triangles
+    for (size_t i = 0; i < nextCache.size(); i++)
+    {
+      unsigned int v = nextCache[i];
+      cachePosition[v] = i < CACHE_SIZE ? (int)i : -1;
+
+      float score = vertexScore(cachePosition[v], remaining[v]);
+      float delta = score - vertexScores[v];
+      vertexScores[v] = score;
+
+      for (unsigned int j = 0; j < remaining[v]; j++)
+        triangleScores[adjacency[firstTriangle[v] + j]] += delta;
+    }
+
+    if (nextCache.size() > CACHE_SIZE)
+      nextCache.resize(CACHE_SIZE);
+    cache.swap(nextCache);
+
+    // the next triangle is the best one touching the cache
+    best = numTriangles;
+    float bestScore = -1.f;
+    for (unsigned int v : cache)
+    {
+      for (unsigned int j = 0; j < remaining[v]; j++)
+      {
+        unsigned int t = adjacency[firstTriangle[v] + j];
+        if (triangleScores[t] > bestScore)
+        {
+          bestScore = triangleScores[t];
+          best = t;
+        }
+      }
+    }
+
+    // nothing left around the cache, continue with whichever triangle comes next
+    if (best == numTriangles)
+    {
+      while (nextUnemitted < numTriangles && isEmitted[nextUnemitted]) nextUnemitted++;
+      best = nextUnemitted;
+    }
+  }
+
+  indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& positions, float threshold)
+{
+  size_t numTriangles = indices.size() / 3;
+  unsigned int numVertices = (unsigned int)(positions.size() / 3);
+  if (numTriangles < 2 || numVertices == 0) return;
+
+  FifoCache cache(numVertices, ANALYZE_CACHE_SIZE);
+
+  // hard boundaries: triangles that miss on every vertex start somewhere new anyway, so moving them costs nothing
+  std::vector<size_t> hardBoundaries;
+  for (size_t t = 0; t < numTriangles; t++)
+  {
+    if (cache.update(&indices[t * 3]) == 3 || t == 0)
+      hardBoundaries.push_back(t);
+  }
+  hardBoundaries.push_back(numTriangles);
+
+  // soft boundaries: split the hard clusters further wherever the ACMR so far is within threshold of the whole cluster's
+  std::vector<size_t> clusters;
+  for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+  {
+    size_t start = hardBoundaries[c];
+    size_t end = hardBoundaries[c + 1];
+
+    cache.clear();
+    unsigned int clusterMisses = 0;
+    for (size_t t = start; t < end; t++)
+      clusterMisses += cache.update(&indices[t * 3]);
+    float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+    cache.clear();
+    clusters.push_back(start);
+    size_t last = start;
+    unsigned int misses = 0;
+    for (size_t t = start; t < end; t++)
+    {
+      misses += cache.update(&indices[t * 3]);
+      if (t + 1 < end && float(misses) / float(t + 1 - last) <= clusterThreshold)
+      {
+        clusters.push_back(t + 1);
+        last = t + 1;
+        misses = 0;
+        cache.clear();
+      }
+    }
+  }
+  clusters.push_back(numTriangles);
+
+  auto position = [&](unsigned int index) { return glm::vec3(positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]); };
+
+  glm::vec3 meshCentroid(0.f);
+  for (unsigned int index : indices)
+    meshCentroid += position(index);
+  meshCentroid /= (float)indices.size();
+
+  // clusters facing away from the middle of the mesh are likely in front of the rest, so they go first
+  size_t numClusters = clusters.size() - 1;
+  std::vector<float> sortKeys(numClusters);
+  for (size_t c = 0; c < numClusters; c++)
+  {
+    glm::vec3 centroid(0.f), normal(0.f);
+    float area = 0.f;
+
+    for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+    {
+      glm::vec3 p0 = position(indices[t * 3]), p1 = position(indices[t * 3 + 1]), p2 = position(indices[t * 3 + 2]);
+      glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+      float a = glm::length(n);
+
+      centroid += (p0 + p1 + p2) * (a / 3.f);
+      normal += n;
+      area += a;
+    }
+
+    float normalLength = glm::length(normal);
+    sortKeys[c] = area > 0.f && normalLength > 0.f ? glm::dot(centroid / area - meshCentroid, normal / normalLength) : 0.f;
+  }
+
+  std::vector<size_t> order(numClusters);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+  for (size_t c : order)
+    result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+  indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(PrimitiveData& data)
+{
+  size_t numVertices = data.vertices.size() / Primitive::SIZE_POSITION;
+
+  std::vector<unsigned int> remap(numVertices, UNUSED_VERTEX);
+  unsigned int numUsed = 0;
+  for (unsigned int& index : data.indices)
+  {
+    if (remap[index] == UNUSED_VERTEX)
+      remap[index] = numUsed++;
+    index = remap[index];
+  }
+
+  remapStream(data.vertices, Primitive::SIZE_POSITION, remap, numUsed);
+  remapStream(data.normals, Primitive::SIZE_NORMAL, remap, numUsed);
+  remapStream(data.tangents, Primitive::SIZE_TANGENT, remap, numUsed);
+  remapStream(data.bitangents, Primitive::SIZE_BITANGENT, remap, numUsed);
+  remapStream(data.texCoords, data.numComponents, remap, numUsed);
+  remapStream(data.texCoords_2, data.numComponents_2, remap, numUsed);
+  remapStream(data.texCoords_3, data.numComponents_3, remap, numUsed);
+  remapStream(data.weights, Primitive::SIZE_WEIGHT, remap, numUsed);
+  remapStream(data.joints, Primitive::SIZE_JOINT, remap, numUsed);
+}
+
+MeshOptimizationStats MeshOptimizer::optimize(PrimitiveData& data, bool withMeshlets)
+{
+  MeshOptimizationStats stats;
+  unsigned int numVertices = (unsigned int)(data.vertices.size() / Primitive::SIZE_POSITION);
+  if (numVertices == 0 || data.indices.size() % Primitive::SIZE_FACE != 0) return stats;
+
+  if (data.indices.empty())
+  {
+    data.indices.resize(numVertices - numVertices % Primitive::SIZE_FACE);
+    std::iota(data.indices.begin(), data.indices.end(), 0);
+  }
+
+  // broken indices are left for Primitive to warn about
+  if (data.indices.empty() || *std::max_element(data.indices.begin(), data.indices.end()) >= numVertices) return stats;
+
+  stats.before = analyzeVertexCache(data.indices, numVertices);
+
+  optimizeVertexCache(data.indices, numVertices);
+  optimizeOverdraw(data.indices, data.vertices);
+
+  // meshlets are seeded in the overdraw order, so they come out roughly in that order too
+  if (withMeshlets)
+    buildMeshlets(data);
+  optimizeVertexFetch(data);
+
+  stats.after = analyzeVertexCache(data.indices, (unsigned int)(data.vertices.size() / Primitive::SIZE_POSITION));
+  return stats;
+}
+
+std::vector<unsigned int> MeshOptimizer::simplify(const std::vector<unsigned int>& indices, const std::vector<float>& positions,
+  size_t targetIndexCount, float targetError, float& error)
+{
+  error = 0.f;
+  std::vector<unsigned int> result(indices);
+  unsigned int numVertices = (unsigned int)(positions.size() / 3);
+  if (result.size() <= targetIndexCount || numVertices == 0) return result;
+
+  auto position = [&](unsigned int index) { return glm::dvec3(positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]); };
+
+  // vertices at the same position (split for their normals or tex coordinates) get one id here
+  std::vector<unsigned int> welded(numVertices);
+  std::vector<unsigned int> numAtPosition(numVertices, 0);
+  {
+    struct PositionHash
+    {
+      size_t operator()(const glm::vec3& p) const
+      {
+        // -0 and 0 compare equal, so they have to hash the same
+        glm::vec3 q = p + glm::vec3(0.f);
+        uint32_t bits[3];
+        std::memcpy(bits, &q, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+      }
+    };
+
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAtPosition;
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+      glm::vec3 p(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+      welded[v] = firstAtPosition.insert({ p, v }).first->second;
+      numAtPosition[welded[v]]++;
+    }
+  }
+
+  // edges (between positions) used by only one triangle are on an open border
+  std::vector<bool> isLocked(numVertices, false);
+  {
+    std::unordered_map<uint64_t, unsigned int> edgeUses;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        uint64_t a = welded[result[i + k]], b = welded[result[i + (k + 1) % 3]];
+        edgeUses[a < b ? (a << 32) | b : (b << 32) | a]++;
+      }
+    }
+
+    for (const auto& edge : edgeUses)
+    {
+      if (edge.second != 1) continue;
+      isLocked[edge.first >> 32] = true;
+      isLocked[edge.first & 0xFFFFFFFF] = true;
+    }
+  }
+
+  for (unsigned int v = 0; v < numVertices; v++)
+  {
+    // moving one vertex of a seam would tear it open
+    if (numAtPosition[welded[v]] > 1 || isLocked[welded[v]]) isLocked[v] = true;
+  }
+
+  std::vector<Quadric> quadrics(numVertices);
+  for (size_t i = 0; i < result.size(); i += 3)
+  {
+    glm::dvec3 p0 = position(result[i]), p1 = position(result[i + 1]), p2 = position(result[i + 2]);
+    glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+    double area = glm::length(n);
+    if (area <= 0) continue;
+
+    n /= area;
+    Quadric q = Quadric::fromPlane(n, -glm::dot(n, p0), area * .5);
+    for (int k = 0; k < 3; k++)
+      quadrics[result[i + k]].add(q);
+  }
+
+  double maxError = (double)targetError * targetError;
+  double acceptedError = 0;
+  size_t numTriangles = result.size() / 3;
+  size_t targetTriangles = targetIndexCount / 3;
+
+  std::vector<unsigned int> remap(numVertices);
+  std::vector<bool> isTouched(numVertices);
+  std::vector<unsigned int> firstTriangle(numVertices + 1);
+  std::vector<unsigned int> adjacency;
+  std::vector<Collapse> collapses;
+
+  // every pass collapses a set of edges that don't share any triangles, cheapest first
+  while (numTriangles > targetTriangles)
+  {
+    // triangles of every vertex
+    std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+    for (unsigned int index : result)
+      firstTriangle[index + 1]++;
+    for (unsigned int v = 0; v < numVertices; v++)
+      firstTriangle[v + 1] += firstTriangle[v];
+
+    adjacency.resize(result.size());
+    std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < result.size(); i++)
+      adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+    // the cheapest way to get rid of every vertex that can move
+    collapses.clear();
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+      if (isLocked[v] || firstTriangle[v] == firstTriangle[v + 1]) continue;
+
+      Collapse best = { v, v, DBL_MAX };
+      for (unsigned int j = firstTriangle[v]; j < firstTriangle[v + 1]; j++)
+      {
+        const unsigned int* triangle = &result[adjacency[j] * 3];
+        for (int k = 0; k < 3; k++)
+        {
+          unsigned int to = triangle[k];
+          if (to == v) continue;
+
+          Quadric q = quadrics[v];
+          q.add(quadrics[to]);
+          double e = q.error(position(to));
+          if (e < best.error) best = { v, to, e };
+        }
+      }
+
+      if (best.to != v && best.error <= maxError)
+        collapses.push_back(best);
+    }
+
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+    for (unsigned int v = 0; v < numVertices; v++) remap[v] = v;
+    std::fill(isTouched.begin(), isTouched.end(), false);
+
+    size_t numCollapsed = 0;
+    for (const Collapse& collapse : collapses)
+    {
+      if (numTriangles <= targetTriangles) break;
+      if (isTouched[collapse.from] || isTouched[collapse.to]) continue;
+
+      // triangles that stay have to keep facing the same way
+      glm::dvec3 target = position(collapse.to);
+      bool flips = false;
+      size_t removed = 0;
+      for (unsigned int j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1] && !flips; j++)
+      {
+        const unsigned int* triangle = &result[adjacency[j] * 3];
+        if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+        {
+          removed++;
+          continue;
+        }
+
+        glm::dvec3 p[3], moved[3];
+        for (int k = 0; k < 3; k++)
+        {
+          p[k] = position(triangle[k]);
+          moved[k] = triangle[k] == collapse.from ? target : p[k];
+        }
+
+        glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+        flips = glm::dot(before, after) <= 0;
+      }
+      if (flips) continue;
+
+      // the neighbourhood changed, so nothing else around here goes this pass
+      for (unsigned int j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1]; j++)
+      {
+        const unsigned int* triangle = &result[adjacency[j] * 3];
+        for (int k = 0; k < 3; k++) isTouched[triangle[k]] = true;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].add(quadrics[collapse.from]);
+      acceptedError = std::max(acceptedError, collapse.error);
+      numTriangles -= removed;
+      numCollapsed++;
+    }
+
+    if (numCollapsed == 0) break;
+
+    // move the collapsed vertices and drop the triangles that became degenerate
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+      if (a == b || b == c || a == c) continue;
+
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+    numTriangles = write / 3;
+  }
+
+  error = (float)std::sqrt(acceptedError);
+  return result;
+}
+
+void MeshOptimizer::buildLods(PrimitiveData& data)
+{
+  data.lods.clear();
+  unsigned int numVertices = (unsigned int)(data.vertices.size() / Primitive::SIZE_POSITION);
+  if (numVertices == 0 || data.indices.size() % Primitive::SIZE_FACE != 0) return;
+
+  AABB bounds;
+  for (unsigned int v = 0; v < numVertices; v++)
+    bounds.expand(glm::vec3(data.vertices[v * 3], data.vertices[v * 3 + 1], data.vertices[v * 3 + 2]));
+  float maxError = glm::length(bounds.max - bounds.min) * LOD_MAX_RELATIVE_ERROR;
+
+  // every level starts from the full mesh, so its error is measured against the full mesh too
+  size_t previous = data.indices.size();
+  float target = (float)data.indices.size();
+  for (int level = 1; level < MAX_LODS; level++)
+  {
+    target *= LOD_REDUCTION;
+    size_t targetIndexCount = (size_t)target / 3 * 3;
+    if (targetIndexCount < MIN_LOD_TRIANGLES * 3) break;
+
+    PrimitiveLodData lod;
+    lod.indices = simplify(data.indices, data.vertices, targetIndexCount, maxError, lod.error);
+
+    // too much is locked (or would stray too far) to get much further
+    if (lod.indices.empty() || lod.indices.size() > previous * 9 / 10) break;
+
+    optimizeVertexCache(lod.indices, numVertices);
+    previous = lod.indices.size();
+    data.lods.push_back(std::move(lod));
+  }
+}
+
+void MeshOptimizer::buildMeshlets(PrimitiveData& data)
+{
+  data.meshlets.clear();
+  const std::vector<unsigned int>& indices = data.indices;
+  unsigned int numVertices = (unsigned int)(data.vertices.size() / Primitive::SIZE_POSITION);
+  size_t numTriangles = indices.size() / Primitive::SIZE_FACE;
+  if (numVertices == 0 || indices.size() % Primitive::SIZE_FACE != 0 ||
+      numTriangles < (size_t)MIN_MESHLETS * MESHLET_MAX_TRIANGLES) return;
+
+  auto position = [&](unsigned int v)
+  {
+    return glm::vec3(data.vertices[v * 3], data.vertices[v * 3 + 1], data.vertices[v * 3 + 2]);
+  };
+
+  // unit normals (zero for degenerate triangles) and centroids
+  std::vector<glm::vec3> normals(numTriangles);
+  std::vector<glm::vec3> centroids(numTriangles);
+  float edgeLength = 0.f;
+  for (size_t t = 0; t < numTriangles; t++)
+  {
+    glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    normals[t] = length > 0.f ? normal / length : glm::vec3(0.f);
+    centroids[t] = (a + b + c) / 3.f;
+    edgeLength += glm::length(b - a);
+  }
+  edgeLength = std::max(edgeLength / numTriangles, FLT_MIN);
+
+  // triangles around each vertex
+  std::vector<unsigned int> adjacencyOffsets(numVertices + 1, 0);
+  for (unsigned int index : indices)
+    adjacencyOffsets[index + 1]++;
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++)
+    adjacency[cursor[indices[i]]++] = (unsigned int)(i / 3);
+
+  std::vector<char> isUsed(numTriangles, 0);
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+
+  // the meshlet being built. localSlot numbers its vertices from 0, everything else is UNUSED_VERTEX
+  std::vector<unsigned int> localSlot(numVertices, UNUSED_VERTEX);
+  std::vector<unsigned int> meshletVertices;
+  std::vector<size_t> meshletTriangles;
+  AABB meshletBox;
+  glm::vec3 normalSum(0.f);
+
+  auto countNewVertices = [&](size_t t)
+  {
+    unsigned int count = 0;
+    for (int k = 0; k < 3; k++)
+      count += localSlot[indices[t * 3 + k]] == UNUSED_VERTEX ? 1 : 0;
+    return count;
+  };
+
+  auto addTriangle = [&](size_t t)
+  {
+    isUsed[t] = 1;
+    meshletTriangles.push_back(t);
+    normalSum += normals[t];
+    for (int k = 0; k < 3; k++)
+    {
+      unsigned int v = indices[t * 3 + k];
+      if (localSlot[v] != UNUSED_VERTEX) continue;
+
+      localSlot[v] = (unsigned int)meshletVertices.size();
+      meshletVertices.push_back(v);
+      meshletBox.expand(position(v));
+    }
+  };
+
+  auto finishMeshlet = [&]()
+  {
+    Meshlet meshlet;
+    meshlet.firstIndex = (unsigned int)result.size();
+
+    // the vertices fit any cache, but the order still decides how often they're reused from it
+    std::vector<unsigned int> local;
+    local.reserve(meshletTriangles.size() * 3);
+    for (size_t t : meshletTriangles)
+    {
+      for (int k = 0; k < 3; k++)
+        local.push_back(localSlot[indices[t * 3 + k]]);
+    }
+    optimizeVertexCache(local, (unsigned int)meshletVertices.size());
+    for (unsigned int slot : local)
+      result.push_back(meshletVertices[slot]);
+    meshlet.numIndices = (unsigned int)local.size();
+
+    meshlet.center = meshletBox.getCenter();
+    for (unsigned int v : meshletVertices)
+      meshlet.radius = std::max(meshlet.radius, glm::length(position(v) - meshlet.center));
+
+    // the cone has to hold every normal. Its cutoff is the sine of its half angle, see Meshlet
+    float axisLength = glm::length(normalSum);
+    if (axisLength > 0.f)
+    {
+      meshlet.coneAxis = normalSum / axisLength;
+      float minDot = 1.f;
+      for (size_t t : meshletTriangles)
+      {
+        if (normals[t] != glm::vec3(0.f))
+          minDot = std::min(minDot, glm::dot(normals[t], meshlet.coneAxis));
+      }
+      if (minDot > MESHLET_MIN_CONE_DOT)
+        meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+    }
+    data.meshlets.push_back(meshlet);
+
+    for (unsigned int v : meshletVertices)
+      localSlot[v] = UNUSED_VERTEX;
+    meshletVertices.clear();
+    meshletTriangles.clear();
+    meshletBox = AABB();
+    normalSum = glm::vec3(0.f);
+  };
+
+  size_t nextSeed = 0;
+  while (true)
+  {
+    // the unused triangle around the meshlet's vertices with the fewest new vertices, then the closest and most
+    // aligned one
+    size_t best = numTriangles;
+    if (!meshletTriangles.empty())
+    {
+      glm::vec3 center = meshletBox.getCenter();
+      glm::vec3 axis = glm::length(normalSum) > 0.f ? glm::normalize(normalSum) : glm::vec3(0.f);
+      unsigned int bestNewVertices = 4;
+      float bestCost = FLT_MAX;
+
+      for (unsigned int v : meshletVertices)
+      {
+        for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+        {
+          unsigned int t = adjacency[a];
+          if (isUsed[t]) continue;
+
+          unsigned int newVertices = countNewVertices(t);
+          if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES || newVertices > bestNewVertices) continue;
+
+          float cost = (1.f - glm::dot(normals[t], axis)) + glm::length(centroids[t] - center) / (edgeLength * 8.f);
+          if (newVertices < bestNewVertices || cost < bestCost)
+          {
+            best = t;
+            bestNewVertices = newVertices;
+            bestCost = cost;
+          }
+        }
+      }
+    }
+
+    // nothing connected fits: carry on from the first triangle left in the old order. It only joins the current
+    // meshlet if it's close by, so the bounds stay tight
+    if (best == numTriangles)
+    {
+      while (nextSeed < numTriangles && isUsed[nextSeed]) nextSeed++;
+      if (nextSeed == numTriangles) break;
+
+      if (!meshletTriangles.empty() &&
+          (meshletVertices.size() + countNewVertices(nextSeed) > MESHLET_MAX_VERTICES ||
+           glm::length(centroids[nextSeed] - meshletBox.getCenter()) > glm::length(meshletBox.getExtents()) + edgeLength * 2.f))
+        finishMeshlet();
+      best = nextSeed;
+    }
+
+    addTriangle(best);
+    if (meshletTriangles.size() == MESHLET_MAX_TRIANGLES)
+      finishMeshlet();
+  }
+
+  if (!meshletTriangles.empty())
+    finishMeshlet();
+
+  data.indices.swap(result);
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+struct PrimitiveData;
+
+// how well an index order uses a FIFO post-transform cache
+struct VertexCacheStats
+{
+  // vertices transformed per triangle: 3 is no reuse at all, around 0.5 is the best a closed mesh can get
+  float acmr = 0.f;
+
+  // vertices transformed per vertex used: 1 is ideal
+  float atvr = 0.f;
+};
+
+struct MeshOptimizationStats
+{
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+// Import time reordering of a triangle mesh, so the GPU does less work drawing exactly the same triangles:
+//  - optimizeVertexCache orders triangles so vertices are reused while still in the post-transform cache (Forsyth)
+//  - optimizeOverdraw moves whole clusters of those triangles around so the outward facing ones are drawn first,
+//    and the ones behind them fail the depth test, giving up a little cache efficiency (Sander et al.)
+//  - optimizeVertexFetch renumbers the vertices in the order they're first used, so fetches walk the vertex buffer
+//    front to back
+// Levels of detail come from simplify, which collapses edges in order of quadric error (Garland & Heckbert) by moving
+// vertices onto their neighbours, so every level still indexes the original vertices.
+// buildMeshlets regroups the triangles into small connected clusters with their own bounds, so the renderer can skip
+// the parts of a big mesh that are off screen or facing away.
+// Everything works on one mesh only, so different meshes can be optimized on different threads.
+class MeshOptimizer
+{
+public:
+  // cache size the triangle order is tuned for
+  static const unsigned int CACHE_SIZE = 32;
+
+  // FIFO cache size ACMR / ATVR are measured with, and overdraw clusters are formed with
+  static const unsigned int ANALYZE_CACHE_SIZE = 16;
+
+  // overdraw clusters may cost this much more ACMR than the cache optimized order
+  static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+  // levels of detail per mesh including the full one, each aiming for LOD_REDUCTION of the previous one's triangles
+  static const int MAX_LODS = 4;
+  static constexpr float LOD_REDUCTION = .5f;
+
+  // no levels below this many triangles, or that stray further than this fraction of the mesh's size
+  static const unsigned int MIN_LOD_TRIANGLES = 64;
+  static constexpr float LOD_MAX_RELATIVE_ERROR = .1f;
+
+  // meshlet limits (the sizes mesh shaders like), and meshes with fewer triangles than MIN_MESHLETS full meshlets are
+  // left whole
+  static const unsigned int MESHLET_MAX_VERTICES = 64;
+  static const unsigned int MESHLET_MAX_TRIANGLES = 124;
+  static const unsigned int MIN_MESHLETS = 4;
+
+  // meshlets get no normal cone once a triangle's normal is this close to perpendicular to the average
+  static constexpr float MESHLET_MIN_CONE_DOT = .1f;
+
+  static VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int numVertices,
+    unsigned int cacheSize = ANALYZE_CACHE_SIZE);
+
+  static void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices);
+
+  // positions are 3 floats per vertex. indices should already be cache optimized
+  static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& positions,
+    float threshold = OVERDRAW_THRESHOLD);
+
+  // renumber the vertices in order of first use, reordering every attribute of data to match.
+  // Vertices no triangle uses are dropped
+  static void optimizeVertexFetch(PrimitiveData& data);
+
+  // all of the above in order. Meshes without indices get 0..n-1 first. With withMeshlets, buildMeshlets regroups the
+  // overdraw order before the vertices are renumbered, so the stats after are of the order that's uploaded
+  static MeshOptimizationStats optimize(PrimitiveData& data, bool withMeshlets = false);
+
+  // collapse edges until there are at most targetIndexCount indices left, or the next collapse would move the surface
+  // further than targetError. Vertices on open borders and on attribute seams (several vertices at one position) stay
+  // where they are. error is set to the largest deviation accepted, as a distance in the mesh's units
+  static std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices, const std::vector<float>& positions,
+    size_t targetIndexCount, float targetError, float& error);
+
+  // fill data.lods with simplified, cache optimized index buffers. Stops early once a level barely removes anything
+  static void buildLods(PrimitiveData& data);
+
+  // reorder data.indices into meshlets and fill data.meshlets. Each meshlet grows over shared vertices from the first
+  // triangle left in the current order, preferring triangles that add the fewest vertices and face its way, and its
+  // triangles are cache optimized on their own. Should run before buildLods, which keeps its own orders, and in
+  // place of a vertex cache / overdraw order rather than after one (see optimize)
+  static void buildMeshlets(PrimitiveData& data);
+};
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "./Asset.h"
+#include "./RenderQueue.h"
 #include "../utils/Logger.h"
 
 void Asset::addModel(const std::string& key, Model* model, bool addAsChild)
@@ -35,15 +36,19 @@ void Asset::copyTo(Cloneable* cloned) const
     return;
   }
 
-  for (auto pair : _mModels)
+  // one pass over both trees, then every model is a single lookup
+  NodeRemap remap;
+  mapClonedNodes(clonedAsset, remap);
+
+  for (auto& pair : _mModels)
   {
-    std::string key = pair.first;
+    const std::string& key = pair.first;
     Model* model = pair.second;
 
-    auto findModel = breadthFirstSearch(model);
-    if (findModel.size() > 0)
+    auto it = remap.find(model);
+    if (it != remap.end())
     {
-      Model* clonedModel = dynamic_cast<Model*>(clonedAsset->getDescendentByIndices(findModel));
+      Model* clonedModel = dynamic_cast<Model*>(it->second);
       if (clonedModel)
         clonedAsset->_mModels[key] = clonedModel;
       else
@@ -64,6 +69,13 @@ Asset* Asset::clone() const
 }
 
 
+void Asset::setSkeleton(Skeleton* skeleton, const std::vector<Material*>& materials)
+{
+  _mSkeleton = skeleton;
+  _mAllMaterials = materials;
+  _mSkinnedMaterials = getMaterialsPerProgram(materials);
+}
+
 void Asset::removeModel(const std::string& name)
 {
   _mModels.erase(name);
@@ -85,12 +97,10 @@ void Asset::update(float deltaT)
 }
 
 
-void Asset::draw(const glm::mat4& PV)
+std::vector<Material*> Asset::getMaterialsPerProgram(const std::vector<Material*>& materials)
 {
-
   std::map<const ShaderProgram*, Material*> uniqueMats;
-
-  for (Material*& mat : allMaterials)
+  for (Material* mat : materials)
   {
     const ShaderProgram* p = mat->getProgram();
     if (uniqueMats.find(p) == uniqueMats.end())
@@ -99,33 +109,75 @@ void Asset::draw(const glm::mat4& PV)
     }
   }
 
-  if (skeleton) {
-    if (isAnimationStarted && currentAnimationIdx >= 0)
-    {
-      Animation* anim = skeleton->getAnimation(currentAnimationIdx);
-      std::vector<glm::mat4> boneMatrices = skeleton->calcBoneMatrices(currentAnimationIdx, currentAnimationMs);
-
-      for (auto it : uniqueMats)
-      {
-        it.second->setBoneMatrices(boneMatrices);
-        it.second->setUseBoneTransform(true);
-      }
-    }
-    else
-    {
-      const std::vector<glm::mat4>& boneMatrices = skeleton->getBindPoseMatrices();
-      for (auto it : uniqueMats)
-      {
-        it.second->setBoneMatrices(boneMatrices);
-        it.second->setUseBoneTransform(true);
-      }
-    }
+  std::vector<Material*> ret;
+  for (auto it : uniqueMats)
+  {
+    ret.push_back(it.second);
   }
+  return ret;
+}
 
-  Node::draw(PV);
+// poses for immediate draws, which only happen on the GL thread
+static std::vector<AffineTransform> _sPoseScratch;
+static std::vector<glm::mat4> _sPoseMatrices;
 
-  for (auto it : uniqueMats)
+void Asset::bindSkeletonPose(const Skeleton* skeleton, const std::vector<Material*>& materials,
+  int animationIdx, double animationMs, bool isAnimationStarted)
+{
+  if (!skeleton) return;
+
+  // one palette shared by every program
+  if (isAnimationStarted && animationIdx >= 0)
+  {
+    _sPoseMatrices.resize(skeleton->getNumBones());
+    skeleton->calcBoneMatrices(animationIdx, animationMs, _sPoseScratch, _sPoseMatrices.data());
+    Material::setBoneMatrices(_sPoseMatrices);
+  }
+  else
+    Material::setBoneMatrices(skeleton->getBindPoseMatrices());
+
+  for (Material* mat : materials)
+    mat->setUseBoneTransform(true);
+}
+
+void Asset::unbindSkeletonPose(const std::vector<Material*>& materials)
+{
+  for (Material* mat : materials)
   {
-    it.second->setUseBoneTransform(false);
+    mat->setUseBoneTransform(false);
   }
+}
+
+int Asset::addSkeletonPose(RenderQueue& queue, const Skeleton* skeleton,
+  int animationIdx, double animationMs, bool isAnimationStarted)
+{
+  if (!skeleton) return -1;
+
+  if (!isAnimationStarted || animationIdx < 0)
+    return queue.addBonePalette(skeleton->getBindPoseMatrices());
+
+  // computed straight into the queue's palette
+  int palette = queue.addBonePalette(int(skeleton->getNumBones()));
+  skeleton->calcBoneMatrices(animationIdx, animationMs, queue.getPoseScratch(), queue.getBonePalette(palette));
+  return palette;
+}
+
+void Asset::draw(const glm::mat4& PV)
+{
+  bindSkeletonPose(_mSkeleton, _mSkinnedMaterials, currentAnimationIdx, currentAnimationMs, isAnimationStarted);
+
+  Node::draw(PV);
+
+  unbindSkeletonPose(_mSkinnedMaterials);
+}
+
+void Asset::collect(RenderQueue& queue)
+{
+  // every model below is drawn with this asset's pose
+  int palette = addSkeletonPose(queue, _mSkeleton, currentAnimationIdx, currentAnimationMs, isAnimationStarted);
+  int previous = queue.setBonePalette(palette);
+
+  Node::collect(queue);
+
+  queue.setBonePalette(previous);
 }
\ No newline at end of file
@@ -6,6 +6,12 @@ protected:
   std::map<std::string, Model*> _mModels;
   void copyTo(Cloneable* cloned) const override;
 
+  Skeleton* _mSkeleton = nullptr;
+  std::vector<Material*> _mAllMaterials;
+
+  // one of _mAllMaterials per shader program, for the bone matrices. Worked out once in setSkeleton, not every draw
+  std::vector<Material*> _mSkinnedMaterials;
+
 public:
 
   void addModel(const std::string& name, Model* model, bool addAsChild=false);
@@ -13,8 +19,11 @@ public:
   void removeModel(const std::string& name);
   std::map<std::string, Model*> getAllModels() const;
 
-  Skeleton* skeleton = nullptr;
-  std::vector<Material*> allMaterials;
+  // the skeleton animating this asset, and every material of its models
+  void setSkeleton(Skeleton* skeleton, const std::vector<Material*>& materials);
+  Skeleton* getSkeleton() const { return _mSkeleton; }
+  const std::vector<Material*>& getAllMaterials() const { return _mAllMaterials; }
+  const std::vector<Material*>& getSkinnedMaterials() const { return _mSkinnedMaterials; }
 
   // animation state...
   double currentAnimationMs = 0;
@@ -23,6 +32,19 @@ public:
 
   Asset* clone() const override;
 
+  // one material per shader program, for setting per-program uniforms like the bone matrices
+  static std::vector<Material*> getMaterialsPerProgram(const std::vector<Material*>& materials);
+
+  // set a skeleton's current pose (an animation frame, or the bind pose) on the given materials
+  static void bindSkeletonPose(const Skeleton* skeleton, const std::vector<Material*>& materials, 
+    int animationIdx, double animationMs, bool isAnimationStarted);
+  static void unbindSkeletonPose(const std::vector<Material*>& materials);
+
+  // store a skeleton's current pose in a render queue, returns the palette index (-1 without a skeleton)
+  static int addSkeletonPose(RenderQueue& queue, const Skeleton* skeleton,
+    int animationIdx, double animationMs, bool isAnimationStarted);
+
   virtual void update(float deltaT) override;
   virtual void draw(const glm::mat4& PV) override;
+  virtual void collect(RenderQueue& queue) override;
 };
\ No newline at end of file
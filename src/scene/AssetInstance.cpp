@@ -0,0 +1,287 @@
+#include "AssetInstance.h"
+#include "RenderQueue.h"
+
+AssetPrototype::AssetPrototype(const Asset* source)
+{
+  if (!source)
+  {
+    Log.print<Severity::warning>("Trying to create an AssetPrototype from a null asset!");
+    return;
+  }
+
+  _mSkeleton = source->getSkeleton();
+  _mSkinnedMaterials = source->getSkinnedMaterials();
+
+  // depth first, with each node's transform relative to the root built on the way down
+  std::vector<std::pair<const Node*, AffineTransform>> stack;
+  for (const Node* child : source->getChildren())
+  {
+    stack.push_back(std::make_pair(child, AffineTransform()));
+  }
+
+  while (!stack.empty())
+  {
+    const Node* node = stack.back().first;
+    AffineTransform parentTransform = stack.back().second;
+    stack.pop_back();
+
+    AffineTransform transform = parentTransform
+      * AffineTransform::fromTRS(node->getPosition(), node->getRotationQuaternion(), node->getScale());
+
+    const Model* model = dynamic_cast<const Model*>(node);
+    if (model && model->getPrimitive())
+    {
+      Part part;
+      part.model = model;
+      part.transform = transform;
+      _mParts.push_back(part);
+      _mLocalBounds.expand(model->getPrimitive()->getLocalBounds().transformed(transform));
+    }
+
+    for (const Node* child : node->getChildren())
+    {
+      stack.push_back(std::make_pair(child, transform));
+    }
+  }
+}
+
+AssetPrototype::~AssetPrototype()
+{}
+
+AssetInstance::AssetInstance(const AssetPrototype* prototype)
+  : Node(), _mPrototype(prototype)
+{}
+
+AssetInstance::~AssetInstance()
+{}
+
+void AssetInstance::copyTo(Cloneable* cloned) const
+{
+  Node::copyTo(cloned);
+  AssetInstance* instance = dynamic_cast<AssetInstance*>(cloned);
+  if (!instance)
+  {
+    Log.print<Severity::warning>("Failed to cast to AssetInstance in clone");
+    return;
+  }
+
+  instance->currentAnimationMs = currentAnimationMs;
+  instance->currentAnimationIdx = currentAnimationIdx;
+  instance->isAnimationStarted = isAnimationStarted;
+}
+
+AssetInstance* AssetInstance::clone() const
+{
+  AssetInstance* instance = new AssetInstance(_mPrototype);
+  copyTo(instance);
+  return instance;
+}
+
+void AssetInstance::update(float deltaT)
+{
+  if (isAnimationStarted)
+  {
+    currentAnimationMs += deltaT;
+  }
+
+  Node::update(deltaT);
+}
+
+bool AssetInstance::getWorldBounds(AABB& bounds)
+{
+  if (!_mPrototype || _mPrototype->getLocalBounds().isEmpty()) return false;
+
+  bounds = _mPrototype->getLocalBounds().transformed(getGlobalAffineTransform());
+  return true;
+}
+
+void AssetInstance::draw(const glm::mat4& PV)
+{
+  if (_mPrototype)
+  {
+    const std::vector<Material*>& skinnedMaterials = _mPrototype->getSkinnedMaterials();
+    Asset::bindSkeletonPose(_mPrototype->getSkeleton(), skinnedMaterials,
+      currentAnimationIdx, currentAnimationMs, isAnimationStarted);
+
+    const AffineTransform& world = getGlobalAffineTransform();
+    for (const AssetPrototype::Part& part : _mPrototype->getParts())
+    {
+      part.model->drawPrimitive(PV, world * part.transform);
+    }
+
+    Asset::unbindSkeletonPose(skinnedMaterials);
+  }
+
+  Node::draw(PV);
+}
+
+void AssetInstance::collect(RenderQueue& queue)
+{
+  if (_mPrototype)
+  {
+    int palette = Asset::addSkeletonPose(queue, _mPrototype->getSkeleton(),
+      currentAnimationIdx, currentAnimationMs, isAnimationStarted);
+    int previous = queue.setBonePalette(palette);
+
+    const AffineTransform& world = getGlobalAffineTransform();
+    for (const AssetPrototype::Part& part : _mPrototype->getParts())
+    {
+      queue.add(part.model, world * part.transform);
+    }
+
+    queue.setBonePalette(previous);
+  }
+
+  Node::collect(queue);
+}
+
+AssetInstanceBatch::AssetInstanceBatch(const AssetPrototype* prototype)
+  : Node(), _mPrototype(prototype)
+{}
+
+AssetInstanceBatch::~AssetInstanceBatch()
+{}
+
+void AssetInstanceBatch::copyTo(Cloneable* cloned) const
+{
+  Node::copyTo(cloned);
+  AssetInstanceBatch* batch = dynamic_cast<AssetInstanceBatch*>(cloned);
+  if (!batch)
+  {
+    Log.print<Severity::warning>("Failed to cast to AssetInstanceBatch in clone");
+    return;
+  }
+
+  batch->_mRecords = _mRecords;
+  batch->_mLocalBounds = _mLocalBounds;
+  batch->_mBoundsDirty = _mBoundsDirty;
+}
+
+AssetInstanceBatch* AssetInstanceBatch::clone() const
+{
+  AssetInstanceBatch* batch = new AssetInstanceBatch(_mPrototype);
+  copyTo(batch);
+  return batch;
+}
+
+void AssetInstanceBatch::_touch()
+{
+  setPosition(getPosition());
+}
+
+int AssetInstanceBatch::add(const AffineTransform& transform)
+{
+  AssetInstanceRecord record;
+  record.transform = transform;
+  _mRecords.push_back(record);
+
+  // growing never needs a rebuild
+  if (_mPrototype && !_mBoundsDirty)
+  {
+    _mLocalBounds.expand(_mPrototype->getLocalBounds().transformed(transform));
+  }
+  _touch();
+  return int(_mRecords.size()) - 1;
+}
+
+void AssetInstanceBatch::setTransform(int idx, const AffineTransform& transform)
+{
+  _mRecords[idx].transform = transform;
+  _mBoundsDirty = true;
+  _touch();
+}
+
+void AssetInstanceBatch::clear()
+{
+  _mRecords.clear();
+  _mLocalBounds = AABB();
+  _mBoundsDirty = false;
+  _touch();
+}
+
+void AssetInstanceBatch::update(float deltaT)
+{
+  for (AssetInstanceRecord& record : _mRecords)
+  {
+    if (record.isAnimationStarted)
+    {
+      record.animationMs += deltaT;
+    }
+  }
+
+  Node::update(deltaT);
+}
+
+bool AssetInstanceBatch::getWorldBounds(AABB& bounds)
+{
+  if (!_mPrototype || _mPrototype->getLocalBounds().isEmpty() || _mRecords.empty()) return false;
+
+  if (_mBoundsDirty)
+  {
+    _mLocalBounds = AABB();
+    for (const AssetInstanceRecord& record : _mRecords)
+    {
+      _mLocalBounds.expand(_mPrototype->getLocalBounds().transformed(record.transform));
+    }
+    _mBoundsDirty = false;
+  }
+
+  bounds = _mLocalBounds.transformed(getGlobalAffineTransform());
+  return true;
+}
+
+void AssetInstanceBatch::draw(const glm::mat4& PV)
+{
+  if (_mPrototype)
+  {
+    const std::vector<Material*>& skinnedMaterials = _mPrototype->getSkinnedMaterials();
+    const AffineTransform& world = getGlobalAffineTransform();
+    for (const AssetInstanceRecord& record : _mRecords)
+    {
+      Asset::bindSkeletonPose(_mPrototype->getSkeleton(), skinnedMaterials,
+        record.animationIdx, record.animationMs, record.isAnimationStarted);
+
+      AffineTransform instanceWorld = world * record.transform;
+      for (const AssetPrototype::Part& part : _mPrototype->getParts())
+      {
+        part.model->drawPrimitive(PV, instanceWorld * part.transform);
+      }
+    }
+
+    Asset::unbindSkeletonPose(skinnedMaterials);
+  }
+
+  Node::draw(PV);
+}
+
+void AssetInstanceBatch::collect(RenderQueue& queue)
+{
+  if (_mPrototype)
+  {
+    const AffineTransform& world = getGlobalAffineTransform();
+    int previous = queue.setBonePalette(-1);
+
+    // every copy that isn't animating shares one bind pose palette
+    int bindPosePalette = -2;
+    for (const AssetInstanceRecord& record : _mRecords)
+    {
+      bool isAnimating = record.isAnimationStarted && record.animationIdx >= 0;
+      if (!isAnimating && bindPosePalette == -2)
+      {
+        bindPosePalette = Asset::addSkeletonPose(queue, _mPrototype->getSkeleton(), -1, 0, false);
+      }
+      queue.setBonePalette(isAnimating ? Asset::addSkeletonPose(queue, _mPrototype->getSkeleton(),
+        record.animationIdx, record.animationMs, true) : bindPosePalette);
+
+      AffineTransform instanceWorld = world * record.transform;
+      for (const AssetPrototype::Part& part : _mPrototype->getParts())
+      {
+        queue.add(part.model, instanceWorld * part.transform);
+      }
+    }
+
+    queue.setBonePalette(previous);
+  }
+
+  Node::collect(queue);
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+#include "./Asset.h"
+
+// A read-only snapshot of an Asset, shared by any number of AssetInstances.
+// The node tree is flattened into its models and their transforms relative to the asset root,
+// so drawing an instance doesn't walk (or even need) the original hierarchy.
+// Later changes to the source asset's tree are not picked up.
+class AssetPrototype
+{
+public:
+  struct Part
+  {
+    const Model* model;
+
+    // the model's transform relative to the asset root
+    AffineTransform transform;
+  };
+
+protected:
+  std::vector<Part> _mParts;
+
+  // bounds of every part, relative to the asset root
+  AABB _mLocalBounds;
+  // shared by every instance, so it's only read: poses are computed into the caller's scratch
+  const Skeleton* _mSkeleton = nullptr;
+
+  // one material per shader program, for the bone matrices
+  std::vector<Material*> _mSkinnedMaterials;
+
+public:
+  AssetPrototype(const Asset* source);
+  AssetPrototype(const AssetPrototype& other) = delete;
+  virtual ~AssetPrototype();
+
+  const std::vector<Part>& getParts() const { return _mParts; }
+  const Skeleton* getSkeleton() const { return _mSkeleton; }
+  const AABB& getLocalBounds() const { return _mLocalBounds; }
+  const std::vector<Material*>& getSkinnedMaterials() const { return _mSkinnedMaterials; }
+};
+
+
+// A placed copy of an asset: its own transform and animation state on top of a shared AssetPrototype.
+// It's a single node, so updating it costs the same no matter how big the asset is, and
+// drawing it goes straight through the prototype's models.
+// Being a full Node it still costs a few hundred bytes plus an entry in the TransformHierarchy;
+// for large crowds of copies, use an AssetInstanceBatch instead
+class AssetInstance : public Node
+{
+protected:
+  const AssetPrototype* _mPrototype;
+
+  virtual void copyTo(Cloneable* cloned) const override;
+
+public:
+  // animation state...
+  double currentAnimationMs = 0;
+  int currentAnimationIdx = -1;
+  bool isAnimationStarted = false;
+
+  // the prototype has to outlive the instance
+  AssetInstance(const AssetPrototype* prototype);
+  virtual ~AssetInstance();
+
+  const AssetPrototype* getPrototype() const { return _mPrototype; }
+
+  virtual AssetInstance* clone() const override;
+
+  virtual void update(float deltaT) override;
+  virtual void draw(const glm::mat4& PV) override;
+  virtual void collect(RenderQueue& queue) override;
+
+  // the prototype's bounds under this instance's transform
+  virtual bool getWorldBounds(AABB& bounds) override;
+};
+
+
+// one copy in an AssetInstanceBatch: where it is relative to the batch, and its animation state
+struct AssetInstanceRecord
+{
+  AffineTransform transform;
+  double animationMs = 0;
+  int animationIdx = -1;
+  bool isAnimationStarted = false;
+};
+
+
+// Many copies of one prototype under a single node. Each copy is a plain AssetInstanceRecord instead of a Node,
+// so it has no hierarchy entry, name or children: moving one means calling setTransform.
+// The batch is culled as a whole, so keep the copies of a batch close together
+class AssetInstanceBatch : public Node
+{
+protected:
+  const AssetPrototype* _mPrototype;
+  std::vector<AssetInstanceRecord> _mRecords;
+
+  // the prototype's bounds under every record, relative to the batch. Rebuilt lazily after records move
+  AABB _mLocalBounds;
+  bool _mBoundsDirty = false;
+
+  // the records changed: re-set the batch's own position so the next sweep bumps its world version,
+  // and the scene refits its bounds
+  void _touch();
+
+  virtual void copyTo(Cloneable* cloned) const override;
+
+public:
+  // the prototype has to outlive the batch
+  AssetInstanceBatch(const AssetPrototype* prototype);
+  virtual ~AssetInstanceBatch();
+
+  const AssetPrototype* getPrototype() const { return _mPrototype; }
+
+  // add a copy, returns its index
+  int add(const AffineTransform& transform);
+  void setTransform(int idx, const AffineTransform& transform);
+  void clear();
+
+  // the animation state can be changed directly, it doesn't affect the bounds
+  AssetInstanceRecord& getRecord(int idx) { return _mRecords[idx]; }
+  const std::vector<AssetInstanceRecord>& getRecords() const { return _mRecords; }
+  int size() const { return int(_mRecords.size()); }
+
+  virtual AssetInstanceBatch* clone() const override;
+
+  virtual void update(float deltaT) override;
+  virtual void draw(const glm::mat4& PV) override;
+  virtual void collect(RenderQueue& queue) override;
+
+  // the bounds of every copy under the batch's transform
+  virtual bool getWorldBounds(AABB& bounds) override;
+};
\ No newline at end of file
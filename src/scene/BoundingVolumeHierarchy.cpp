@@ -0,0 +1,413 @@
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+
+const float BoundingVolumeHierarchy::FAT_MARGIN = .1f;
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{}
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{}
+
+int BoundingVolumeHierarchy::_allocateNode()
+{
+  if (_mFreeList == NULL_NODE)
+  {
+    _mNodes.push_back(TreeNode());
+    return int(_mNodes.size()) - 1;
+  }
+
+  // free nodes are chained through their parent index
+  int idx = _mFreeList;
+  _mFreeList = _mNodes[idx].parent;
+  _mNodes[idx] = TreeNode();
+  return idx;
+}
+
+void BoundingVolumeHierarchy::_freeNode(int idx)
+{
+  TreeNode& n = _mNodes[idx];
+  n.node = nullptr;
+  n.left = n.right = NULL_NODE;
+  n.height = -1;
+  n.parent = _mFreeList;
+  _mFreeList = idx;
+}
+
+void BoundingVolumeHierarchy::_insertLeaf(int leaf)
+{
+  if (_mRoot == NULL_NODE)
+  {
+    _mRoot = leaf;
+    _mNodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // walk down towards the cheapest sibling, by surface area
+  AABB leafBox = _mNodes[leaf].box;
+  int idx = _mRoot;
+  while (!_mNodes[idx].isLeaf())
+  {
+    const TreeNode& n = _mNodes[idx];
+    float area = n.box.getSurfaceArea();
+    float combinedArea = AABB::merge(n.box, leafBox).getSurfaceArea();
+
+    // cost of making a new parent for this node and the leaf, and the cost pushed down to the children
+    float cost = 2.f * combinedArea;
+    float inheritanceCost = 2.f * (combinedArea - area);
+
+    float childCosts[2];
+    int children[2] = { n.left, n.right };
+    for (int c = 0; c < 2; c++)
+    {
+      const TreeNode& child = _mNodes[children[c]];
+      float merged = AABB::merge(child.box, leafBox).getSurfaceArea();
+      childCosts[c] = (child.isLeaf() ? merged : merged - child.box.getSurfaceArea()) + inheritanceCost;
+    }
+
+    if (cost < childCosts[0] && cost < childCosts[1])
+      break;
+
+    idx = childCosts[0] < childCosts[1] ? children[0] : children[1];
+  }
+
+  int sibling = idx;
+  int oldParent = _mNodes[sibling].parent;
+  int newParent = _allocateNode();
+
+  TreeNode& p = _mNodes[newParent];
+  p.parent = oldParent;
+  p.box = AABB::merge(leafBox, _mNodes[sibling].box);
+  p.height = _mNodes[sibling].height + 1;
+  p.left = sibling;
+  p.right = leaf;
+  _mNodes[sibling].parent = newParent;
+  _mNodes[leaf].parent = newParent;
+
+  if (oldParent == NULL_NODE)
+    _mRoot = newParent;
+  else if (_mNodes[oldParent].left == sibling)
+    _mNodes[oldParent].left = newParent;
+  else
+    _mNodes[oldParent].right = newParent;
+
+  _refitUpwards(_mNodes[leaf].parent);
+}
+
+void BoundingVolumeHierarchy::_removeLeaf(int leaf)
+{
+  if (leaf == _mRoot)
+  {
+    _mRoot = NULL_NODE;
+    return;
+  }
+
+  int parent = _mNodes[leaf].parent;
+  int grandParent = _mNodes[parent].parent;
+  int sibling = _mNodes[parent].left == leaf ? _mNodes[parent].right : _mNodes[parent].left;
+
+  // the sibling takes the parent's place
+  if (grandParent == NULL_NODE)
+  {
+    _mRoot = sibling;
+    _mNodes[sibling].parent = NULL_NODE;
+    _freeNode(parent);
+    return;
+  }
+
+  if (_mNodes[grandParent].left == parent)
+    _mNodes[grandParent].left = sibling;
+  else
+    _mNodes[grandParent].right = sibling;
+  _mNodes[sibling].parent = grandParent;
+  _freeNode(parent);
+
+  _refitUpwards(grandParent);
+}
+
+void BoundingVolumeHierarchy::_refitUpwards(int idx)
+{
+  while (idx != NULL_NODE)
+  {
+    idx = _balance(idx);
+
+    TreeNode& n = _mNodes[idx];
+    const TreeNode& left = _mNodes[n.left];
+    const TreeNode& right = _mNodes[n.right];
+    n.box = AABB::merge(left.box, right.box);
+    n.height = 1 + std::max(left.height, right.height);
+
+    idx = n.parent;
+  }
+}
+
+int BoundingVolumeHierarchy::_balance(int iA)
+{
+  TreeNode& A = _mNodes[iA];
+  if (A.isLeaf() || A.height < 2) return iA;
+
+  int iB = A.left;
+  int iC = A.right;
+  TreeNode& B = _mNodes[iB];
+  TreeNode& C = _mNodes[iC];
+
+  int balance = C.height - B.height;
+
+  // C is too tall: rotate it up, and keep the taller of its children
+  if (balance > 1)
+  {
+    int iF = C.left;
+    int iG = C.right;
+    TreeNode& F = _mNodes[iF];
+    TreeNode& G = _mNodes[iG];
+
+    C.left = iA;
+    C.parent = A.parent;
+    A.parent = iC;
+
+    if (C.parent == NULL_NODE)
+      _mRoot = iC;
+    else if (_mNodes[C.parent].left == iA)
+      _mNodes[C.parent].left = iC;
+    else
+      _mNodes[C.parent].right = iC;
+
+    if (F.height > G.height)
+    {
+      C.right = iF;
+      A.right = iG;
+      G.parent = iA;
+      A.box = AABB::merge(B.box, G.box);
+      C.box = AABB::merge(A.box, F.box);
+      A.height = 1 + std::max(B.height, G.height);
+      C.height = 1 + std::max(A.height, F.height);
+    }
+    else
+    {
+      C.right = iG;
+      A.right = iF;
+      F.parent = iA;
+      A.box = AABB::merge(B.box, F.box);
+      C.box = AABB::merge(A.box, G.box);
+      A.height = 1 + std::max(B.height, F.height);
+      C.height = 1 + std::max(A.height, G.height);
+    }
+    return iC;
+  }
+
+  // B is too tall: same thing, mirrored
+  if (balance < -1)
+  {
+    int iD = B.left;
+    int iE = B.right;
+    TreeNode& D = _mNodes[iD];
+    TreeNode& E = _mNodes[iE];
+
+    B.left = iA;
+    B.parent = A.parent;
+    A.parent = iB;
+
+    if (B.parent == NULL_NODE)
+      _mRoot = iB;
+    else if (_mNodes[B.parent].left == iA)
+      _mNodes[B.parent].left = iB;
+    else
+      _mNodes[B.parent].right = iB;
+
+    if (D.height > E.height)
+    {
+      B.right = iD;
+      A.left = iE;
+      E.parent = iA;
+      A.box = AABB::merge(C.box, E.box);
+      B.box = AABB::merge(A.box, D.box);
+      A.height = 1 + std::max(C.height, E.height);
+      B.height = 1 + std::max(A.height, D.height);
+    }
+    else
+    {
+      B.right = iE;
+      A.left = iD;
+      D.parent = iA;
+      A.box = AABB::merge(C.box, D.box);
+      B.box = AABB::merge(A.box, E.box);
+      A.height = 1 + std::max(C.height, D.height);
+      B.height = 1 + std::max(A.height, E.height);
+    }
+    return iB;
+  }
+
+  return iA;
+}
+
+int BoundingVolumeHierarchy::insert(Node* node, const AABB& bounds)
+{
+  int leaf = _allocateNode();
+  TreeNode& n = _mNodes[leaf];
+  n.box = bounds.grown(FAT_MARGIN);
+  n.node = node;
+  n.height = 0;
+
+  _insertLeaf(leaf);
+  _mLeafCount++;
+  return leaf;
+}
+
+void BoundingVolumeHierarchy::remove(int proxy)
+{
+  if (proxy < 0 || proxy >= int(_mNodes.size()) || _mNodes[proxy].height != 0)
+  {
+    Log.print<Severity::warning>("Trying to remove an invalid proxy from the BVH!");
+    return;
+  }
+
+  _removeLeaf(proxy);
+  _freeNode(proxy);
+  _mLeafCount--;
+}
+
+bool BoundingVolumeHierarchy::move(int proxy, const AABB& bounds)
+{
+  if (proxy < 0 || proxy >= int(_mNodes.size()) || _mNodes[proxy].height != 0)
+  {
+    Log.print<Severity::warning>("Trying to move an invalid proxy in the BVH!");
+    return false;
+  }
+
+  // still inside its fat box - nothing to do
+  if (_mNodes[proxy].box.contains(bounds))
+    return false;
+
+  _removeLeaf(proxy);
+  _mNodes[proxy].box = bounds.grown(FAT_MARGIN);
+  _insertLeaf(proxy);
+  return true;
+}
+
+void BoundingVolumeHierarchy::clear()
+{
+  _mNodes.clear();
+  _mRoot = NULL_NODE;
+  _mFreeList = NULL_NODE;
+  _mLeafCount = 0;
+}
+
+void BoundingVolumeHierarchy::_collectLeaves(int idx, std::vector<Node*>& out) const
+{
+  size_t stackBase = _mStack.size();
+  _mStack.push_back(idx);
+  while (_mStack.size() > stackBase)
+  {
+    const TreeNode& n = _mNodes[_mStack.back()];
+    _mStack.pop_back();
+
+    if (n.isLeaf())
+    {
+      out.push_back(n.node);
+      continue;
+    }
+    _mStack.push_back(n.left);
+    _mStack.push_back(n.right);
+  }
+}
+
+void BoundingVolumeHierarchy::queryFrustum(const Frustum& frustum, std::vector<Node*>& out) const
+{
+  if (_mRoot == NULL_NODE) return;
+
+  _mStack.clear();
+  _mStack.push_back(_mRoot);
+  while (!_mStack.empty())
+  {
+    int idx = _mStack.back();
+    _mStack.pop_back();
+    const TreeNode& n = _mNodes[idx];
+
+    Frustum::TestResult result = frustum.test(n.box);
+    if (result == Frustum::TestResult::outside) continue;
+
+    // fully inside: everything below is visible without testing it
+    if (result == Frustum::TestResult::inside || n.isLeaf())
+    {
+      _collectLeaves(idx, out);
+      continue;
+    }
+
+    _mStack.push_back(n.left);
+    _mStack.push_back(n.right);
+  }
+}
+
+void BoundingVolumeHierarchy::querySphere(const BoundingSphere& sphere, std::vector<Node*>& out) const
+{
+  if (_mRoot == NULL_NODE) return;
+
+  _mStack.clear();
+  _mStack.push_back(_mRoot);
+  while (!_mStack.empty())
+  {
+    const TreeNode& n = _mNodes[_mStack.back()];
+    _mStack.pop_back();
+    if (!sphere.intersects(n.box)) continue;
+
+    if (n.isLeaf())
+    {
+      out.push_back(n.node);
+      continue;
+    }
+    _mStack.push_back(n.left);
+    _mStack.push_back(n.right);
+  }
+}
+
+void BoundingVolumeHierarchy::queryAABB(const AABB& box, std::vector<Node*>& out) const
+{
+  if (_mRoot == NULL_NODE) return;
+
+  _mStack.clear();
+  _mStack.push_back(_mRoot);
+  while (!_mStack.empty())
+  {
+    const TreeNode& n = _mNodes[_mStack.back()];
+    _mStack.pop_back();
+    if (!box.intersects(n.box)) continue;
+
+    if (n.isLeaf())
+    {
+      out.push_back(n.node);
+      continue;
+    }
+    _mStack.push_back(n.left);
+    _mStack.push_back(n.right);
+  }
+}
+
+void BoundingVolumeHierarchy::queryRay(const Ray& ray, float maxDistance, std::vector<Hit>& out) const
+{
+  if (_mRoot == NULL_NODE) return;
+
+  size_t first = out.size();
+  _mStack.clear();
+  _mStack.push_back(_mRoot);
+  while (!_mStack.empty())
+  {
+    const TreeNode& n = _mNodes[_mStack.back()];
+    _mStack.pop_back();
+
+    float distance;
+    if (!ray.intersects(n.box, maxDistance, distance)) continue;
+
+    if (n.isLeaf())
+    {
+      Hit hit;
+      hit.node = n.node;
+      hit.distance = distance;
+      out.push_back(hit);
+      continue;
+    }
+    _mStack.push_back(n.left);
+    _mStack.push_back(n.right);
+  }
+
+  std::sort(out.begin() + first, out.end(), [](const Hit& a, const Hit& b) { return a.distance < b.distance; });
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include "../utils/Bounds.h"
+#include "../utils/Logger.h"
+
+class Node;
+
+// A dynamic AABB tree over scene nodes.
+// Leaves store a "fat" box (the real bounds grown by a margin), so small movements only need a
+// containment check; a leaf is taken out and reinserted only once it leaves its fat box, and the
+// tree is rebalanced with rotations on the way up. Nodes live in one array and are recycled
+// through a free list, so moving things around doesn't allocate.
+//
+// Queries report the nodes whose fat box passes the test, so callers wanting an exact answer
+// should check the real bounds of what comes back.
+class BoundingVolumeHierarchy
+{
+public:
+  // how much leaf boxes are grown by, in world units
+  static const float FAT_MARGIN;
+
+  struct Hit
+  {
+    Node* node;
+
+    // distance along the ray where it enters the node's box
+    float distance;
+  };
+
+protected:
+  static const int NULL_NODE = -1;
+
+  struct TreeNode
+  {
+    AABB box;
+    Node* node = nullptr;
+    int parent = NULL_NODE;
+    int left = NULL_NODE;
+    int right = NULL_NODE;
+
+    // leaves are 0, free nodes -1
+    int height = -1;
+
+    bool isLeaf() const { return left == NULL_NODE; }
+  };
+
+  std::vector<TreeNode> _mNodes;
+  int _mRoot = NULL_NODE;
+  int _mFreeList = NULL_NODE;
+  int _mLeafCount = 0;
+
+  // scratch stack for the queries
+  mutable std::vector<int> _mStack;
+
+  int _allocateNode();
+  void _freeNode(int idx);
+
+  void _insertLeaf(int leaf);
+  void _removeLeaf(int leaf);
+
+  // rotate around idx if its children's heights differ by more than one. Returns the new subtree root
+  int _balance(int idx);
+
+  // recompute boxes and heights from idx up to the root
+  void _refitUpwards(int idx);
+
+  // push every leaf under idx
+  void _collectLeaves(int idx, std::vector<Node*>& out) const;
+
+public:
+  BoundingVolumeHierarchy();
+  virtual ~BoundingVolumeHierarchy();
+
+  // add a node with its world bounds. Returns a proxy id, used to move or remove it
+  int insert(Node* node, const AABB& bounds);
+  void remove(int proxy);
+
+  // update a proxy's bounds. Returns true if the tree had to change
+  bool move(int proxy, const AABB& bounds);
+
+  // fat bounds of a proxy
+  const AABB& getFatBounds(int proxy) const { return _mNodes[proxy].box; }
+  int getCount() const { return _mLeafCount; }
+  int getHeight() const { return _mRoot == NULL_NODE ? 0 : _mNodes[_mRoot].height; }
+
+  void clear();
+
+  // nodes whose boxes are in (or cross) the frustum
+  void queryFrustum(const Frustum& frustum, std::vector<Node*>& out) const;
+  void querySphere(const BoundingSphere& sphere, std::vector<Node*>& out) const;
+  void queryAABB(const AABB& box, std::vector<Node*>& out) const;
+
+  // nodes whose boxes the ray crosses within maxDistance, sorted nearest first
+  void queryRay(const Ray& ray, float maxDistance, std::vector<Hit>& out) const;
+};
\ No newline at end of file
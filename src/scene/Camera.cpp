@@ -107,16 +107,14 @@ void PerspectiveCamera::setAspectRatio(float aspectRatio)
   }
 }
 
-void PerspectiveCamera::setProgramUniform(ShaderProgram& shaderProgram)
+void PerspectiveCamera::writeUniformBlock(CameraBlock& block)
 {
-  Uniform* minZUniform = shaderProgram.getUniformByName("camera.minZ");
-  Uniform* maxZUniform = shaderProgram.getUniformByName("camera.maxZ");
-  
-  if (minZUniform)
-    minZUniform->setUniform(_mMinZ);
-
-  if (maxZUniform)
-    maxZUniform->setUniform(_mMaxZ);
+  block.view = getViewMatrix();
+  block.projection = getProjectionMatrix();
+  block.projView = block.projection * block.view;
+  block.position = getAbsolutePosition();
+  block.minZ = _mMinZ;
+  block.maxZ = _mMaxZ;
 }
 
 void PerspectiveCamera::copyTo(Cloneable* cloned) const
@@ -184,15 +182,6 @@ const glm::vec3& TargetCamera::getUp() const
   return _mUp;
 }
 
-void TargetCamera::setProgramUniform(ShaderProgram& shaderProgram)
-{
-  PerspectiveCamera::setProgramUniform(shaderProgram);
-
-  Uniform* positionUniform = shaderProgram.getUniformByName("camera.position");
-  if (positionUniform)
-    positionUniform->setUniform(getAbsolutePosition());
-}
-
 void TargetCamera::copyTo(Cloneable* cloned) const
 {
   PerspectiveCamera::copyTo(cloned);
@@ -259,15 +248,6 @@ const glm::vec3& ForwardCamera::getUp() const
   return _mUp;
 }
 
-void ForwardCamera::setProgramUniform(ShaderProgram& shaderProgram)
-{
-  PerspectiveCamera::setProgramUniform(shaderProgram);
-
-  Uniform* positionUniform = shaderProgram.getUniformByName("camera.position");
-  if (positionUniform)
-    positionUniform->setUniform(getAbsolutePosition());
-}
-
 void ForwardCamera::copyTo(Cloneable* cloned) const
 {
   PerspectiveCamera::copyTo(cloned);
@@ -1,6 +1,6 @@
 #pragma once
 #include "Node.h"
-#include "../components/ShaderProgram.h"
+#include "FrameUniforms.h"
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -17,7 +17,8 @@ public:
   virtual const glm::mat4& forceComputeViewMatrix() = 0;
   virtual const glm::mat4& forceComputeProjectionMatrix() = 0;
   virtual void update(float deltaT) override = 0;
-  virtual void setProgramUniform(ShaderProgram& shaderProgram) = 0;
+  // fill in the camera block for this frame
+  virtual void writeUniformBlock(CameraBlock& block) = 0;
   virtual CameraBase* clone() const override = 0;
 };
 
@@ -70,7 +71,7 @@ public:
   void setFovy(float fovy);
   void setAspectRatio(float aspectRatio);
 
-  virtual void setProgramUniform(ShaderProgram& shaderProgram) override;
+  virtual void writeUniformBlock(CameraBlock& block) override;
   virtual PerspectiveCamera* clone() const override = 0;
 };
 
@@ -95,7 +96,6 @@ public:
   const glm::vec3& getTarget() const;
   const glm::vec3& getUp() const;
 
-  virtual void setProgramUniform(ShaderProgram& shaderProgram) override;
   virtual TargetCamera* clone() const override;
 };
 
@@ -120,7 +120,6 @@ public:
   const glm::vec3& getForwardDirection() const;
   const glm::vec3& getUp() const;
 
-  virtual void setProgramUniform(ShaderProgram& shaderProgram) override;
   virtual ForwardCamera* clone() const override;
 };
 
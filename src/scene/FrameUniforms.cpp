@@ -0,0 +1,37 @@
+#include "FrameUniforms.h"
+#include "Camera.h"
+#include "Light.h"
+#include "../components/GLStateCache.h"
+#include "../utils/Logger.h"
+#include <cstring>
+
+void FrameUniforms::_upload(GLuint binding, const void* data, size_t size)
+{
+  UploadAllocation allocation = _mUploadRing->allocate(size, UploadRing::getUniformAlignment());
+  if (!allocation.pointer) return;
+
+  std::memcpy(allocation.pointer, data, size);
+  GLStateCache::bindBufferRange(GL_UNIFORM_BUFFER, binding, allocation.buffer, allocation.offset, size);
+}
+
+void FrameUniforms::update(CameraBase* camera, const std::set<Light*>& lights)
+{
+  if (!_mUploadRing)
+  {
+    Log.print<Severity::warning>("No upload ring for the camera and lights");
+    return;
+  }
+
+  if (camera)
+  {
+    std::memset(&_mCamera, 0, sizeof(CameraBlock));
+    camera->writeUniformBlock(_mCamera);
+    _upload(CAMERA_BINDING, &_mCamera, sizeof(CameraBlock));
+  }
+
+  // unused slots stay zeroed, the shaders only read the first numPointLights / numDirLights
+  std::memset(&_mLights, 0, sizeof(LightBlock));
+  for (Light* light : lights)
+    light->writeUniformBlock(_mLights);
+  _upload(LIGHT_BINDING, &_mLights, sizeof(LightBlock));
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include "../components/UploadRing.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <set>
+
+class CameraBase;
+class Light;
+
+// std140 layout of CameraBlock in Phong.vs / Phong.fs
+struct CameraBlock
+{
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 projView;
+  glm::vec3 position;
+  float minZ;
+  float maxZ;
+  float _pad[3];
+};
+
+// std140 layout of the PointLight struct in Phong.fs - each float fills the 4th component of the vec3 before it
+struct PointLightBlock
+{
+  glm::vec3 position;
+  float constant;
+  glm::vec3 ambient;
+  float linear;
+  glm::vec3 diffuse;
+  float quadratic;
+  glm::vec3 specular;
+  float _pad;
+};
+
+// std140 layout of the DirLight struct in Phong.fs
+struct DirLightBlock
+{
+  glm::vec3 direction;
+  float _pad0;
+  glm::vec3 ambient;
+  float _pad1;
+  glm::vec3 diffuse;
+  float _pad2;
+  glm::vec3 specular;
+  float _pad3;
+};
+
+// std140 layout of LightBlock in Phong.fs
+struct LightBlock
+{
+  // NR_POINT_LIGHTS and NR_DIR_LIGHTS in Phong.fs
+  static const int MAX_POINT_LIGHTS = 4;
+  static const int MAX_DIR_LIGHTS = 4;
+
+  PointLightBlock pointLights[MAX_POINT_LIGHTS];
+  DirLightBlock dirLights[MAX_DIR_LIGHTS];
+  int numPointLights;
+  int numDirLights;
+  int _pad[2];
+};
+
+static_assert(sizeof(CameraBlock) == 224, "CameraBlock doesn't match the std140 layout");
+static_assert(sizeof(PointLightBlock) == 64, "PointLightBlock doesn't match the std140 layout");
+static_assert(sizeof(DirLightBlock) == 64, "DirLightBlock doesn't match the std140 layout");
+static_assert(sizeof(LightBlock) == 528, "LightBlock doesn't match the std140 layout");
+
+// The camera and the lights of a scene, packed into uniform blocks streamed through the upload ring once per frame.
+// Every program declares the same blocks at the same binding points, so nothing here depends on
+// how many programs are loaded - switching programs doesn't need any uniforms to be set again.
+class FrameUniforms
+{
+public:
+  // uniform buffer bindings of CameraBlock and LightBlock
+  static const GLuint CAMERA_BINDING = 1;
+  static const GLuint LIGHT_BINDING = 2;
+
+protected:
+  CameraBlock _mCamera;
+  LightBlock _mLights;
+
+  UploadRing* _mUploadRing = nullptr;
+
+  // copy a block into this frame's region of the ring and bind it there
+  void _upload(GLuint binding, const void* data, size_t size);
+
+public:
+  FrameUniforms() {}
+  FrameUniforms(const FrameUniforms& other) = delete;
+  virtual ~FrameUniforms() {}
+
+  void setUploadRing(UploadRing* ring) { _mUploadRing = ring; }
+
+  // pack the camera (if any) and the lights, upload them and bind both blocks.
+  // Lights past the shader's limit for their type are left out
+  void update(CameraBase* camera, const std::set<Light*>& lights);
+
+  const CameraBlock& getCamera() const { return _mCamera; }
+  const LightBlock& getLights() const { return _mLights; }
+};
\ No newline at end of file
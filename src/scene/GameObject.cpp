@@ -2,69 +2,50 @@
 #include "../utils/Logger.h"
 
 GameObjectBase::GameObjectBase()
-  : _mModelMatrix( glm::mat4(1.0f) ),
-  _mPositionMatrix( glm::mat4(1.0f) ),
-  _mRotationMatrix( glm::mat4(1.0f) ),
-  _mScaleMatrix( glm::mat4(1.0f) ),
-  _mPosition( glm::vec3(0) ),
-  _mRotationQuaternion( glm::quat(0,0,0,1) ),
-  _mScale( glm::vec3(1.f) ),
-  _mShouldUpdateModelMatrix( false )
-{}
-
-void GameObjectBase::_updateWorldMatrix()
-{
-  _mModelMatrix = _mPositionMatrix * _mRotationMatrix * _mScaleMatrix;
-}
-
-void GameObjectBase::_updatePositionMatrix()
-{
-  _mPositionMatrix = glm::translate(_mPosition);
-}
-void GameObjectBase::_updateScaleMatrix()
+  : _mHierarchy(TransformHierarchy::create()),
+  _mTransformIdx(0)
 {
-  _mScaleMatrix = glm::scale(_mScale);
+  _mTransformIdx = _mHierarchy->add(this);
 }
 
-void GameObjectBase::_updateRotationMatrix()
+GameObjectBase::~GameObjectBase()
 {
-  _mRotationMatrix = glm::toMat4(_mRotationQuaternion);
+  // the root entry owns the hierarchy; everything else goes away with it
+  if (_mTransformIdx == 0)
+  {
+    delete _mHierarchy;
+  }
+  _mHierarchy = nullptr;
 }
 
 void GameObjectBase::setPosition(const glm::vec3& pos)
 {
-  _mPosition = pos;
-  _updatePositionMatrix();
-  _mShouldUpdateModelMatrix = true;
+  _mHierarchy->setPosition(_mTransformIdx, pos);
 }
 
 void GameObjectBase::setScale(const glm::vec3& scale)
 {
-  _mScale = scale;
-  _updateScaleMatrix();
-  _mShouldUpdateModelMatrix = true;
+  _mHierarchy->setScale(_mTransformIdx, scale);
 }
 
 void GameObjectBase::setRotationQuaternion(const glm::quat& rotationQuaternion)
 {
-  _mRotationQuaternion = rotationQuaternion;
-  _updateRotationMatrix();
-  _mShouldUpdateModelMatrix = true;
+  _mHierarchy->setRotation(_mTransformIdx, rotationQuaternion);
 }
 
 const glm::vec3& GameObjectBase::getPosition() const
 {
-  return _mPosition;
+  return _mHierarchy->getPosition(_mTransformIdx);
 }
 
 const glm::vec3& GameObjectBase::getScale() const
 {
-  return _mScale;
+  return _mHierarchy->getScale(_mTransformIdx);
 }
 
 const glm::quat& GameObjectBase::getRotationQuaternion() const
 {
-  return _mRotationQuaternion;
+  return _mHierarchy->getRotation(_mTransformIdx);
 }
 
 void GameObjectBase::_copyTo(GameObjectBase* c) const
@@ -75,22 +56,22 @@ void GameObjectBase::_copyTo(GameObjectBase* c) const
     return;
   }
 
-  c->_mShouldUpdateModelMatrix = _mShouldUpdateModelMatrix;
-  c->_mModelMatrix = _mModelMatrix;
-  c->_mPositionMatrix = _mPositionMatrix;
-  c->_mScaleMatrix = _mScaleMatrix;
-  c->_mRotationMatrix = _mRotationMatrix;
-  c->_mPosition = _mPosition;
-  c->_mScale = _mScale;
-  c->_mRotationQuaternion = _mRotationQuaternion;
+  c->setPosition(getPosition());
+  c->setScale(getScale());
+  c->setRotationQuaternion(getRotationQuaternion());
+}
+
+glm::mat4 GameObjectBase::getTransform() const
+{
+  return _mHierarchy->getLocalMatrix(_mTransformIdx).toMat4();
 }
 
-const glm::mat4& GameObjectBase::getTransform() const
+unsigned int GameObjectBase::getWorldVersion() const
 {
-  return _mModelMatrix;
+  return _mHierarchy->getWorldVersion(_mTransformIdx);
 }
 
-const bool& GameObjectBase::isTransformDirty() const
+bool GameObjectBase::isTransformDirty() const
 {
-  return _mShouldUpdateModelMatrix;
+  return _mHierarchy->isLocalDirty(_mTransformIdx);
 }
\ No newline at end of file
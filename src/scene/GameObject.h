@@ -4,33 +4,25 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
+#include "TransformHierarchy.h"
 
+// a thin handle into the TransformHierarchy that stores this object's transform
 class GameObjectBase
 {
+  friend class TransformHierarchy;
+
 protected:
-  // cached matrices for faster updates
-  bool _mShouldUpdateModelMatrix;
-  glm::mat4 _mModelMatrix;
-  glm::mat4 _mPositionMatrix;
-  glm::mat4 _mScaleMatrix;
-  glm::mat4 _mRotationMatrix;
-
-  // note: using quaternion for rotation
-  glm::vec3 _mPosition;
-  glm::vec3 _mScale;
-  glm::quat _mRotationQuaternion;
-
-  // update world matrix
-  void _updateWorldMatrix();
-  void _updatePositionMatrix();
-  void _updateScaleMatrix();
-  void _updateRotationMatrix();
+  // where the transform lives - moved around by the hierarchy as trees are attached/detached
+  TransformHierarchy* _mHierarchy;
+  int _mTransformIdx;
 
   // for convenience only...
   void _copyTo(GameObjectBase* other) const;
 
 public:
   GameObjectBase();
+  GameObjectBase(const GameObjectBase& other) = delete;
+  virtual ~GameObjectBase();
 
   void setPosition(const glm::vec3& pos);
   void setScale(const glm::vec3& scale);
@@ -40,6 +32,9 @@ public:
   const glm::vec3& getScale() const;
   const glm::quat& getRotationQuaternion() const;
 
-  const glm::mat4& getTransform() const;
-  const bool& isTransformDirty() const;
+  glm::mat4 getTransform() const;
+  bool isTransformDirty() const;
+
+  // changes whenever the world transform is recomputed, so cached world space data can tell when it's stale
+  unsigned int getWorldVersion() const;
 };
\ No newline at end of file
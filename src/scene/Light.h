@@ -1,13 +1,12 @@
 #pragma once
 #include "Node.h"
-#include "../components/ShaderProgram.h"
+#include "FrameUniforms.h"
 
 class LightBase
 {
 public:
-  // set the light's uniforms in the shader
-  virtual void setProgramUniform(ShaderProgram& shaderProgram, int index) = 0;
-  virtual std::string getUniformName() const = 0;
+  // append the light to its array in the light block, if there's room left for its type
+  virtual void writeUniformBlock(LightBlock& block) = 0;
 };
 
 class Light : public LightBase, public Node {
@@ -10,36 +10,15 @@ DirLight::DirLight() :
 DirLight::~DirLight()
 {}
 
-void DirLight::setProgramUniform(ShaderProgram& shaderProgram, int index)
+void DirLight::writeUniformBlock(LightBlock& block)
 {
-  std::string uniformName = getUniformName() + "[" + std::to_string(index) + "]";
+  if (block.numDirLights >= LightBlock::MAX_DIR_LIGHTS) return;
 
-  std::string diffuseName = uniformName + ".diffuse";
-  std::string specularName = uniformName + ".specular";
-  std::string ambientName = uniformName + ".ambient";
-  std::string directionName = uniformName + ".direction";
-
-  Uniform* diffuseUniform = shaderProgram.getUniformByName(diffuseName);
-  Uniform* specularUniform = shaderProgram.getUniformByName(specularName);
-  Uniform* ambientUniform = shaderProgram.getUniformByName(ambientName);
-  Uniform* directionUniform = shaderProgram.getUniformByName(directionName);
-
-  if (diffuseUniform)
-    diffuseUniform->setUniform(diffuse);
-
-  if (specularUniform)
-    specularUniform->setUniform(specular);
-
-  if (ambientUniform)
-    ambientUniform->setUniform(ambient);
-
-  if (directionUniform)
-    directionUniform->setUniform(direction);
-}
-
-std::string DirLight::getUniformName() const
-{
-  return "dirLights";
+  DirLightBlock& light = block.dirLights[block.numDirLights++];
+  light.direction = direction;
+  light.ambient = ambient;
+  light.diffuse = diffuse;
+  light.specular = specular;
 }
 
 void DirLight::copyTo(Cloneable* other) const
@@ -17,8 +17,7 @@ public:
   DirLight();
   virtual ~DirLight();
 
-  virtual void setProgramUniform(ShaderProgram& shaderProgram, int index);
-  virtual std::string getUniformName() const;
+  virtual void writeUniformBlock(LightBlock& block) override;
 
   virtual DirLight* clone() const override;
 };
\ No newline at end of file
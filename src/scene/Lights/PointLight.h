@@ -26,7 +26,6 @@ public:
   PointLight();
   virtual ~PointLight();
 
-  virtual void setProgramUniform(ShaderProgram& shaderProgram, int index) override;
-  virtual std::string getUniformName() const override;
+  virtual void writeUniformBlock(LightBlock& block) override;
   virtual PointLight* clone() const override;
 };
\ No newline at end of file
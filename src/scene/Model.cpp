@@ -1,8 +1,9 @@
 #include "Model.h"
+#include "RenderQueue.h"
+#include "../components/GLStateCache.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
-#include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -17,34 +18,56 @@ void Model::draw(const glm::mat4& PV)
 {
   if (_mPrimitive == nullptr) return;
 
-  const glm::mat4& model = getGlobalTransform();
-  glm::mat4 PVM = PV * model;
-  glm::mat3 modelMat3(model);
-  glm::mat3 normal = glm::inverseTranspose(modelMat3);
+  drawPrimitive(PV, getGlobalAffineTransform());
+  Node::draw(PV);
+}
+
+void Model::collect(RenderQueue& queue)
+{
+  if (_mPrimitive == nullptr) return;
+
+  queue.add(this, getGlobalAffineTransform());
+  Node::collect(queue);
+}
+
+void Model::drawPrimitive(const glm::mat4& PV, const AffineTransform& transform, bool useMaterial) const
+{
+  if (_mPrimitive == nullptr) return;
+
+  glm::mat4 model = transform.toMat4();
+  glm::mat4 PVM = AffineTransform::multiply(PV, transform);
+  glm::mat3 normal = transform.normalMatrix();
 
   if (material != nullptr) 
   {
-    material->use();
+    if (useMaterial)
+      material->use();
     material->setModelMatrix(model);
     material->setNormalMatrix(normal);
     material->setProjViewModelMatrix(PVM);
+    material->setUseQuantizedVertices(_mPrimitive->isQuantized());
   }
 
-  // draw line if wire mesh
-  if (renderWireMesh) 
-  {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-  }
+  // draw line if wire mesh. Only actually changes when switching between wire and filled models
+  GLStateCache::polygonMode(renderWireMesh ? GL_LINE : GL_FILL);
 
   _mPrimitive->render();
+}
+
+bool Model::getWorldBounds(AABB& bounds)
+{
+  if (_mPrimitive == nullptr || _mPrimitive->getLocalBounds().isEmpty()) return false;
 
-  // revert
-  if (renderWireMesh) 
+  unsigned int version = getWorldVersion();
+  if (!_mHasWorldBounds || version != _mWorldBoundsVersion)
   {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    _mWorldBounds = _mPrimitive->getLocalBounds().transformed(getGlobalAffineTransform());
+    _mWorldBoundsVersion = version;
+    _mHasWorldBounds = true;
   }
 
-  Node::draw(PV);
+  bounds = _mWorldBounds;
+  return true;
 }
 
 void Model::copyTo(Cloneable* cloned) const
@@ -9,6 +9,11 @@ class Model : public Node
 protected:
   const Primitive* _mPrimitive;
 
+  // primitive bounds in world space, and the world version they were computed for
+  AABB _mWorldBounds;
+  unsigned int _mWorldBoundsVersion = 0;
+  bool _mHasWorldBounds = false;
+
 public:
   // material to render the model...
   Material* material = nullptr;
@@ -21,6 +26,16 @@ public:
   Model(const Primitive* primitive = nullptr);
   virtual ~Model();
   virtual void draw(const glm::mat4& PV) override;
+  virtual void collect(RenderQueue& queue) override;
+
+  // draw only this model's primitive, with the given world transform instead of its own.
+  // If useMaterial is false, the material is expected to be in use already (only the matrices are set)
+  void drawPrimitive(const glm::mat4& PV, const AffineTransform& transform, bool useMaterial = true) const;
+
+  const Primitive* getPrimitive() const { return _mPrimitive; }
+
+  // the primitive's bounds under the current world transform, recomputed only when the transform changes
+  virtual bool getWorldBounds(AABB& bounds) override;
 
   virtual Model* clone() const override;
 };
\ No newline at end of file
@@ -1,22 +1,61 @@
 #include "Node.h"
+#include "../utils/NameTable.h"
 #include <glm/gtx/matrix_decompose.hpp>
 
-Node::Node(): GameObjectBase(), _mParentGlobalTransform(1.0f), _mGlobalTransformCache(1.0f) {}
+Node* Node::_sCloneParent = nullptr;
+unsigned int Node::_sCullFrame = 1;
+
+// every node is prefixed with the arena it came from (nullptr for the heap), padded to keep the node 16 byte aligned
+static const size_t NODE_HEADER_SIZE = 16;
+
+void* Node::operator new(size_t size)
+{
+  NodeArena* arena = NodeArena::getActive();
+  char* memory = arena
+    ? static_cast<char*>(arena->allocate(size + NODE_HEADER_SIZE))
+    : static_cast<char*>(::operator new(size + NODE_HEADER_SIZE));
+
+  *reinterpret_cast<NodeArena**>(memory) = arena;
+  return memory + NODE_HEADER_SIZE;
+}
+
+void Node::operator delete(void* ptr)
+{
+  if (!ptr) return;
+
+  char* memory = static_cast<char*>(ptr) - NODE_HEADER_SIZE;
+  NodeArena* arena = *reinterpret_cast<NodeArena**>(memory);
+  if (arena)
+    arena->deallocate();
+  else
+    ::operator delete(memory);
+}
+
+Node::Node(): GameObjectBase() {}
 
 Node::~Node()
 {
-  // make a copy as children will modify _mChildren
-  std::vector<Node*> childrenCopy = _mChildren;
+  // remove from parent first, so that this subtree owns its transforms
+  if (_mParent) {
+    _mParent->removeChild(this);
+  }
 
-  // destroy all children
-  for (Node* n : childrenCopy)
+  // the whole tree goes away together - no need to move transforms around
+  _mHierarchy->beginTeardown();
+
+  // unlink the children up front, so they don't each erase themselves from _mChildren (and reindex the rest)
+  std::vector<Node*> children;
+  children.swap(_mChildren);
+  for (Node* n : children)
   {
-    delete n;
+    n->_mParent = nullptr;
+    n->_mParentIdx = -1;
   }
 
-  // remove from parent
-  if (_mParent) {
-    _mParent->removeChild(this);
+  // destroy all children
+  for (Node* n : children)
+  {
+    delete n;
   }
 }
 
@@ -38,7 +77,11 @@ void Node::addChild(Node* n)
   _mChildren.push_back(n);
   n->_mParentIdx = _mChildren.size() - 1;
   n->_mParent = this;
-  n->_setParentGlobalTransform(getGlobalTransform());
+
+  // move the child's transforms (and its descendents') into this tree
+  TransformHierarchy* childHierarchy = n->_mHierarchy;
+  _mHierarchy->attach(*childHierarchy, _mTransformIdx);
+  TransformHierarchy::recycle(childHierarchy);
 }
 
 void Node::removeChild(Node* n)
@@ -65,7 +108,10 @@ void Node::removeChild(Node* n)
   _mChildren.erase(_mChildren.begin() + idx);
   n->_mParent = nullptr;
   n->_mParentIdx = -1;
-  n->_setParentGlobalTransform(glm::mat4(1.f));
+
+  // the child becomes the root of its own tree, taking its transforms along (the new hierarchy is owned by the child)
+  if (!_mHierarchy->isTearingDown())
+    _mHierarchy->detach(n->_mTransformIdx);
 
   for (auto it = _mChildren.begin() + idx; it != _mChildren.end(); it++)
   {
@@ -114,10 +160,53 @@ void Node::copyTo(Cloneable* cloned) const
     return;
   }
 
+  // join the cloned parent first (a single entry), then have the children join this one
+  Node* cloneParent = _sCloneParent;
+  _sCloneParent = nullptr;
+  if (cloneParent)
+  {
+    cloneParent->addChild(clonedNode);
+  }
+
   GameObjectBase::_copyTo(clonedNode);
+  clonedNode->_mHierarchy->setNameId(clonedNode->_mTransformIdx, _mHierarchy->getNameId(_mTransformIdx));
   for (auto child : _mChildren)
   {
-    clonedNode->addChild(child->clone());
+    _sCloneParent = clonedNode;
+    Node* clonedChild = child->clone();
+    _sCloneParent = nullptr;
+
+    // in case a subclass didn't go through Node::copyTo
+    if (clonedChild->_mParent != clonedNode)
+      clonedNode->addChild(clonedChild);
+  }
+}
+
+void Node::mapClonedNodes(const Node* cloned, NodeRemap& remap) const
+{
+  std::vector<std::pair<const Node*, Node*>> stack;
+  stack.push_back(std::make_pair(this, const_cast<Node*>(cloned)));
+
+  while (!stack.empty())
+  {
+    const Node* original = stack.back().first;
+    Node* copy = stack.back().second;
+    stack.pop_back();
+
+    remap[original] = copy;
+
+    const std::vector<Node*>& originalChildren = original->_mChildren;
+    const std::vector<Node*>& copyChildren = copy->_mChildren;
+    if (originalChildren.size() != copyChildren.size())
+    {
+      Log.print<Severity::warning>("Cloned tree does not match the original in mapClonedNodes!");
+      continue;
+    }
+
+    for (int i = 0; i < originalChildren.size(); i++)
+    {
+      stack.push_back(std::make_pair(originalChildren[i], copyChildren[i]));
+    }
   }
 }
 
@@ -184,71 +273,93 @@ Node* Node::getChildByIndex(int idx) const
   return _mChildren[idx];
 }
 
-Node* _findByName(const std::string& name, Node* current)
+void Node::setName(const std::string& name)
 {
-  if (current->name == name) return current;
-  auto children = current->getChildren();
-  for (auto child : children)
-  {
-    Node* found = _findByName(name, child);
-    if (found) return found;
-  }
-  return nullptr;
+  _mHierarchy->setNameId(_mTransformIdx, NameTable::intern(name));
+}
+
+const std::string& Node::getName() const
+{
+  return NameTable::getName(_mHierarchy->getNameId(_mTransformIdx));
 }
 
 Node* Node::findByName(const std::string& name) const
 {
-  return _findByName(name, const_cast<Node *>(this));
+  int idx = _mHierarchy->findByName(NameTable::find(name), _mTransformIdx);
+  if (idx < 0) return nullptr;
+
+  // every entry in a node tree belongs to a Node
+  return static_cast<Node*>(_mHierarchy->getOwner(idx));
 }
 
 void Node::draw(const glm::mat4& PV)
 {
   for (Node* n : _mChildren)
   {
-    n->draw(PV);
+    // a culled node never reaches its own draw, only the base one that walks its children
+    if (n->isCulled())
+      n->Node::draw(PV);
+    else
+      n->draw(PV);
+  }
+}
+
+void Node::collect(RenderQueue& queue)
+{
+  for (Node* n : _mChildren)
+  {
+    if (n->isCulled())
+      n->Node::collect(queue);
+    else
+      n->collect(queue);
   }
 }
 
+void Node::beginCullFrame()
+{
+  // 0 is what every node starts out with, so it never counts as culled
+  if (++_sCullFrame == 0)
+    _sCullFrame = 1;
+}
+
 void Node::update(float deltaT)
 {
-  forceComputeTransform();
+  // the root sweeps the transforms of the entire tree at once
+  if (!_mParent)
+    _mHierarchy->updateTransforms();
+
   for (auto& n : _mChildren)
     n->update(deltaT);
 }
 
 void Node::forceComputeTransform()
 {
-  if (_mShouldUpdateModelMatrix)
-  {
-    _updateWorldMatrix();
-    _mIsGlobalTransformDirty = true;
-    _mShouldUpdateModelMatrix = false;
-  }
+  _mHierarchy->computeTransform(_mTransformIdx);
+}
 
-  if (_mIsGlobalTransformDirty)
-  {
-    for (auto& child : _mChildren)
-      child->_setParentGlobalTransform(getGlobalTransform());
-  }
+void Node::sweepTransforms()
+{
+  _mHierarchy->updateTransforms();
+}
+
+void Node::setTransformWorkerPool(ThreadPool* pool)
+{
+  _mHierarchy->setWorkerPool(pool);
 }
 
-const glm::mat4& Node::getGlobalTransform() 
+glm::mat4 Node::getGlobalTransform() 
 {
-  if (_mIsGlobalTransformDirty) 
-    _mGlobalTransformCache = _mParentGlobalTransform * _mModelMatrix;
-  
-  return _mGlobalTransformCache;
+  return _mHierarchy->getWorldMatrix(_mTransformIdx).toMat4();
 }
 
-void Node::_setParentGlobalTransform(const glm::mat4& transform)
+const AffineTransform& Node::getGlobalAffineTransform()
 {
-  _mParentGlobalTransform = transform;
-  _mIsGlobalTransformDirty = true;
+  return _mHierarchy->getWorldMatrix(_mTransformIdx);
 }
 
 void Node::decomposeGlobalMatrix(glm::vec3& position, glm::quat& rotation, glm::vec3& scale)
 {
-  auto& matrix = getGlobalTransform();
+  glm::mat4 matrix = getGlobalTransform();
   glm::vec3 skew;
   glm::vec4 perspective;
   glm::decompose(matrix, scale, rotation, position, skew, perspective);
@@ -256,7 +367,5 @@ void Node::decomposeGlobalMatrix(glm::vec3& position, glm::quat& rotation, glm::
 
 glm::vec3 Node::getAbsolutePosition() 
 {
-  auto& matrix = getGlobalTransform();
-  glm::vec4 pos = matrix * glm::vec4(0, 0, 0, 1.f);
-  return glm::vec3(pos);
+  return getGlobalAffineTransform().getTranslation();
 }
\ No newline at end of file
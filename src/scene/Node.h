@@ -2,8 +2,17 @@
 #include "../utils/Cloneable.hpp"
 #include "../utils/Logger.h"
 #include "./GameObject.h"
+#include "./NodeArena.h"
+#include "../utils/Bounds.h"
 #include <glm/glm.hpp>
 #include <vector>
+#include <unordered_map>
+
+class Node;
+class RenderQueue;
+
+// original node -> its counterpart in a cloned tree
+typedef std::unordered_map<const Node*, Node*> NodeRemap;
 
 class Node : public Cloneable, public GameObjectBase
 {
@@ -17,33 +26,33 @@ private:
   // all my own children
   std::vector<Node*> _mChildren;
 
-protected:
-  virtual void copyTo(Cloneable* cloned) const override;
-
-  // a cache of the parent's transform in the previous draw call
-  glm::mat4 _mParentGlobalTransform;
+  // while cloning children, the cloned parent they should attach to as soon as they're created,
+  // so each transform entry is only appended once instead of being moved up level by level
+  static Node* _sCloneParent;
 
-  // a cache of current global transform
-  glm::mat4 _mGlobalTransformCache;
+  // frustum culling: a node marked with the current cull frame skips its own draw (but not its children's)
+  static unsigned int _sCullFrame;
+  unsigned int _mCulledFrame = 0;
 
-  // is the global transform cache dirty? - if the model matrix changes or parentGlobalTransform changes
-  bool _mIsGlobalTransformDirty = true;
-
-  // set global transform
-  void _setParentGlobalTransform(const glm::mat4& transform);
-
-public:
-  // an optional, public name, for convenience
-  std::string name;
+protected:
+  virtual void copyTo(Cloneable* cloned) const override;
 
 public:
   Node();
   virtual ~Node();
 
+  // nodes (and every subclass) go into the active NodeArena if there is one, and on the heap otherwise.
+  // Either way they are freed with a plain delete
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   // these should be inherited AND called from super class
   virtual void draw(const glm::mat4& PV);
   virtual void update(float deltaT);
 
+  // record this node's draws into a queue instead of drawing right away. Like draw, it should be inherited AND called
+  virtual void collect(RenderQueue& queue);
+
   // these should not be modified by super class
   void addChild(Node* n);
   void removeChild(Node* n);
@@ -52,7 +61,11 @@ public:
   Node* getRoot();
   const std::vector<Node*>& getChildren() const;
 
-  // find a node based on its name
+  // an optional name, for convenience. Names are interned (see NameTable) and indexed by the tree's root
+  void setName(const std::string& name);
+  const std::string& getName() const;
+
+  // find a node in this subtree (including itself) based on its name. A hash lookup in the root's name index, no tree walk
   Node* findByName(const std::string& name) const;
 
   // returns the indices of each parent in the order of child access when node is found. Empty vector if not found
@@ -65,15 +78,39 @@ public:
   // get a direct child
   Node* getChildByIndex(int idx) const;
 
+  // walk this tree alongside its clone (same shape) once, mapping every node to its counterpart
+  void mapClonedNodes(const Node* cloned, NodeRemap& remap) const;
+
   // clone implementation
   virtual Node* clone() const override;
 
   // get the absolute position of the node. Not guaranteed to be sync-ed to current frame unless forceComputeTransform is called.
-  const glm::mat4& getGlobalTransform();
+  // The whole tree is brought up to date by the root's update, in one sweep over its TransformHierarchy
+  glm::mat4 getGlobalTransform();
+
+  // same as getGlobalTransform, without expanding to a 4x4 matrix
+  const AffineTransform& getGlobalAffineTransform();
 
   // force recompute current transform - as well as parents
   void forceComputeTransform();
 
+  // bring every transform of the tree up to date in one sweep, like the root's update does, without updating the nodes
+  void sweepTransforms();
+
+  // split the transform sweep of this tree across a pool of threads (nullptr for single-threaded).
+  // Should be set on the root, as the setting belongs to the tree's TransformHierarchy
+  void setTransformWorkerPool(ThreadPool* pool);
+
+  // world space bounds of this node's own geometry (not its children). Returns false if it has none
+  virtual bool getWorldBounds(AABB&) { return false; }
+
+  // start a new culling pass, which un-culls every node marked in an earlier one
+  static void beginCullFrame();
+
+  // skip this node's own draw until the next cull pass. Its children are drawn (or culled) as usual
+  void markCulled() { _mCulledFrame = _sCullFrame; }
+  bool isCulled() const { return _mCulledFrame == _sCullFrame; }
+
   // decompose global transform
   void decomposeGlobalMatrix(glm::vec3& position, glm::quat& rotation, glm::vec3& scale);
   glm::vec3 getAbsolutePosition();
@@ -0,0 +1,69 @@
+#include "NodeArena.h"
+
+NodeArena* NodeArena::_sActive = nullptr;
+
+NodeArena::NodeArena()
+{}
+
+NodeArena::~NodeArena()
+{
+  for (char* block : _mBlocks)
+  {
+    delete[] block;
+  }
+  _mBlocks.clear();
+}
+
+void NodeArena::release()
+{
+  deallocate();
+}
+
+void* NodeArena::allocate(size_t size)
+{
+  // keep everything 16 byte aligned
+  size = (size + 15) & ~size_t(15);
+
+  // big objects get a block of their own, so the current block can still be filled up
+  if (size > BLOCK_SIZE)
+  {
+    char* block = new char[size];
+    _mBlocks.insert(_mBlocks.begin(), block);
+    _mBytesAllocated += size;
+    _mRefCount++;
+    return block;
+  }
+
+  if (_mBlockUsed + size > BLOCK_SIZE)
+  {
+    _mBlocks.push_back(new char[BLOCK_SIZE]);
+    _mBlockUsed = 0;
+  }
+
+  void* ret = _mBlocks.back() + _mBlockUsed;
+  _mBlockUsed += size;
+  _mBytesAllocated += size;
+  _mRefCount++;
+  return ret;
+}
+
+void NodeArena::deallocate()
+{
+  if (--_mRefCount == 0)
+  {
+    delete this;
+  }
+}
+
+NodeArena::Scope::Scope(NodeArena* arena)
+  : _mArena(arena), _mPrevious(_sActive)
+{
+  _sActive = arena;
+}
+
+NodeArena::Scope::~Scope()
+{
+  _sActive = _mPrevious;
+  if (_mArena)
+    _mArena->release();
+}
\ No newline at end of file
@@ -0,0 +1,564 @@
+#include "RenderQueue.h"
+#include "Model.h"
+#include "../components/GLStateCache.h"
+#include "../utils/Logger.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+  // positive floats keep their order as integers, so the top bits make a depth key without knowing the depth range.
+  // Anything at or behind the camera sorts first
+  uint64_t depthBits(float depth, int numBits)
+  {
+    if (!(depth > 0.f)) return 0;
+
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (31 - numBits);
+  }
+
+  const uint64_t TRANSLUCENT_BIT = 1ull << 63;
+}
+
+RenderStats RenderQueue::_sFrameStats;
+float RenderQueue::_sLodBias = 0.f;
+bool RenderQueue::_sClusterCulling = true;
+constexpr float RenderQueue::LOD_PIXEL_ERROR;
+
+void RenderQueue::begin(const glm::mat4& projView, float lodScale)
+{
+  _mProjView = projView;
+  _mLodScale = lodScale;
+  _mDepthRow = glm::vec4(projView[0][3], projView[1][3], projView[2][3], projView[3][3]);
+  _mFrustum = Frustum::fromMatrix(projView);
+  _mHasViewPosition = false;
+
+  _mPackets.clear();
+  _mTransforms.clear();
+  _mEntries.clear();
+  _mIndexRanges.clear();
+  _mClusterTriangles = 0;
+  _mCulledTriangles = 0;
+  _mCulledDrawTriangles = 0;
+  _mBoneMatrices.clear();
+  _mBonePaletteOffsets.clear();
+  _mCurrentBonePalette = -1;
+}
+
+uint64_t RenderQueue::_makeKey(const Model* model, const AffineTransform& transform, bool mirrored) const
+{
+  const Material* material = model->material;
+  uint64_t program = material && material->getProgram() ? material->getProgram()->getShaderProgramId() : 0;
+  uint64_t materialId = material ? material->getUniqueId() : 0;
+  uint64_t primitive = model->getPrimitive()->getUniqueId();
+  const GeometryArena* arena = model->getPrimitive()->getGeometry().arena;
+  uint64_t arenaId = arena ? arena->getId() : 0;
+  float depth = glm::dot(_mDepthRow, glm::vec4(transform.getTranslation(), 1.f));
+
+  uint64_t mirroredBit = mirrored ? 1 : 0;
+
+  // translucent: | 1 | depth (far first) : 24 | program : 12 | material : 16 | mirrored : 1 | primitive : 10 |
+  if (material && material->useAlphaBlending)
+  {
+    uint64_t farFirst = ~depthBits(depth, 24) & 0xFFFFFF;
+    return TRANSLUCENT_BIT | (farFirst << 39) | ((program & 0xFFF) << 27) | ((materialId & 0xFFFF) << 11) |
+      (mirroredBit << 10) | (primitive & 0x3FF);
+  }
+
+  // opaque: | 0 | program : 10 | material : 14 | mirrored : 1 | arena : 4 | primitive : 16 | depth (near first) : 18 |
+  return ((program & 0x3FF) << 53) | ((materialId & 0x3FFF) << 39) | (mirroredBit << 38) | ((arenaId & 0xF) << 34) | 
+    ((primitive & 0xFFFF) << 18) | depthBits(depth, 18);
+}
+
+int RenderQueue::_selectLod(const Primitive* primitive, const AffineTransform& transform) const
+{
+  const BoundingSphere& localSphere = primitive->getLocalSphere();
+  if (primitive->getLodCount() < 2 || _mLodScale <= 0.f || localSphere.isEmpty() || localSphere.radius <= 0.f) return 0;
+
+  // the nearest the mesh gets to the camera. From inside its sphere it's always drawn in full
+  BoundingSphere sphere = localSphere.transformed(transform);
+  float depth = glm::dot(_mDepthRow, glm::vec4(sphere.center, 1.f)) - sphere.radius;
+  if (depth <= 0.f) return 0;
+
+  // errors are in the primitive's own units, so they scale with the transform like the radius does
+  float pixelsPerUnit = _mLodScale * (sphere.radius / localSphere.radius) / depth;
+  return primitive->selectLod(pixelsPerUnit, LOD_PIXEL_ERROR * std::exp2(_sLodBias));
+}
+
+void RenderQueue::setViewPosition(const glm::vec3& position)
+{
+  _mViewPosition = position;
+  _mHasViewPosition = true;
+}
+
+bool RenderQueue::_cullClusters(DrawPacket& packet, const AffineTransform& transform)
+{
+  packet.firstRange = (int)_mIndexRanges.size();
+  packet.numRanges = -1;
+
+  // meshlets only cover the full mesh in its bind pose, and translucent draws are seen from behind
+  const Primitive* primitive = packet.model->getPrimitive();
+  const Material* material = packet.model->material;
+  const std::vector<Meshlet>& meshlets = primitive->getMeshlets();
+  if (!_sClusterCulling || meshlets.empty() || packet.lod != 0 || packet.bonePalette >= 0 ||
+      !material || material->useAlphaBlending) return true;
+
+  // with a uniform scale the spheres stay spheres and the cones keep their angles. Mirroring flips the winding
+  if (!transform.hasUniformScale()) return true;
+  glm::mat4 model = transform.toMat4();
+  glm::mat3 linear(model);
+  float scale = glm::length(linear[0]);
+  // back facing meshlets only go if GL would drop those triangles anyway
+  bool testCones = _mHasViewPosition && material->cullBackFaces && !packet.mirrored;
+
+  packet.numRanges = 0;
+  unsigned int numIndices = 0;
+  unsigned int numVisible = 0;
+  for (const Meshlet& meshlet : meshlets)
+  {
+    numIndices += meshlet.numIndices;
+
+    BoundingSphere sphere;
+    sphere.center = glm::vec3(model * glm::vec4(meshlet.center, 1.f));
+    sphere.radius = meshlet.radius * scale;
+    if (!_mFrustum.intersects(sphere)) continue;
+
+    if (testCones && meshlet.coneCutoff < 1.f)
+    {
+      glm::vec3 axis = linear * meshlet.coneAxis / scale;
+      glm::vec3 toCenter = sphere.center - _mViewPosition;
+      if (glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + sphere.radius) continue;
+    }
+
+    // meshlets are back to back in the index buffer, so neighbours that are both visible are one range
+    numVisible += meshlet.numIndices;
+    if (packet.numRanges > 0 && _mIndexRanges.back().firstIndex + _mIndexRanges.back().numIndices == meshlet.firstIndex)
+    {
+      _mIndexRanges.back().numIndices += meshlet.numIndices;
+    }
+    else
+    {
+      _mIndexRanges.push_back({ meshlet.firstIndex, meshlet.numIndices });
+      packet.numRanges++;
+    }
+  }
+
+  _mClusterTriangles += numIndices / 3;
+  _mCulledTriangles += (numIndices - numVisible) / 3;
+
+  // nothing culled, draw it like any other so it still batches
+  if (numVisible == numIndices)
+  {
+    _mIndexRanges.resize(packet.firstRange);
+    packet.numRanges = -1;
+  }
+  return numVisible > 0;
+}
+
+void RenderQueue::add(const Model* model, const AffineTransform& transform)
+{
+  if (!model || !model->getPrimitive()) return;
+
+  DrawPacket packet;
+  packet.model = model;
+  packet.transformIdx = (int)_mTransforms.size();
+  packet.bonePalette = _mCurrentBonePalette;
+  packet.lod = _selectLod(model->getPrimitive(), transform);
+
+  // only matters where back faces are culled, everything else batches whichever way it's facing
+  packet.mirrored = model->material && model->material->cullBackFaces && transform.isMirrored();
+  if (!_cullClusters(packet, transform))
+  {
+    _mCulledDrawTriangles += model->getPrimitive()->getLod(0).numIndices / 3;
+    return;
+  }
+
+  SortEntry entry;
+  entry.key = _makeKey(model, transform, packet.mirrored);
+  entry.packetIdx = (int)_mPackets.size();
+
+  _mTransforms.push_back(transform);
+  _mPackets.push_back(packet);
+  _mEntries.push_back(entry);
+}
+
+int RenderQueue::addBonePalette(const std::vector<glm::mat4>& matrices)
+{
+  _mBonePaletteOffsets.push_back((int)_mBoneMatrices.size());
+  _mBoneMatrices.insert(_mBoneMatrices.end(), matrices.begin(), matrices.end());
+  return (int)_mBonePaletteOffsets.size() - 1;
+}
+
+int RenderQueue::addBonePalette(int numBones)
+{
+  _mBonePaletteOffsets.push_back((int)_mBoneMatrices.size());
+  _mBoneMatrices.resize(_mBoneMatrices.size() + numBones);
+  return (int)_mBonePaletteOffsets.size() - 1;
+}
+
+int RenderQueue::setBonePalette(int palette)
+{
+  int previous = _mCurrentBonePalette;
+  _mCurrentBonePalette = palette;
+  return previous;
+}
+
+void RenderQueue::_radixSort()
+{
+  int count = (int)_mEntries.size();
+  if (count < 2) return;
+
+  // LSD radix sort, one byte per pass. All 8 histograms are built in a single read
+  unsigned int histograms[8][256] = {};
+  for (const SortEntry& entry : _mEntries)
+  {
+    for (int pass = 0; pass < 8; pass++)
+      histograms[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+  }
+
+  _mSortScratch.resize(count);
+  SortEntry* src = _mEntries.data();
+  SortEntry* dst = _mSortScratch.data();
+
+  for (int pass = 0; pass < 8; pass++)
+  {
+    unsigned int* histogram = histograms[pass];
+
+    // every key has the same byte here (e.g. a single program), nothing moves
+    if (histogram[(src[0].key >> (pass * 8)) & 0xFF] == (unsigned int)count) continue;
+
+    unsigned int offset = 0;
+    for (int i = 0; i < 256; i++)
+    {
+      unsigned int n = histogram[i];
+      histogram[i] = offset;
+      offset += n;
+    }
+
+    // stable, so the earlier passes' order is kept within each bucket
+    for (int i = 0; i < count; i++)
+      dst[histogram[(src[i].key >> (pass * 8)) & 0xFF]++] = src[i];
+
+    std::swap(src, dst);
+  }
+
+  if (src != _mEntries.data())
+    _mEntries.swap(_mSortScratch);
+}
+
+int RenderQueue::_getRunLength(int begin) const
+{
+  const DrawPacket& first = _mPackets[_mEntries[begin].packetIdx];
+
+  int end = begin + 1;
+  while (end < (int)_mEntries.size())
+  {
+    const DrawPacket& packet = _mPackets[_mEntries[end].packetIdx];
+    if (packet.model->getPrimitive() != first.model->getPrimitive() ||
+        packet.lod != first.lod ||
+        packet.numRanges >= 0 ||
+        packet.model->material != first.model->material ||
+        packet.model->renderWireMesh != first.model->renderWireMesh ||
+        packet.mirrored != first.mirrored)
+      break;
+    end++;
+  }
+
+  // without a material there's no program to read the instances. Culled draws have their own ranges
+  if (!first.model->material || first.numRanges >= 0) return 1;
+  return end - begin;
+}
+
+int RenderQueue::_getBucketLength(int begin) const
+{
+  const DrawPacket& first = _mPackets[_mEntries[begin].packetIdx];
+  const GeometryArena* arena = first.model->getPrimitive()->getGeometry().arena;
+
+  // indirect draws need a program to read the instances, and everything in one arena
+  if (!first.model->material || !arena || (_mEntries[begin].key & TRANSLUCENT_BIT)) return 1;
+
+  int end = begin + 1;
+  while (end < (int)_mEntries.size())
+  {
+    const DrawPacket& packet = _mPackets[_mEntries[end].packetIdx];
+    if ((_mEntries[end].key & TRANSLUCENT_BIT) ||
+        packet.model->getPrimitive()->getGeometry().arena != arena ||
+        packet.model->material != first.model->material ||
+        packet.model->renderWireMesh != first.model->renderWireMesh ||
+        packet.mirrored != first.mirrored)
+      break;
+    end++;
+  }
+  return end - begin;
+}
+
+void RenderQueue::_buildBatches()
+{
+  _mBatches.clear();
+  _mCommands.clear();
+
+  for (int i = 0; i < (int)_mEntries.size(); )
+  {
+    Batch batch;
+    batch.firstEntry = i;
+    batch.firstInstance = i;
+    batch.firstCommand = (int)_mCommands.size();
+    batch.numCommands = 0;
+
+    int bucket = _getBucketLength(i);
+    int run = _getRunLength(i);
+
+    if (bucket >= MIN_INSTANCES)
+    {
+      // one command per primitive in the bucket, each with that primitive's run of instances
+      batch.type = Batch::Type::multiDraw;
+      batch.numEntries = bucket;
+
+      for (int j = i; j < i + bucket; )
+      {
+        int primitiveRun = std::min(_getRunLength(j), i + bucket - j);
+        const DrawPacket& packet = _mPackets[_mEntries[j].packetIdx];
+        const GeometryRange& geometry = packet.model->getPrimitive()->getGeometry();
+        const PrimitiveLod& lod = packet.model->getPrimitive()->getLod(packet.lod);
+
+        // one command per visible range
+        if (packet.numRanges >= 0)
+        {
+          for (int r = packet.firstRange; r < packet.firstRange + packet.numRanges; r++)
+          {
+            DrawElementsIndirectCommand command;
+            command.count = _mIndexRanges[r].numIndices;
+            command.instanceCount = 1;
+            command.firstIndex = _mIndexRanges[r].firstIndex;
+            command.baseVertex = geometry.baseVertex;
+            command.baseInstance = (unsigned int)j;
+            _mCommands.push_back(command);
+            batch.numCommands++;
+          }
+          j += primitiveRun;
+          continue;
+        }
+
+        DrawElementsIndirectCommand command;
+        command.count = lod.numIndices;
+        command.instanceCount = primitiveRun;
+        command.firstIndex = lod.firstIndex;
+        command.baseVertex = geometry.baseVertex;
+        command.baseInstance = (unsigned int)j;
+        _mCommands.push_back(command);
+        batch.numCommands++;
+        j += primitiveRun;
+      }
+    }
+    else if (run >= MIN_INSTANCES)
+    {
+      batch.type = Batch::Type::instanced;
+      batch.numEntries = run;
+    }
+    else
+    {
+      batch.type = Batch::Type::single;
+      batch.numEntries = 1;
+    }
+
+    _mBatches.push_back(batch);
+    i += batch.numEntries;
+  }
+}
+
+void RenderQueue::_writeInstances(InstanceData* out) const
+{
+  auto task = [&](int begin, int end)
+  {
+    for (int i = begin; i < end; i++)
+    {
+      const DrawPacket& packet = _mPackets[_mEntries[i].packetIdx];
+      const AffineTransform& transform = _mTransforms[packet.transformIdx];
+      glm::mat3 normal = transform.normalMatrix();
+
+      // built on the stack and copied whole, since the mapping is write-combined memory
+      InstanceData data;
+      data.projViewModelMat = AffineTransform::multiply(_mProjView, transform);
+      data.modelMat = transform.toMat4();
+      data.normalMat[0] = glm::vec4(normal[0], 0.f);
+      data.normalMat[1] = glm::vec4(normal[1], 0.f);
+      data.normalMat[2] = glm::vec4(normal[2], 0.f);
+      data.boneOffset = packet.bonePalette >= 0 ? _mBonePaletteOffsets[packet.bonePalette] : -1;
+      data.quantizedVertices = packet.model->getPrimitive()->isQuantized() ? 1 : 0;
+      out[i] = data;
+    }
+  };
+
+  int count = (int)_mEntries.size();
+  if (_mWorkerPool)
+    _mWorkerPool->parallelFor(count, PARALLEL_INSTANCE_GRAIN, task);
+  else
+    task(0, count);
+}
+
+void RenderQueue::submit()
+{
+  if (!_mUploadRing)
+  {
+    Log.print<Severity::warning>("RenderQueue has no upload ring to stream its draws through");
+    return;
+  }
+
+  _radixSort();
+  _buildBatches();
+
+  // the matrices are written straight into the ring, it's mapped for the whole frame
+  int count = (int)_mEntries.size();
+  if (count > 0)
+  {
+    UploadAllocation instances = _mUploadRing->allocate(count * sizeof(InstanceData), UploadRing::getStorageAlignment());
+    if (!instances.pointer) return;
+
+    _writeInstances((InstanceData*)instances.pointer);
+    GLStateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_BUFFER_BINDING,
+      instances.buffer, instances.offset, instances.size);
+  }
+
+  // every palette of the frame in one copy
+  if (!_mBoneMatrices.empty())
+  {
+    size_t size = _mBoneMatrices.size() * sizeof(glm::mat4);
+    UploadAllocation bones = _mUploadRing->allocate(size, UploadRing::getStorageAlignment());
+    if (!bones.pointer) return;
+
+    std::memcpy(bones.pointer, _mBoneMatrices.data(), size);
+    GLStateCache::bindBufferRange(GL_SHADER_STORAGE_BUFFER, Material::BONE_BUFFER_BINDING, bones.buffer, bones.offset, size);
+  }
+
+  UploadAllocation commands;
+  if (!_mCommands.empty())
+  {
+    size_t size = _mCommands.size() * sizeof(DrawElementsIndirectCommand);
+    commands = _mUploadRing->allocate(size);
+    if (!commands.pointer) return;
+
+    std::memcpy(commands.pointer, _mCommands.data(), size);
+    GLStateCache::bindDrawIndirectBuffer(commands.buffer);
+  }
+
+  Material* lastMaterial = nullptr;
+  bool isBlending = false;
+
+  _mLastStats = RenderStats();
+  _mLastStats.draws = (unsigned int)_mEntries.size();
+  _mLastStats.fullTriangles = _mCulledDrawTriangles;
+  _mLastStats.clusterTriangles = _mClusterTriangles;
+  _mLastStats.culledTriangles = _mCulledTriangles;
+  for (const DrawPacket& packet : _mPackets)
+  {
+    const Primitive* primitive = packet.model->getPrimitive();
+    if (primitive->getLodCount() == 0) continue;
+
+    if (packet.numRanges >= 0)
+    {
+      for (int r = packet.firstRange; r < packet.firstRange + packet.numRanges; r++)
+        _mLastStats.triangles += _mIndexRanges[r].numIndices / 3;
+    }
+    else
+    {
+      _mLastStats.triangles += primitive->getLod(packet.lod).numIndices / 3;
+    }
+    _mLastStats.fullTriangles += primitive->getLod(0).numIndices / 3;
+  }
+
+  // materials instancing was turned on for
+  std::vector<Material*> instancedMaterials;
+
+  for (const Batch& batch : _mBatches)
+  {
+    const SortEntry& entry = _mEntries[batch.firstEntry];
+    const DrawPacket& packet = _mPackets[entry.packetIdx];
+    Material* material = packet.model->material;
+
+    if (!isBlending && (entry.key & TRANSLUCENT_BIT))
+    {
+      // everything opaque is drawn, so the depth buffer is complete: test against it, but don't write
+      GLStateCache::enable(GL_BLEND);
+      GLStateCache::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      GLStateCache::depthMask(false);
+      isBlending = true;
+    }
+
+    if (material && material != lastMaterial)
+    {
+      material->use();
+      lastMaterial = material;
+    }
+
+    // single sided materials have their back faces dropped by GL too. Mirrored draws are never batched with
+    // the others, and wind their front faces the other way
+    if (material && material->cullBackFaces)
+    {
+      GLStateCache::enable(GL_CULL_FACE);
+      GLStateCache::frontFace(packet.mirrored ? GL_CW : GL_CCW);
+    }
+    else
+      GLStateCache::disable(GL_CULL_FACE);
+
+    if (!material)
+    {
+      // no program to read the instances
+      packet.model->drawPrimitive(_mProjView, _mTransforms[packet.transformIdx], false);
+    }
+    else
+    {
+      material->setUseInstancing(true);
+      if (std::find(instancedMaterials.begin(), instancedMaterials.end(), material) == instancedMaterials.end())
+        instancedMaterials.push_back(material);
+
+      GLStateCache::polygonMode(packet.model->renderWireMesh ? GL_LINE : GL_FILL);
+
+      if (batch.type == Batch::Type::multiDraw)
+      {
+        // every primitive in the bucket shares the arena's VAO
+        packet.model->getPrimitive()->prepareRender();
+        glMultiDrawElementsIndirect(GL_TRIANGLES, packet.model->getPrimitive()->getGeometry().arena->getIndexType(),
+          (const void*)(commands.offset + batch.firstCommand * sizeof(DrawElementsIndirectCommand)), batch.numCommands, 0);
+        _mLastStats.multiDrawCalls++;
+      }
+      else if (packet.numRanges >= 0)
+      {
+        for (int r = packet.firstRange; r < packet.firstRange + packet.numRanges; r++)
+          packet.model->getPrimitive()->renderRange(_mIndexRanges[r].firstIndex, _mIndexRanges[r].numIndices, 1, batch.firstInstance);
+        _mLastStats.drawCalls += packet.numRanges - 1;
+      }
+      else
+      {
+        packet.model->getPrimitive()->renderInstanced(batch.numEntries, batch.firstInstance, packet.lod);
+        if (batch.type == Batch::Type::instanced)
+          _mLastStats.instancedDrawCalls++;
+      }
+      GLStateCache::checkErrors("RenderQueue::submit");
+    }
+
+    _mLastStats.drawCalls++;
+  }
+
+  // leave the programs the way immediate draws expect them
+  for (Material* material : instancedMaterials)
+    material->setUseInstancing(false);
+
+  GLStateCache::disable(GL_CULL_FACE);
+  GLStateCache::frontFace(GL_CCW);
+  if (isBlending)
+  {
+    GLStateCache::depthMask(true);
+    GLStateCache::disable(GL_BLEND);
+  }
+
+  _sFrameStats.draws += _mLastStats.draws;
+  _sFrameStats.drawCalls += _mLastStats.drawCalls;
+  _sFrameStats.instancedDrawCalls += _mLastStats.instancedDrawCalls;
+  _sFrameStats.multiDrawCalls += _mLastStats.multiDrawCalls;
+  _sFrameStats.triangles += _mLastStats.triangles;
+  _sFrameStats.fullTriangles += _mLastStats.fullTriangles;
+  _sFrameStats.clusterTriangles += _mLastStats.clusterTriangles;
+  _sFrameStats.culledTriangles += _mLastStats.culledTriangles;
+}
\ No newline at end of file
@@ -0,0 +1,266 @@
+#pragma once
+#include "../utils/AffineTransform.h"
+#include "../utils/Bounds.h"
+#include "../utils/ThreadPool.h"
+#include "../components/UploadRing.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class Model;
+class Primitive;
+
+// one draw, recorded during the scene traversal and issued once everything is sorted
+struct DrawPacket
+{
+  // the model supplies the material, primitive and wireframe setting
+  const Model* model;
+
+  // index of the world transform in the queue
+  int transformIdx;
+
+  // index of the bone palette in the queue, -1 if not skinned
+  int bonePalette;
+
+  // level of detail of the primitive to draw
+  int lod;
+
+  // the visible meshlets as ranges in the queue, numRanges is -1 to draw the whole level of detail
+  int firstRange;
+  int numRanges;
+
+  // back faces are culled and the transform flips the winding, so the front faces are clockwise
+  bool mirrored;
+};
+
+// draws asked for vs draw calls actually issued, once draws are instanced and merged into indirect draws
+struct RenderStats
+{
+  unsigned int draws = 0;
+  unsigned int drawCalls = 0;
+  unsigned int instancedDrawCalls = 0;
+  unsigned int multiDrawCalls = 0;
+
+  // triangles drawn at the selected levels of detail, and what the full meshes would have been
+  size_t triangles = 0;
+  size_t fullTriangles = 0;
+
+  // triangles in the meshlets tested by cluster culling, and how many of them were skipped
+  size_t clusterTriangles = 0;
+  size_t culledTriangles = 0;
+};
+
+// Draws are collected from the scene first and submitted afterwards, ordered by a 64 bit key:
+//  - opaque draws come first, grouped by program, material, geometry arena and primitive, and front-to-back within a group
+//  - translucent draws (Material::useAlphaBlending) come last, back-to-front, with blending on and depth writes off
+// Keys are radix sorted, so the order costs O(n) no matter how the tree is laid out.
+// Opaque, unskinned draws of a primitive's full detail with meshlets are culled meshlet by meshlet against the frustum,
+// and for single sided materials (Material::cullBackFaces, drawn with GL_CULL_FACE) against their normal cones given
+// the view position. Only the visible index ranges are drawn.
+// After sorting, every opaque draw of one material out of one arena is adjacent, and the whole bucket is
+// a single glMultiDrawElementsIndirect, with one command per primitive. Translucent runs of the same primitive
+// and material become instanced draws.
+// The matrices of every draw are computed in one pass (split across the worker pool, if there is one) straight into a
+// this frame's region of the upload ring, in sorted order, so the shaders find them by instance index and no
+// draw sets any matrix uniforms.
+class RenderQueue
+{
+public:
+  // shader storage binding of the per-instance transforms (InstanceBuffer in Phong.vs)
+  static const int INSTANCE_BUFFER_BINDING = 0;
+
+  // runs and buckets smaller than this are drawn one by one
+  static const int MIN_INSTANCES = 2;
+
+  // draws per worker chunk when computing the matrices
+  static const int PARALLEL_INSTANCE_GRAIN = 256;
+
+  // a level of detail is used while its error covers at most this many pixels (before the bias)
+  static constexpr float LOD_PIXEL_ERROR = 1.f;
+
+protected:
+  // the layout glMultiDrawElementsIndirect reads
+  struct DrawElementsIndirectCommand
+  {
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+  };
+
+  // sorted entries that are issued together
+  struct Batch
+  {
+    enum class Type { single, instanced, multiDraw };
+
+    Type type;
+    int firstEntry;
+    int numEntries;
+
+    // its first instance in the instance buffer (same as firstEntry). multiDraw: its commands in the indirect buffer
+    int firstInstance;
+    int firstCommand;
+    int numCommands;
+  };
+
+  // layout of InstanceData in Phong.vs (std430: the mat3 columns are padded to vec4s)
+  struct InstanceData
+  {
+    glm::mat4 projViewModelMat;
+    glm::mat4 modelMat;
+    glm::vec4 normalMat[3];
+
+    // first matrix of the draw's palette in the bone buffer, -1 if not skinned
+    int boneOffset;
+
+    // 1 if the primitive is in a quantized vertex layout
+    int quantizedVertices;
+    int _pad[2];
+  };
+
+  // totals over all queues submitted since the last resetFrameStats()
+  static RenderStats _sFrameStats;
+
+  // scales the allowed error of every level of detail by 2^bias
+  static float _sLodBias;
+
+  static bool _sClusterCulling;
+
+  // a run of visible meshlets
+  struct IndexRange
+  {
+    unsigned int firstIndex;
+    unsigned int numIndices;
+  };
+
+  struct SortEntry
+  {
+    uint64_t key;
+    int packetIdx;
+  };
+
+  glm::mat4 _mProjView;
+
+  // 4th row of projView, for the clip space w (view depth) of a point
+  glm::vec4 _mDepthRow;
+
+  // pixels covered by one unit at a view depth of 1, 0 to always draw the full meshes
+  float _mLodScale = 0.f;
+
+  Frustum _mFrustum;
+
+  // camera position for the meshlet cone tests, which are skipped without one
+  glm::vec3 _mViewPosition;
+  bool _mHasViewPosition = false;
+
+  std::vector<IndexRange> _mIndexRanges;
+
+  // cluster culling totals of this frame's adds, and the full detail triangles of draws culled entirely
+  size_t _mClusterTriangles = 0;
+  size_t _mCulledTriangles = 0;
+  size_t _mCulledDrawTriangles = 0;
+
+  std::vector<DrawPacket> _mPackets;
+  std::vector<AffineTransform> _mTransforms;
+  std::vector<SortEntry> _mEntries;
+  std::vector<SortEntry> _mSortScratch;
+
+  std::vector<Batch> _mBatches;
+
+  // where the instances, palettes and indirect commands of every submit go
+  UploadRing* _mUploadRing = nullptr;
+
+  ThreadPool* _mWorkerPool = nullptr;
+
+  // indirect commands of every batch this frame, copied into the ring in one go
+  std::vector<DrawElementsIndirectCommand> _mCommands;
+
+  RenderStats _mLastStats;
+
+  // every palette of the frame back to back, and where each one starts. Draws only carry their offset,
+  // so skinned draws batch like any other, whatever pose they're in
+  std::vector<glm::mat4> _mBoneMatrices;
+  std::vector<int> _mBonePaletteOffsets;
+
+  // palette applied to models added from now on
+  int _mCurrentBonePalette = -1;
+
+  // per bone transforms while a skeleton's pose is computed straight into a palette, reused all frame
+  std::vector<AffineTransform> _mPoseScratch;
+
+  uint64_t _makeKey(const Model* model, const AffineTransform& transform, bool mirrored) const;
+
+  // level of detail from the primitive's projected size
+  int _selectLod(const Primitive* primitive, const AffineTransform& transform) const;
+
+  // fill the packet's ranges with its visible meshlets. Returns false if none are
+  bool _cullClusters(DrawPacket& packet, const AffineTransform& transform);
+  void _radixSort();
+
+  // number of entries starting at begin that can be drawn as instances of one draw
+  int _getRunLength(int begin) const;
+
+  // number of opaque entries starting at begin that can go into one indirect draw
+  int _getBucketLength(int begin) const;
+
+  void _buildBatches();
+
+  // compute the matrices of every sorted entry into out
+  void _writeInstances(InstanceData* out) const;
+
+public:
+  RenderQueue() {}
+  RenderQueue(const RenderQueue& other) = delete;
+  virtual ~RenderQueue() {}
+
+  // drop last frame's draws and start collecting for a new camera. lodScale is the pixels one unit covers at a view
+  // depth of 1 (viewport height / 2 / tan(fovy / 2)), 0 to always draw the full meshes
+  void begin(const glm::mat4& projView, float lodScale = 0.f);
+
+  // world position of the camera, so meshlets facing away can be culled. Call after begin, before adding
+  void setViewPosition(const glm::vec3& position);
+
+  // record a draw of model with a world transform. Models without a primitive are ignored
+  void add(const Model* model, const AffineTransform& transform);
+
+  // append bone matrices to this frame's palettes and return the palette's index
+  int addBonePalette(const std::vector<glm::mat4>& matrices);
+
+  // append an uninitialized palette of numBones matrices and return its index. Fill it through getBonePalette
+  // before adding more palettes, which may move it
+  int addBonePalette(int numBones);
+  glm::mat4* getBonePalette(int palette) { return _mBoneMatrices.data() + _mBonePaletteOffsets[palette]; }
+
+  // scratch for computing a pose into a palette (see Skeleton::calcBoneMatrices)
+  std::vector<AffineTransform>& getPoseScratch() { return _mPoseScratch; }
+
+  // set the palette for the models added next (-1 for none), returns the previous one
+  int setBonePalette(int palette);
+
+  // sort and issue every draw
+  void submit();
+
+  // frame ring the draws are streamed through. Nothing is submitted without one
+  void setUploadRing(UploadRing* ring) { _mUploadRing = ring; }
+
+  // threads for computing the per-draw matrices, nullptr for the calling thread only
+  void setWorkerPool(ThreadPool* pool) { _mWorkerPool = pool; }
+
+  int getCount() const { return (int)_mPackets.size(); }
+  const glm::mat4& getProjView() const { return _mProjView; }
+
+  // draws vs draw calls of the last submit
+  const RenderStats& getLastStats() const { return _mLastStats; }
+
+  // positive for coarser levels of detail everywhere, negative for finer ones
+  static void setLodBias(float bias) { _sLodBias = bias; }
+  static float getLodBias() { return _sLodBias; }
+
+  static void setClusterCulling(bool cull) { _sClusterCulling = cull; }
+  static bool getClusterCulling() { return _sClusterCulling; }
+
+  static const RenderStats& getFrameStats() { return _sFrameStats; }
+  static void resetFrameStats() { _sFrameStats = RenderStats(); }
+};
\ No newline at end of file
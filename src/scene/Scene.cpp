@@ -2,6 +2,8 @@
 #include <map>
 #include <string>
 
+CullStats Scene::_sFrameCullStats;
+
 void Scene::setActiveCamera(CameraBase* camera, bool addToScene)
 {
   _mActiveCamera = camera;
@@ -53,47 +55,144 @@ void Scene::draw()
 
   glm::mat4 V = _mActiveCamera->getViewMatrix();
   glm::mat4 P = _mActiveCamera->getProjectionMatrix();
+  glm::mat4 PV = P * V;
+
+  _cull(PV);
+
+  // pixels per unit at a view depth of 1, from the viewport height and the camera's fov. Orthographic projections
+  // have no depth falloff, so they always draw the full meshes
+  float lodScale = 0.f;
+  if (P[3][3] == 0.f)
+    lodScale = _mViewportHeight * .5f * P[1][1];
+
+  _mRenderQueue.setWorkerPool(_mHierarchy->getWorkerPool());
+  _mRenderQueue.begin(PV, lodScale);
+
+  // meshlet cone tests need the eye, which an orthographic camera doesn't have either
+  if (P[3][3] == 0.f)
+    _mRenderQueue.setViewPosition(glm::vec3(glm::inverse(V)[3]));
+
+  // collect everything first, then draw in state / depth order instead of tree order
+  Node::collect(_mRenderQueue);
+  _mRenderQueue.submit();
+}
+
+void Scene::_cull(const glm::mat4& PV)
+{
+  Node::beginCullFrame();
+
+  // the bounds are only valid for the tree they were synced with. If it changed since the last update,
+  // some of those nodes may be gone, so just draw everything this time
+  if (!_mHasSyncedBounds || _mHierarchy->getStructureVersion() != _mBoundsStructureVersion)
+  {
+    _mLastCullStats = CullStats();
+    return;
+  }
+
+  int count = (int)_mCullNodes.size();
+  _mCullVisible.resize(count);
+  int numVisible = Frustum::fromMatrix(PV).cull(_mCullBounds, _mCullVisible.data());
+
+  for (int i = 0; i < count; i++)
+  {
+    if (!_mCullVisible[i])
+      _mCullNodes[i]->markCulled();
+  }
 
-  Node::draw(P * V);
+  _mLastCullStats.visible = numVisible;
+  _mLastCullStats.culled = count - numVisible;
+  _sFrameCullStats.visible += _mLastCullStats.visible;
+  _sFrameCullStats.culled += _mLastCullStats.culled;
 }
 
-void Scene::prepShaderPrograms(ShaderProgramManager& manager)
+void Scene::setUploadRing(UploadRing* ring)
 {
-  auto allPrograms = manager.getAllResources();
+  _mRenderQueue.setUploadRing(ring);
+  _mFrameUniforms.setUploadRing(ring);
+}
 
-  std::map<std::string, int> lightCounts;
+void Scene::updateFrameUniforms()
+{
+  _mFrameUniforms.update(_mActiveCamera, _mLights);
+}
 
-  for (auto lightIt = _mLights.begin(); lightIt != _mLights.end(); lightIt++) 
+void Scene::update(float deltaT)
+{
+  Node::update(deltaT);
+  _syncBounds();
+}
+
+void Scene::_syncBounds()
+{
+  // the set of nodes only changes with the tree's structure
+  unsigned int structureVersion = _mHierarchy->getStructureVersion();
+  if (!_mHasSyncedBounds || structureVersion != _mBoundsStructureVersion)
   {
-    LightBase* light = *lightIt;
-    std::string lightType = light->getUniformName();
+    std::unordered_map<Node*, BoundedNode> previous;
+    previous.swap(_mBoundedNodes);
+    _mCullNodes.clear();
+    std::vector<AABB> cullBounds;
 
-    int lightIdx;
-    if (lightCounts.find(lightType) == lightCounts.end()) 
+    AABB bounds;
+    for (int i = 0; i < _mHierarchy->size(); i++)
     {
-      lightIdx = 0;
-      lightCounts[lightType] = 1;
+      // a scene placed inside another tree only covers its own subtree
+      if (_mTransformIdx != 0 && !_mHierarchy->isInSubtree(i, _mTransformIdx)) continue;
+
+      // every entry in a node tree belongs to a Node
+      Node* node = static_cast<Node*>(_mHierarchy->getOwner(i));
+      if (!node->getWorldBounds(bounds)) continue;
+
+      BoundedNode entry;
+      auto it = previous.find(node);
+      if (it != previous.end())
+      {
+        entry = it->second;
+        previous.erase(it);
+      }
+      else
+      {
+        entry.proxy = _mBVH.insert(node, bounds);
+        entry.worldVersion = node->getWorldVersion();
+      }
+      entry.slot = (int)_mCullNodes.size();
+      _mBoundedNodes[node] = entry;
+      _mCullNodes.push_back(node);
+      cullBounds.push_back(bounds);
     }
-    else
-      lightIdx = lightCounts[lightType]++;
 
-    for (auto programIt = allPrograms.begin(); programIt != allPrograms.end(); programIt++) 
+    _mCullBounds.resize((int)cullBounds.size());
+    for (int i = 0; i < (int)cullBounds.size(); i++)
+      _mCullBounds.set(i, cullBounds[i]);
+
+    // whatever is left was removed from the scene (or deleted, so don't touch the node)
+    for (auto& pair : previous)
     {
-      ShaderProgram* program = (*programIt).second;
-      light->setProgramUniform(*program, lightIdx);
+      _mBVH.remove(pair.second.proxy);
     }
+
+    _mBoundsStructureVersion = structureVersion;
+    _mHasSyncedBounds = true;
   }
 
-  if (_mActiveCamera) {
-    for (auto programIt = allPrograms.begin(); programIt != allPrograms.end(); programIt++)
+  // refit whatever moved since the last sync
+  AABB bounds;
+  for (auto& pair : _mBoundedNodes)
+  {
+    Node* node = pair.first;
+    BoundedNode& entry = pair.second;
+    unsigned int version = node->getWorldVersion();
+    if (version == entry.worldVersion) continue;
+
+    entry.worldVersion = version;
+    if (node->getWorldBounds(bounds))
     {
-      ShaderProgram* program = (*programIt).second;
-      _mActiveCamera->setProgramUniform(*program);
+      _mBVH.move(entry.proxy, bounds);
+      _mCullBounds.set(entry.slot, bounds);
     }
   }
 }
 
-
 Scene* Scene::clone() const
 {
   Scene* clone = new Scene();
@@ -111,12 +210,16 @@ void Scene::copyTo(Cloneable* cloned) const
     return;
   }
 
+  // one pass over both trees, then the camera and every light is a single lookup
+  NodeRemap remap;
+  mapClonedNodes(clonedScene, remap);
+
   if (_mActiveCamera) 
   {
-    auto findCamera = breadthFirstSearch(_mActiveCamera);
-    if (findCamera.size() > 0) 
+    auto it = remap.find(_mActiveCamera);
+    if (it != remap.end()) 
     {
-      CameraBase* clonedCamera = dynamic_cast<CameraBase*>(clonedScene->getDescendentByIndices(findCamera));
+      CameraBase* clonedCamera = dynamic_cast<CameraBase*>(it->second);
       clonedScene->_mActiveCamera = clonedCamera;
       
       if (!clonedCamera)
@@ -137,10 +240,10 @@ void Scene::copyTo(Cloneable* cloned) const
       continue;
     }
 
-    auto findLight = breadthFirstSearch(lightNode);
-    if (findLight.size() > 0)
+    auto it = remap.find(lightNode);
+    if (it != remap.end())
     {
-      Light* clonedLight = dynamic_cast<Light*>(clonedScene->getDescendentByIndices(findLight));
+      Light* clonedLight = dynamic_cast<Light*>(it->second);
       if (clonedLight)
         clonedScene->_mLights.insert(clonedLight);
       else
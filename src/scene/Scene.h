@@ -4,20 +4,69 @@
 #include "Camera.h"
 #include "Model.h"
 #include "Light.h"
+#include "BoundingVolumeHierarchy.h"
+#include "RenderQueue.h"
+#include "FrameUniforms.h"
 #include "../components/ShaderProgram.h"
 
 #include <glm/glm.hpp>
 #include <vector>
 #include <set>
+#include <unordered_map>
+
+// how many bounded nodes frustum culling let through
+struct CullStats
+{
+  unsigned int visible = 0;
+  unsigned int culled = 0;
+};
 
 class Scene : public virtual Node
 {
 protected:
+  // totals over all scenes drawn since the last resetFrameCullStats()
+  static CullStats _sFrameCullStats;
+
   // activeCamera needs to be added to the scene separately to be part of the scene
   // i.e. scene->addCamera(cam); scene->addChild(cam);
   CameraBase* _mActiveCamera = nullptr;
   std::set<Light* > _mLights;
 
+  // every node with geometry in the scene, by world bounds
+  struct BoundedNode
+  {
+    int proxy;
+    unsigned int worldVersion;
+
+    // index into _mCullNodes / _mCullBounds
+    int slot;
+  };
+  BoundingVolumeHierarchy _mBVH;
+  std::unordered_map<Node*, BoundedNode> _mBoundedNodes;
+  unsigned int _mBoundsStructureVersion = 0;
+  bool _mHasSyncedBounds = false;
+
+  // exact world bounds of every bounded node, laid out for testing several at a time against the frustum
+  std::vector<Node*> _mCullNodes;
+  AABBBatch _mCullBounds;
+  std::vector<unsigned char> _mCullVisible;
+  CullStats _mLastCullStats;
+
+  // visible draws, collected and sorted every frame
+  RenderQueue _mRenderQueue;
+
+  // camera and light blocks shared by every program
+  FrameUniforms _mFrameUniforms;
+
+  // in pixels, for picking levels of detail. 0 draws everything at full detail
+  int _mViewportHeight = 0;
+
+  // pick up added / removed nodes (only when the tree changed) and refit the ones that moved
+  void _syncBounds();
+
+  // mark every bounded node outside the camera's frustum as culled for this draw
+  void _cull(const glm::mat4& PV);
+
   virtual void copyTo(Cloneable* cloned) const override;
 public:
 
@@ -30,12 +79,31 @@ public:
   void removeLight(Light* light, bool removeFromScene = true);
   const std::set<Light*>& getLights() { return _mLights; }
 
-  // this should be called before a draw call to activate lights!
-  void prepShaderPrograms(ShaderProgramManager& manager);
+  // where the render queue and the camera / light blocks stream their per-frame data. Nothing is drawn without one
+  void setUploadRing(UploadRing* ring);
+
+  // height of the viewport the scene is drawn into, kept up to date by whoever handles resizes
+  void setViewportHeight(int height) { _mViewportHeight = height; }
+
+  // upload the camera and lights for this frame. This should be called before a draw call to activate lights!
+  void updateFrameUniforms();
 
   // NOTE: for scenes, PV will have no effect at all
   virtual void draw(const glm::mat4& PV) override { draw(); }
   virtual void draw();
 
   virtual Scene* clone() const override;
+
+  // updates the whole tree, then brings the BVH up to date
+  virtual void update(float deltaT) override;
+
+  // bounds of everything in the scene with geometry, as of the last update. Shared by culling, picking, lights etc.
+  const BoundingVolumeHierarchy& getBVH() const { return _mBVH; }
+
+  // visible vs culled nodes in the last draw of this scene
+  const CullStats& getLastCullStats() const { return _mLastCullStats; }
+
+  // visible vs culled nodes over every scene drawn this frame
+  static const CullStats& getFrameCullStats() { return _sFrameCullStats; }
+  static void resetFrameCullStats() { _sFrameCullStats = CullStats(); }
 };
\ No newline at end of file
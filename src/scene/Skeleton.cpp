@@ -193,7 +193,7 @@ void Skeleton::setBoneTree(Bone* r)
 {
   root = r;
   bones.clear();
-  boneMapping.clear();
+  boneParents.clear();
   parseBone(r);
 
   for (int i = 0; i < bones.size(); i++)
@@ -202,20 +202,37 @@ void Skeleton::setBoneTree(Bone* r)
   }
   root->update(0);
 
-  bindPoseTransforms.clear();
+  inverseBindPoses.clear();
+  std::vector<AffineTransform> transforms;
   for (unsigned int i = 0; i < bones.size(); i++)
   {
-    glm::mat4 boneMatrix = inverseGlobalTransform
-      * bones[i]->getGlobalTransform()
-      * bones[i]->inverseBindPoseTransform;
-    bindPoseTransforms.push_back(boneMatrix);
+    inverseBindPoses.push_back(AffineTransform(bones[i]->inverseBindPoseTransform));
+    transforms.push_back(bones[i]->getGlobalAffineTransform());
+  }
+
+  bindPoseTransforms.resize(bones.size());
+  composeBoneMatrices(transforms, bindPoseTransforms.data());
+}
+
+void Skeleton::composeBoneMatrices(std::vector<AffineTransform>& transforms, glm::mat4* out) const
+{
+  int count = int(bones.size());
+  AffineTransform::composeBatch(transforms.data(), inverseBindPoses.data(), transforms.data(), count);
+  AffineTransform::composeBatch(AffineTransform(inverseGlobalTransform), transforms.data(), transforms.data(), count);
+
+  for (int i = 0; i < count; i++)
+  {
+    out[i] = transforms[i].toMat4();
   }
 }
 
 void Skeleton::parseBone(Bone* bone)
 {
+  Bone* parent = bones.empty() ? nullptr : static_cast<Bone*>(bone->getParent());
+  boneParents.push_back(parent ? int(parent->boneIndex) : -1);
+
+  bone->boneIndex = bones.size();
   bones.push_back(bone);
-  boneMapping[bone->name] = bones.size() - 1;
   for (auto& child : bone->getChildren())
   {
     Bone* b = dynamic_cast<Bone*>(child);
@@ -234,22 +251,28 @@ void Skeleton::addAnimation(Animation* anim)
   animationMapping[anim->name] = animations.size() - 1;
 }
 
-const std::vector<glm::mat4>& Skeleton::getBindPoseMatrices()
+const std::vector<glm::mat4>& Skeleton::getBindPoseMatrices() const
 {
   return bindPoseTransforms;
 }
 
-std::vector<glm::mat4> Skeleton::calcBoneMatrices(const std::string& animName, double time)
+std::vector<glm::mat4> Skeleton::calcBoneMatrices(const std::string& animName, double time) const
 {
   int idx = getAnimationIdx(animName);
   if (idx < 0) return std::vector<glm::mat4>();
   return calcBoneMatrices(idx, time);
 }
 
-std::vector<glm::mat4> Skeleton::calcBoneMatrices(unsigned int idx, double timeInTicks)
+std::vector<glm::mat4> Skeleton::calcBoneMatrices(unsigned int idx, double timeInTicks) const
 {
-  std::vector<glm::mat4> ret;
+  std::vector<AffineTransform> scratch;
+  std::vector<glm::mat4> ret(bones.size());
+  calcBoneMatrices(idx, timeInTicks, scratch, ret.data());
+  return ret;
+}
 
+void Skeleton::calcBoneMatrices(unsigned int idx, double timeInTicks, std::vector<AffineTransform>& scratch, glm::mat4* out) const
+{
   Animation* anim = getAnimation(idx);
   if (!anim)
   {
@@ -257,45 +280,38 @@ std::vector<glm::mat4> Skeleton::calcBoneMatrices(unsigned int idx, double timeI
     throw std::runtime_error("Animation Idx out of bound");
   }
 
+  // bones come parent first, so each global transform only needs its parent's, already in scratch
   double boundedTime = timeInTicks - floor(timeInTicks / anim->totalTicks) * anim->totalTicks;
+  scratch.resize(bones.size());
   for (unsigned int i = 0; i < bones.size(); i++) 
   {
-    const std::string& name = bones[i]->name;
+    AffineTransform local;
+    const std::string& name = bones[i]->getName();
     auto& it = anim->animationData.find(name);
     if (it == anim->animationData.end())
     {
-      bones[i]->setPosition(glm::vec3(0));
-      bones[i]->setRotationQuaternion(glm::quat(0, 0, 0, 1));
-      bones[i]->setScale(glm::vec3(1));
-      continue;
+      local = AffineTransform::fromTRS(glm::vec3(0), glm::quat(0, 0, 0, 1), glm::vec3(1));
+    }
+    else
+    {
+      auto& animData = it->second;
+      local = AffineTransform::fromTRS(animData->getTranslation(boundedTime),
+        animData->getRotation(boundedTime), animData->getScale(boundedTime));
     }
 
-    auto& animData = it->second;
-    glm::vec3 pos = animData->getTranslation(boundedTime);
-    bones[i]->setPosition(pos);
-    glm::quat rot = animData->getRotation(boundedTime);
-    bones[i]->setRotationQuaternion(rot);
-    glm::vec3 sca = animData->getScale(boundedTime);
-    bones[i]->setScale(sca);
-  }
-
-  root->update(0);
-  for (unsigned int i = 0; i < bones.size(); i++)
-  {
-    glm::mat4 boneMatrix = inverseGlobalTransform
-      * bones[i]->getGlobalTransform()
-      * bones[i]->inverseBindPoseTransform;
-    ret.push_back(boneMatrix);
+    int parent = boneParents[i];
+    scratch[i] = parent < 0 ? local : scratch[parent] * local;
   }
 
-  return ret;
+  composeBoneMatrices(scratch, out);
 }
 
 Bone* Skeleton::getBone(const std::string& name) const
 {
-  int idx = getBoneIdx(name);
-  if (idx < 0) return nullptr;
-  return bones[idx];
+  if (!root) return nullptr;
+
+  // every node in the bone tree is a bone
+  return static_cast<Bone*>(root->findByName(name));
 }
 
 Bone* Skeleton::getBone(unsigned int idx) const
@@ -306,12 +322,9 @@ Bone* Skeleton::getBone(unsigned int idx) const
 
 int Skeleton::getBoneIdx(const std::string& name) const
 {
-  auto& it = boneMapping.find(name);
-  if (it == boneMapping.end())
-  {
-    return -1;
-  }
-  return int(it->second);
+  Bone* bone = getBone(name);
+  if (!bone) return -1;
+  return int(bone->boneIndex);
 }
 
 Animation* Skeleton::getAnimation(const std::string& name) const
@@ -321,7 +334,7 @@ Animation* Skeleton::getAnimation(const std::string& name) const
   return animations[idx];
 }
 
-Animation* Skeleton::getAnimation(unsigned int idx)
+Animation* Skeleton::getAnimation(unsigned int idx) const
 {
   if (idx < animations.size()) return animations[idx];
   return nullptr;
@@ -82,15 +82,21 @@ class Skeleton {
 protected:
   // each node acts as a bone...
   std::vector<Bone*> bones;
-  std::map<std::string, unsigned int> boneMapping;
   std::vector<glm::mat4> bindPoseTransforms;
   Bone* root = nullptr;
 
+  // per bone inverse bind pose, and the index of its parent bone (-1 for the root). Parents always come first
+  std::vector<AffineTransform> inverseBindPoses;
+  std::vector<int> boneParents;
+
   std::vector<Animation*> animations;
   std::map<std::string, unsigned int> animationMapping;
 
   void parseBone(Bone* bone);
 
+  // turn the global transform of every bone into inverseGlobalTransform * global * inverseBindPose, in place, and write them to out
+  void composeBoneMatrices(std::vector<AffineTransform>& transforms, glm::mat4* out) const;
+
 public:
   Skeleton();
   virtual ~Skeleton();
@@ -102,17 +108,22 @@ public:
   void addAnimation(Animation* anim);
 
   glm::mat4 inverseGlobalTransform;
-  std::vector<glm::mat4> calcBoneMatrices(const std::string& animName, double timeInTicks);
-  std::vector<glm::mat4> calcBoneMatrices(unsigned int idx, double timeInTicks);
-  const std::vector<glm::mat4>& getBindPoseMatrices();
+  std::vector<glm::mat4> calcBoneMatrices(const std::string& animName, double timeInTicks) const;
+  std::vector<glm::mat4> calcBoneMatrices(unsigned int idx, double timeInTicks) const;
+
+  // same, writing one matrix per bone to out. The bone tree isn't touched, the pose is built in the caller's scratch,
+  // so any number of instances can share one skeleton
+  void calcBoneMatrices(unsigned int idx, double timeInTicks, std::vector<AffineTransform>& scratch, glm::mat4* out) const;
+  const std::vector<glm::mat4>& getBindPoseMatrices() const;
 
+  // looked up through the name index of the bone tree
   Bone* getBone(const std::string& name) const;
   Bone* getBone(unsigned int idx) const;
   int getBoneIdx(const std::string& name) const;
   int getBoneCount() const { return bones.size(); }
 
   Animation* getAnimation(const std::string& name) const;
-  Animation* getAnimation(unsigned int idx);
+  Animation* getAnimation(unsigned int idx) const;
   int getAnimationIdx(const std::string& name) const;
   int getAnimationCount() const { return animations.size(); }
 };
\ No newline at end of file
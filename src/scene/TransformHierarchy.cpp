@@ -0,0 +1,597 @@
+#include "TransformHierarchy.h"
+#include "GameObject.h"
+#include "../utils/NameTable.h"
+#include <algorithm>
+
+TransformUpdateStats TransformHierarchy::_sFrameStats;
+
+// emptied hierarchies kept around for reuse, so building a tree node by node doesn't reallocate every array
+struct RecycledHierarchies
+{
+  std::vector<TransformHierarchy*> list;
+  ~RecycledHierarchies()
+  {
+    for (TransformHierarchy* h : list)
+      delete h;
+  }
+};
+static RecycledHierarchies _sRecycled;
+
+TransformHierarchy::TransformHierarchy()
+{}
+
+TransformHierarchy::~TransformHierarchy()
+{}
+
+TransformHierarchy* TransformHierarchy::create()
+{
+  if (_sRecycled.list.empty())
+    return new TransformHierarchy();
+
+  TransformHierarchy* ret = _sRecycled.list.back();
+  _sRecycled.list.pop_back();
+  return ret;
+}
+
+void TransformHierarchy::recycle(TransformHierarchy* hierarchy)
+{
+  if (!hierarchy) return;
+
+  if (int(_sRecycled.list.size()) >= MAX_RECYCLED)
+  {
+    delete hierarchy;
+    return;
+  }
+
+  hierarchy->_reset();
+  _sRecycled.list.push_back(hierarchy);
+}
+
+void TransformHierarchy::_reset()
+{
+  _resize(0);
+  _mNameIndex.clear();
+  _mSweepStart = 0;
+  _mTouched.clear();
+  _mSweepAll = true;
+  _mLastSweepStats = TransformUpdateStats();
+  _mLevelsDirty = true;
+  _mWorkerPool = nullptr;
+  _mIsTearingDown = false;
+}
+
+void TransformHierarchy::_listTouched(int idx)
+{
+  if (_mSweepAll) return;
+
+  if (int(_mTouched.size()) < MAX_TOUCHED)
+    _mTouched.push_back(idx);
+  else
+    _mSweepAll = true;
+}
+
+void TransformHierarchy::_touch(int idx)
+{
+  // an entry that's already dirty is listed already
+  if (!isLocalDirty(idx))
+    _listTouched(idx);
+
+  _mLocalVersions[idx]++;
+  if (idx < _mSweepStart) _mSweepStart = idx;
+}
+
+void TransformHierarchy::_rebindOwner(int idx)
+{
+  GameObjectBase* owner = _mOwners[idx];
+  if (!owner) return;
+
+  owner->_mHierarchy = this;
+  owner->_mTransformIdx = idx;
+}
+
+void TransformHierarchy::_appendFrom(const TransformHierarchy& other, int otherIdx, int parentIdx)
+{
+  _mParents.push_back(parentIdx);
+  _mOwners.push_back(other._mOwners[otherIdx]);
+  _mPositions.push_back(other._mPositions[otherIdx]);
+  _mRotations.push_back(other._mRotations[otherIdx]);
+  _mScales.push_back(other._mScales[otherIdx]);
+  _mLocalMatrices.push_back(other._mLocalMatrices[otherIdx]);
+  _mLocalVersions.push_back(other._mLocalVersions[otherIdx]);
+  _mComposedVersions.push_back(other._mComposedVersions[otherIdx]);
+  _mWorldMatrices.push_back(other._mWorldMatrices[otherIdx]);
+  _mWorldVersions.push_back(other._mWorldVersions[otherIdx]);
+  _mParentVersions.push_back(other._mParentVersions[otherIdx]);
+  _mNameIds.push_back(other._mNameIds[otherIdx]);
+  _mScopes.push_back(-1);
+}
+
+bool TransformHierarchy::_prepareEntry(int idx, bool force)
+{
+  bool localChanged = _mLocalVersions[idx] != _mComposedVersions[idx];
+  if (localChanged)
+  {
+    _mLocalMatrices[idx] = AffineTransform::fromTRS(_mPositions[idx], _mRotations[idx], _mScales[idx]);
+    _mComposedVersions[idx] = _mLocalVersions[idx];
+  }
+
+  int parent = _mParents[idx];
+  unsigned int parentVersion = parent < 0 ? 0 : _mWorldVersions[parent];
+  if (!force && !localChanged && parentVersion == _mParentVersions[idx])
+    return false;
+
+  _mParentVersions[idx] = parentVersion;
+  _mWorldVersions[idx]++;
+  return true;
+}
+
+bool TransformHierarchy::_computeEntry(int idx, bool force)
+{
+  if (!_prepareEntry(idx, force)) return false;
+
+  int parent = _mParents[idx];
+  if (parent < 0)
+    _mWorldMatrices[idx] = _mLocalMatrices[idx];
+  else
+    _mWorldMatrices[idx] = _mWorldMatrices[parent] * _mLocalMatrices[idx];
+  return true;
+}
+
+size_t TransformHierarchy::getBytesPerEntry()
+{
+  // parent, owner, local TRS and matrix with its versions, world matrix with its versions, name and scope, depth slot, child slot, offset and subtree size
+  return sizeof(int) + sizeof(GameObjectBase*)
+    + sizeof(glm::vec3) + sizeof(glm::quat) + sizeof(glm::vec3) + sizeof(AffineTransform)
+    + 2 * sizeof(unsigned int) + sizeof(AffineTransform) + 2 * sizeof(unsigned int)
+    + 2 * sizeof(int) + sizeof(int) + 3 * sizeof(int);
+}
+
+void TransformHierarchy::_resize(int count)
+{
+  _mParents.resize(count);
+  _mOwners.resize(count);
+  _mPositions.resize(count);
+  _mRotations.resize(count);
+  _mScales.resize(count);
+  _mLocalMatrices.resize(count);
+  _mLocalVersions.resize(count);
+  _mComposedVersions.resize(count);
+  _mWorldMatrices.resize(count);
+  _mWorldVersions.resize(count);
+  _mParentVersions.resize(count);
+  _mNameIds.resize(count);
+  _mScopes.resize(count);
+}
+
+void TransformHierarchy::_linkName(int idx)
+{
+  int nameId = _mNameIds[idx];
+  if (nameId == NameTable::NONE) return;
+
+  // every scope from the nearest one up to the root. Scopes are rare, so that's a couple at most
+  for (int scope = _mScopes[idx]; ; scope = _mScopes[_mParents[scope]])
+  {
+    std::vector<int>& entries = _mNameIndex[_nameKey(scope, nameId)];
+    if (entries.empty() || entries.back() < idx)
+      entries.push_back(idx);
+    else
+      entries.insert(std::lower_bound(entries.begin(), entries.end(), idx), idx);
+
+    if (_mParents[scope] < 0) break;
+  }
+}
+
+void TransformHierarchy::_unlinkName(int idx)
+{
+  int nameId = _mNameIds[idx];
+  if (nameId == NameTable::NONE) return;
+
+  for (int scope = _mScopes[idx]; ; scope = _mScopes[_mParents[scope]])
+  {
+    auto it = _mNameIndex.find(_nameKey(scope, nameId));
+    if (it != _mNameIndex.end())
+    {
+      std::vector<int>& entries = it->second;
+      auto pos = std::lower_bound(entries.begin(), entries.end(), idx);
+      if (pos != entries.end() && *pos == idx)
+        entries.erase(pos);
+      if (entries.empty())
+        _mNameIndex.erase(it);
+    }
+
+    if (_mParents[scope] < 0) break;
+  }
+}
+
+void TransformHierarchy::_rebuildNameIndex()
+{
+  _mNameIndex.clear();
+
+  // in index order, so every list is only ever appended to
+  for (int i = 0; i < size(); i++)
+    _linkName(i);
+}
+
+void TransformHierarchy::_makeScope(int idx)
+{
+  int outer = _mScopes[idx];
+  if (outer == idx) return;
+
+  // descendents always come after their ancestors, so one pass from idx finds the whole subtree.
+  // Whatever shared idx's scope moves into it, nested scopes keep theirs (they now chain up through idx)
+  std::vector<unsigned char> inSubtree(size() - idx, 0);
+  inSubtree[0] = 1;
+  _mScopes[idx] = idx;
+  for (int i = idx; i < size(); i++)
+  {
+    int parent = _mParents[i];
+    if (i > idx && (parent < idx || !inSubtree[parent - idx])) continue;
+    inSubtree[i - idx] = 1;
+    if (_mScopes[i] == outer) _mScopes[i] = idx;
+
+    if (_mNameIds[i] != NameTable::NONE)
+      _mNameIndex[_nameKey(idx, _mNameIds[i])].push_back(i);
+  }
+}
+
+void TransformHierarchy::setNameId(int idx, int nameId)
+{
+  if (_mNameIds[idx] == nameId) return;
+
+  _unlinkName(idx);
+  _mNameIds[idx] = nameId;
+  _linkName(idx);
+}
+
+bool TransformHierarchy::isInSubtree(int idx, int ancestorIdx) const
+{
+  // descendents always come after their ancestors
+  while (idx > ancestorIdx)
+    idx = _mParents[idx];
+  return idx == ancestorIdx;
+}
+
+int TransformHierarchy::findByName(int nameId, int idx)
+{
+  if (nameId == NameTable::NONE) return -1;
+
+  _makeScope(idx);
+  auto it = _mNameIndex.find(_nameKey(idx, nameId));
+  if (it == _mNameIndex.end()) return -1;
+  return it->second.front();
+}
+
+int TransformHierarchy::add(GameObjectBase* owner, int parentIdx)
+{
+  int idx = size();
+  _mParents.push_back(parentIdx);
+  _mOwners.push_back(owner);
+  _mPositions.push_back(glm::vec3(0));
+  _mRotations.push_back(glm::quat(1, 0, 0, 0));
+  _mScales.push_back(glm::vec3(1.f));
+  _mLocalMatrices.push_back(AffineTransform());
+  _mLocalVersions.push_back(0);
+  _mComposedVersions.push_back(0);
+  _mWorldMatrices.push_back(parentIdx < 0 ? AffineTransform() : _mWorldMatrices[parentIdx]);
+  _mWorldVersions.push_back(0);
+  _mParentVersions.push_back(parentIdx < 0 ? 0 : _mWorldVersions[parentIdx]);
+  _mNameIds.push_back(NameTable::NONE);
+  _mScopes.push_back(parentIdx < 0 ? idx : _mScopes[parentIdx]);
+  _mLevelsDirty = true;
+  _mStructureVersion++;
+  return idx;
+}
+
+void TransformHierarchy::attach(TransformHierarchy& subtree, int parentIdx)
+{
+  // appending keeps the order valid: the parent is already in here, and the subtree is ordered itself
+  int offset = size();
+  for (int i = 0; i < subtree.size(); i++)
+  {
+    int parent = i == 0 ? parentIdx : subtree._mParents[i] + offset;
+    _appendFrom(subtree, i, parent);
+
+    // the subtree's root stops being a scope, the ones searched from inside it stay
+    int scope = subtree._mScopes[i];
+    _mScopes.back() = scope == 0 ? _mScopes[parentIdx] : scope + offset;
+  }
+
+  // the moved entries now hang off a new parent, so bring them up to date right away
+  for (int i = offset; i < size(); i++)
+  {
+    _rebindOwner(i);
+    _computeEntry(i, true);
+    _linkName(i);
+  }
+
+  subtree._resize(0);
+  subtree._mNameIndex.clear();
+  subtree._mSweepStart = 0;
+  subtree._mTouched.clear();
+  subtree._mSweepAll = true;
+  subtree._mLevelsDirty = true;
+  subtree._mStructureVersion++;
+  _mLevelsDirty = true;
+  _mStructureVersion++;
+}
+
+TransformHierarchy* TransformHierarchy::detach(int idx)
+{
+  TransformHierarchy* detached = create();
+  int count = size();
+
+  // nothing before idx can be a descendent, since parents always come first
+  std::vector<int> remap(count, -1);
+  std::vector<unsigned char> inSubtree(count, 0);
+  for (int i = idx; i < count; i++)
+  {
+    int parent = _mParents[i];
+    inSubtree[i] = i == idx || (parent >= idx && inSubtree[parent]);
+    if (!inSubtree[i]) continue;
+
+    remap[i] = detached->size();
+    detached->_appendFrom(*this, i, i == idx ? -1 : remap[parent]);
+
+    // scopes above idx stay behind, the detached root is one itself
+    int scope = _mScopes[i];
+    detached->_mScopes.back() = scope >= idx && inSubtree[scope] ? remap[scope] : 0;
+  }
+
+  // compact the remaining entries in place, preserving their order
+  int write = idx;
+  for (int read = idx; read < count; read++)
+  {
+    if (inSubtree[read]) continue;
+
+    int parent = _mParents[read];
+    remap[read] = write;
+    _mParents[write] = parent < idx ? parent : remap[parent];
+    _mOwners[write] = _mOwners[read];
+    _mPositions[write] = _mPositions[read];
+    _mRotations[write] = _mRotations[read];
+    _mScales[write] = _mScales[read];
+    _mLocalMatrices[write] = _mLocalMatrices[read];
+    _mLocalVersions[write] = _mLocalVersions[read];
+    _mComposedVersions[write] = _mComposedVersions[read];
+    _mWorldMatrices[write] = _mWorldMatrices[read];
+    _mWorldVersions[write] = _mWorldVersions[read];
+    _mParentVersions[write] = _mParentVersions[read];
+    _mNameIds[write] = _mNameIds[read];
+    _mScopes[write] = _mScopes[read] < idx ? _mScopes[read] : remap[_mScopes[read]];
+    write++;
+  }
+
+  _resize(write);
+  _rebuildNameIndex();
+
+  for (int i = idx; i < size(); i++)
+    _rebindOwner(i);
+
+  // entries past idx have shifted, so the next sweep has to look at them again (and the touched list is stale)
+  if (idx < _mSweepStart) _mSweepStart = idx;
+  _mSweepAll = true;
+  _mLevelsDirty = true;
+  _mStructureVersion++;
+
+  // the detached subtree no longer has a parent transform
+  for (int i = 0; i < detached->size(); i++)
+  {
+    detached->_rebindOwner(i);
+    detached->_computeEntry(i, true);
+  }
+  detached->_mSweepStart = detached->size();
+  detached->_mTouched.clear();
+  detached->_mSweepAll = false;
+  detached->_rebuildNameIndex();
+
+  return detached;
+}
+
+void TransformHierarchy::_buildLevels()
+{
+  int count = size();
+  std::vector<int> depths(count);
+  _mLevelOffsets.assign(1, 0);
+
+  // count the entries at each depth - parents come first, so their depth is known already
+  for (int i = 0; i < count; i++)
+  {
+    int parent = _mParents[i];
+    int depth = parent < 0 ? 0 : depths[parent] + 1;
+    depths[i] = depth;
+
+    if (depth + 2 > int(_mLevelOffsets.size()))
+      _mLevelOffsets.resize(depth + 2, 0);
+    _mLevelOffsets[depth + 1]++;
+  }
+
+  for (int l = 1; l < int(_mLevelOffsets.size()); l++)
+    _mLevelOffsets[l] += _mLevelOffsets[l - 1];
+
+  // stable, so each level stays in index order
+  std::vector<int> cursor(_mLevelOffsets.begin(), _mLevelOffsets.end() - 1);
+  _mLevelEntries.resize(count);
+  for (int i = 0; i < count; i++)
+    _mLevelEntries[cursor[depths[i]]++] = i;
+
+  // same counting sort, by parent
+  _mChildOffsets.assign(count + 1, 0);
+  for (int i = 0; i < count; i++)
+  {
+    if (_mParents[i] >= 0) _mChildOffsets[_mParents[i] + 1]++;
+  }
+  for (int i = 0; i < count; i++)
+    _mChildOffsets[i + 1] += _mChildOffsets[i];
+
+  cursor.assign(_mChildOffsets.begin(), _mChildOffsets.end() - 1);
+  _mChildEntries.resize(_mChildOffsets[count]);
+  for (int i = 0; i < count; i++)
+  {
+    if (_mParents[i] >= 0) _mChildEntries[cursor[_mParents[i]]++] = i;
+  }
+
+  // children come after their parents, so going backwards every subtree is complete before it's added up
+  _mSubtreeSizes.assign(count, 1);
+  for (int i = count - 1; i > 0; i--)
+  {
+    if (_mParents[i] >= 0) _mSubtreeSizes[_mParents[i]] += _mSubtreeSizes[i];
+  }
+
+  _mLevelsDirty = false;
+}
+
+unsigned int TransformHierarchy::_sweepEntries(const int* entries, int count)
+{
+  // parents are all done (they're a level up), so their worlds can be copied out next to the locals
+  // and composed a batch at a time, in place
+  AffineTransform parents[SWEEP_BATCH];
+  AffineTransform worlds[SWEEP_BATCH];
+  int targets[SWEEP_BATCH];
+  int batched = 0;
+  unsigned int recomputed = 0;
+
+  auto flush = [&]()
+  {
+    AffineTransform::composeBatch(parents, worlds, worlds, batched);
+    for (int k = 0; k < batched; k++)
+      _mWorldMatrices[targets[k]] = worlds[k];
+    batched = 0;
+  };
+
+  for (int k = 0; k < count; k++)
+  {
+    int idx = entries[k];
+    if (!_prepareEntry(idx)) continue;
+    recomputed++;
+
+    int parent = _mParents[idx];
+    if (parent < 0)
+    {
+      _mWorldMatrices[idx] = _mLocalMatrices[idx];
+      continue;
+    }
+
+    parents[batched] = _mWorldMatrices[parent];
+    worlds[batched] = _mLocalMatrices[idx];
+    targets[batched] = idx;
+    if (++batched == SWEEP_BATCH)
+      flush();
+  }
+
+  if (batched > 0)
+    flush();
+  return recomputed;
+}
+
+unsigned int TransformHierarchy::_sweepSerial()
+{
+  if (_mLevelsDirty)
+    _buildLevels();
+
+  // parents come first, so nothing before the first changed entry can need an update. Levels are in index order,
+  // so that's a suffix of each level
+  unsigned int recomputed = 0;
+  for (int l = 0; l + 1 < int(_mLevelOffsets.size()); l++)
+  {
+    const int* levelBegin = _mLevelEntries.data() + _mLevelOffsets[l];
+    const int* levelEnd = _mLevelEntries.data() + _mLevelOffsets[l + 1];
+    const int* levelStart = std::lower_bound(levelBegin, levelEnd, _mSweepStart);
+    recomputed += _sweepEntries(levelStart, int(levelEnd - levelStart));
+  }
+  return recomputed;
+}
+
+unsigned int TransformHierarchy::_sweepParallel()
+{
+  if (_mLevelsDirty)
+    _buildLevels();
+
+  std::atomic<unsigned int> recomputed(0);
+
+  for (int l = 0; l + 1 < int(_mLevelOffsets.size()); l++)
+  {
+    const int* levelBegin = _mLevelEntries.data() + _mLevelOffsets[l];
+    const int* levelEnd = _mLevelEntries.data() + _mLevelOffsets[l + 1];
+    const int* levelStart = std::lower_bound(levelBegin, levelEnd, _mSweepStart);
+    int levelSize = int(levelEnd - levelStart);
+
+    _mWorkerPool->parallelFor(levelSize, PARALLEL_SWEEP_GRAIN, [&](int begin, int end)
+    {
+      recomputed += _sweepEntries(levelStart + begin, end - begin);
+    });
+  }
+
+  return recomputed;
+}
+
+unsigned int TransformHierarchy::_sweepTouched()
+{
+  if (_mLevelsDirty)
+    _buildLevels();
+
+  // ancestors first. Below a recomputed entry everything is recomputed, and below one that wasn't nothing needs to be -
+  // except under the listed entries themselves, which may have been brought up to date early by computeTransform
+  std::sort(_mTouched.begin(), _mTouched.end());
+  unsigned int recomputed = 0;
+  for (int touched : _mTouched)
+  {
+    _mSweepQueue.assign(1, touched);
+    for (size_t q = 0; q < _mSweepQueue.size(); q++)
+    {
+      int idx = _mSweepQueue[q];
+      bool changed = _computeEntry(idx);
+      if (changed) recomputed++;
+      if (!changed && q > 0) continue;
+
+      _mSweepQueue.insert(_mSweepQueue.end(),
+        _mChildEntries.begin() + _mChildOffsets[idx], _mChildEntries.begin() + _mChildOffsets[idx + 1]);
+    }
+  }
+  return recomputed;
+}
+
+bool TransformHierarchy::_isTouchedSweepCheaper()
+{
+  if (_mSweepAll) return false;
+  if (_mLevelsDirty)
+    _buildLevels();
+
+  // the walk is entry by entry, while the level sweep composes in batches (and threads), so it has to win by a margin
+  long long walked = 0;
+  for (int idx : _mTouched)
+    walked += _mSubtreeSizes[idx];
+  return walked * 2 < size() - _mSweepStart;
+}
+
+void TransformHierarchy::updateTransforms()
+{
+  int count = size();
+  unsigned int recomputed = 0;
+  if (_mSweepStart >= count)
+    recomputed = 0;
+  else if (_isTouchedSweepCheaper())
+    recomputed = _sweepTouched();
+  else if (_mWorkerPool && count - _mSweepStart >= PARALLEL_SWEEP_THRESHOLD)
+    recomputed = _sweepParallel();
+  else
+    recomputed = _sweepSerial();
+  _mSweepStart = count;
+  _mTouched.clear();
+  _mSweepAll = false;
+
+  _mLastSweepStats.recomputed = recomputed;
+  _mLastSweepStats.skipped = count - recomputed;
+  _sFrameStats.recomputed += _mLastSweepStats.recomputed;
+  _sFrameStats.skipped += _mLastSweepStats.skipped;
+}
+
+void TransformHierarchy::computeTransform(int idx)
+{
+  int parent = _mParents[idx];
+  if (parent >= 0)
+    computeTransform(parent);
+
+  // its descendents weren't, so the next sweep has to start from here
+  if (_computeEntry(idx))
+    _listTouched(idx);
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "../utils/ThreadPool.h"
+#include "../utils/AffineTransform.h"
+
+class GameObjectBase;
+
+// how much work a transform sweep did
+struct TransformUpdateStats
+{
+  unsigned int recomputed = 0;
+  unsigned int skipped = 0;
+};
+
+// Flat storage for every transform of a node tree.
+// Local TRS and world matrices live in contiguous arrays that share one index,
+// and entries are always ordered parent-before-child, so updating the whole tree
+// is a single linear sweep instead of a recursive walk.
+// A hierarchy is owned by the root of its tree; attaching a subtree moves its entries over.
+//
+// Changes are tracked with version counters rather than dirty flags: an entry's world matrix
+// is only recomputed if its local transform changed or its parent's world matrix did,
+// so static parts of the tree are skipped. The entries touched since the last sweep are also listed,
+// so a frame where a few nodes moved only visits those nodes and their descendants.
+//
+// Sweeps run level by level: entries of the same depth only read their parents from the level before,
+// so the parent * local products of a level are gathered and composed in batches (AffineTransform::composeBatch),
+// and with a worker pool big levels are split across threads.
+// Every entry still goes through the same math, so results match computeTransform bit for bit.
+//
+// The hierarchy also indexes its entries by interned name (see NameTable), so a tree can be
+// searched by name without walking it. The index is kept per scope: the roots, plus every entry that has been
+// searched from. So looking up a name below one asset of a big scene only ever sees that asset's entries.
+class TransformHierarchy
+{
+public:
+  // sweeps touching fewer entries than this stay on the calling thread
+  static const int PARALLEL_SWEEP_THRESHOLD = 4096;
+
+  // entries handed to a worker at a time
+  static const int PARALLEL_SWEEP_GRAIN = 512;
+
+  // parent * local products gathered before each composeBatch
+  static const int SWEEP_BATCH = 64;
+
+  // with more touched entries than this, sweeping every level from the first change is cheaper than
+  // walking each touched subtree on its own
+  static const int MAX_TOUCHED = 256;
+
+protected:
+  // totals over all hierarchies since the last resetFrameStats()
+  static TransformUpdateStats _sFrameStats;
+
+  // index of the parent entry, -1 for the root
+  std::vector<int> _mParents;
+
+  // the object each entry belongs to, so handles can be fixed up when entries move
+  std::vector<GameObjectBase*> _mOwners;
+
+  // local transform
+  std::vector<glm::vec3> _mPositions;
+  std::vector<glm::quat> _mRotations;
+  std::vector<glm::vec3> _mScales;
+  std::vector<AffineTransform> _mLocalMatrices;
+
+  // bumped whenever the local TRS is set / the local TRS version the local matrix was built from
+  std::vector<unsigned int> _mLocalVersions;
+  std::vector<unsigned int> _mComposedVersions;
+
+  // world transform, as of the last sweep
+  std::vector<AffineTransform> _mWorldMatrices;
+
+  // bumped whenever the world matrix is recomputed / the parent's world version it was built from
+  std::vector<unsigned int> _mWorldVersions;
+  std::vector<unsigned int> _mParentVersions;
+
+  // interned name of each entry, and the nearest scope at or above it
+  std::vector<int> _mNameIds;
+  std::vector<int> _mScopes;
+
+  // the named entries below each scope (nested scopes included), in index order. Keyed by _nameKey(scope, nameId)
+  std::unordered_map<uint64_t, std::vector<int>> _mNameIndex;
+
+  static uint64_t _nameKey(int scope, int nameId) { return (uint64_t(uint32_t(scope)) << 32) | uint32_t(nameId); }
+
+  // add / remove an entry in the lists of every scope it's in
+  void _linkName(int idx);
+  void _unlinkName(int idx);
+
+  // rebuild every list, for when entries were moved around
+  void _rebuildNameIndex();
+
+  // make idx a scope, indexing its subtree once
+  void _makeScope(int idx);
+
+  // no entry before this index has changed since the last sweep
+  int _mSweepStart = 0;
+
+  // entries touched since the last sweep, each listed once. When _mSweepAll is set the list is incomplete
+  // (too many touches, or entries moved around) and the sweep goes over every level from _mSweepStart instead
+  std::vector<int> _mTouched;
+  bool _mSweepAll = true;
+
+  // scratch for walking the touched subtrees
+  std::vector<int> _mSweepQueue;
+
+  // work done by the last sweep
+  TransformUpdateStats _mLastSweepStats;
+
+  // entry indices grouped by depth, and where each depth starts (plus the end) - rebuilt when the tree changes
+  std::vector<int> _mLevelEntries;
+  std::vector<int> _mLevelOffsets;
+
+  // children of each entry, in index order: those of idx are _mChildEntries[_mChildOffsets[idx] .. _mChildOffsets[idx + 1]].
+  // Rebuilt along with the levels
+  std::vector<int> _mChildEntries;
+  std::vector<int> _mChildOffsets;
+
+  // number of entries in the subtree of each entry, itself included
+  std::vector<int> _mSubtreeSizes;
+  bool _mLevelsDirty = true;
+
+  // bumped whenever entries are added, moved in or moved out
+  unsigned int _mStructureVersion = 0;
+
+  // optional, for splitting big sweeps across threads
+  ThreadPool* _mWorkerPool = nullptr;
+
+  // group entries by depth, and list the children of each
+  void _buildLevels();
+
+  // sweeps from _mSweepStart, returning the number of recomputed entries
+  unsigned int _sweepSerial();
+  unsigned int _sweepParallel();
+
+  // walk down from each touched entry only, returning the number of recomputed entries
+  unsigned int _sweepTouched();
+
+  // true if walking the touched subtrees visits fewer entries than the level sweep from _mSweepStart would
+  bool _isTouchedSweepCheaper();
+
+  // recompute the world matrices of entries of one level that need it, returning how many did
+  unsigned int _sweepEntries(const int* entries, int count);
+
+  // at most this many emptied hierarchies are kept around for reuse (see recycle)
+  static const int MAX_RECYCLED = 64;
+
+  // back to an empty hierarchy, keeping the capacity of the arrays
+  void _reset();
+
+  // set while the whole tree is being destroyed, so no entry needs to be moved around
+  bool _mIsTearingDown = false;
+
+  // point the owner of an entry back at this hierarchy
+  void _rebindOwner(int idx);
+
+  // shrink or grow every per-entry array
+  void _resize(int count);
+
+  // append an entry, copying it from another hierarchy
+  void _appendFrom(const TransformHierarchy& other, int otherIdx, int parentIdx);
+
+  // recompute the local matrix of a single entry if it changed, and bump its versions if its world matrix has to be
+  // recomputed too. Returns true if so, leaving the world matrix itself to the caller
+  bool _prepareEntry(int idx, bool force = false);
+
+  // _prepareEntry and the world matrix. Returns true if the world matrix was recomputed
+  bool _computeEntry(int idx, bool force = false);
+
+  // mark an entry's local transform as changed
+  void _touch(int idx);
+
+  // add to the entries the next sweep walks down from
+  void _listTouched(int idx);
+
+public:
+  TransformHierarchy();
+  TransformHierarchy(const TransformHierarchy& other) = delete;
+  virtual ~TransformHierarchy();
+
+  // get an empty hierarchy, reusing a recycled one if possible
+  static TransformHierarchy* create();
+
+  // hand an emptied hierarchy (e.g. one that was attached elsewhere) back for reuse, deleting it if there's enough already
+  static void recycle(TransformHierarchy* hierarchy);
+
+  // create a new entry under parentIdx (-1 for a root entry). Returns the entry index
+  int add(GameObjectBase* owner, int parentIdx = -1);
+
+  // move every entry of subtree (rooted at its entry 0) under parentIdx. The subtree hierarchy is left empty
+  void attach(TransformHierarchy& subtree, int parentIdx);
+
+  // move the entries rooted at idx out into a new hierarchy, which the caller is responsible for
+  TransformHierarchy* detach(int idx);
+
+  // first entry named nameId (an id from NameTable) in the subtree rooted at idx, itself included. -1 if there's none.
+  // The first search from an entry indexes its subtree, every one after that is a single hash lookup
+  int findByName(int nameId, int idx);
+
+  // true if idx is ancestorIdx or one of its descendents
+  bool isInSubtree(int idx, int ancestorIdx) const;
+
+  // recompute every changed local matrix and the world matrices depending on them, in one pass
+  void updateTransforms();
+
+  // recompute the world matrix of one entry and all of its ancestors
+  void computeTransform(int idx);
+
+  // entry accessors
+  int getParent(int idx) const { return _mParents[idx]; }
+  GameObjectBase* getOwner(int idx) const { return _mOwners[idx]; }
+  const glm::vec3& getPosition(int idx) const { return _mPositions[idx]; }
+  const glm::quat& getRotation(int idx) const { return _mRotations[idx]; }
+  const glm::vec3& getScale(int idx) const { return _mScales[idx]; }
+  const AffineTransform& getLocalMatrix(int idx) const { return _mLocalMatrices[idx]; }
+  const AffineTransform& getWorldMatrix(int idx) const { return _mWorldMatrices[idx]; }
+  bool isLocalDirty(int idx) const { return _mLocalVersions[idx] != _mComposedVersions[idx]; }
+  unsigned int getWorldVersion(int idx) const { return _mWorldVersions[idx]; }
+  int getNameId(int idx) const { return _mNameIds[idx]; }
+
+  void setPosition(int idx, const glm::vec3& position) { _mPositions[idx] = position; _touch(idx); }
+  void setRotation(int idx, const glm::quat& rotation) { _mRotations[idx] = rotation; _touch(idx); }
+  void setScale(int idx, const glm::vec3& scale) { _mScales[idx] = scale; _touch(idx); }
+  void setNameId(int idx, int nameId);
+
+  // recomputed vs skipped entries in the last sweep of this hierarchy
+  const TransformUpdateStats& getLastSweepStats() const { return _mLastSweepStats; }
+
+  // recomputed vs skipped entries over every hierarchy swept this frame
+  static const TransformUpdateStats& getFrameStats() { return _sFrameStats; }
+  static void resetFrameStats() { _sFrameStats = TransformUpdateStats(); }
+
+  // use a pool of threads for big sweeps, or nullptr to always sweep on the calling thread
+  void setWorkerPool(ThreadPool* pool) { _mWorkerPool = pool; }
+  ThreadPool* getWorkerPool() const { return _mWorkerPool; }
+
+  void beginTeardown() { _mIsTearingDown = true; }
+  bool isTearingDown() const { return _mIsTearingDown; }
+
+  int size() const { return int(_mParents.size()); }
+
+  // memory taken by one entry across every per-entry array, not counting spare capacity
+  static size_t getBytesPerEntry();
+  unsigned int getStructureVersion() const { return _mStructureVersion; }
+};
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "AffineTransform.h"
+#include <cmath>
+
+#if defined(AFFINE_TRANSFORM_AVX) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef AFFINE_TRANSFORM_SSE
+
+#define SPLAT(v, i) _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i))
+
+// keeps only the w lane, i.e. the translation part of a row
+static inline __m128 _maskW(__m128 v)
+{
+  return _mm_and_ps(v, _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)));
+}
+
+// one row of lhs * rhs
+static inline __m128 _composeRow(__m128 a, __m128 b0, __m128 b1, __m128 b2)
+{
+  __m128 r = _mm_mul_ps(SPLAT(a, 0), b0);
+  r = _mm_add_ps(r, _mm_mul_ps(SPLAT(a, 1), b1));
+  r = _mm_add_ps(r, _mm_mul_ps(SPLAT(a, 2), b2));
+  return _mm_add_ps(r, _maskW(a));
+}
+
+static inline void _compose(const AffineTransform& lhs, const AffineTransform& rhs, AffineTransform& out)
+{
+  __m128 b0 = _mm_load_ps(&rhs.rows[0].x);
+  __m128 b1 = _mm_load_ps(&rhs.rows[1].x);
+  __m128 b2 = _mm_load_ps(&rhs.rows[2].x);
+
+  // load everything before storing, in case out aliases an input
+  __m128 a0 = _mm_load_ps(&lhs.rows[0].x);
+  __m128 a1 = _mm_load_ps(&lhs.rows[1].x);
+  __m128 a2 = _mm_load_ps(&lhs.rows[2].x);
+
+  _mm_store_ps(&out.rows[0].x, _composeRow(a0, b0, b1, b2));
+  _mm_store_ps(&out.rows[1].x, _composeRow(a1, b0, b1, b2));
+  _mm_store_ps(&out.rows[2].x, _composeRow(a2, b0, b1, b2));
+}
+
+#else
+
+static inline glm::vec4 _composeRow(const glm::vec4& a, const glm::vec4& b0, const glm::vec4& b1, const glm::vec4& b2)
+{
+  glm::vec4 r = a.x * b0;
+  r = r + a.y * b1;
+  r = r + a.z * b2;
+  r.w = r.w + a.w;
+  return r;
+}
+
+static inline void _compose(const AffineTransform& lhs, const AffineTransform& rhs, AffineTransform& out)
+{
+  glm::vec4 b0 = rhs.rows[0], b1 = rhs.rows[1], b2 = rhs.rows[2];
+  glm::vec4 a0 = lhs.rows[0], a1 = lhs.rows[1], a2 = lhs.rows[2];
+  out.rows[0] = _composeRow(a0, b0, b1, b2);
+  out.rows[1] = _composeRow(a1, b0, b1, b2);
+  out.rows[2] = _composeRow(a2, b0, b1, b2);
+}
+
+#endif
+
+#ifdef AFFINE_TRANSFORM_AVX
+
+// two composes at once: the low 128 bits hold one transform's row, the high 128 bits the other's
+static inline __m256 _load2(const glm::vec4& lo, const glm::vec4& hi)
+{
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(&lo.x)), _mm_load_ps(&hi.x), 1);
+}
+
+static inline __m256 _composeRow2(__m256 a, __m256 b0, __m256 b1, __m256 b2)
+{
+  __m256 r = _mm256_mul_ps(_mm256_permute_ps(a, 0x00), b0);
+  r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(a, 0x55), b1));
+  r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(a, 0xAA), b2));
+  __m256 wMask = _mm256_castsi256_ps(_mm256_set_epi32(-1, 0, 0, 0, -1, 0, 0, 0));
+  return _mm256_add_ps(r, _mm256_and_ps(a, wMask));
+}
+
+static inline void _store2(__m256 v, glm::vec4& lo, glm::vec4& hi)
+{
+  _mm_store_ps(&lo.x, _mm256_castps256_ps128(v));
+  _mm_store_ps(&hi.x, _mm256_extractf128_ps(v, 1));
+}
+
+#endif
+
+AffineTransform::AffineTransform()
+{
+  rows[0] = glm::vec4(1, 0, 0, 0);
+  rows[1] = glm::vec4(0, 1, 0, 0);
+  rows[2] = glm::vec4(0, 0, 1, 0);
+}
+
+AffineTransform::AffineTransform(const glm::mat4& m)
+{
+  for (int r = 0; r < 3; r++)
+  {
+    rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+  }
+}
+
+AffineTransform AffineTransform::fromTRS(const glm::vec3& position, const glm::quat& q, const glm::vec3& scale)
+{
+  // rotation matrix straight from the quaternion, with each column scaled
+  float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  AffineTransform t;
+  t.rows[0] = glm::vec4((1.f - 2.f * (yy + zz)) * scale.x, (2.f * (xy - wz)) * scale.y, (2.f * (xz + wy)) * scale.z, position.x);
+  t.rows[1] = glm::vec4((2.f * (xy + wz)) * scale.x, (1.f - 2.f * (xx + zz)) * scale.y, (2.f * (yz - wx)) * scale.z, position.y);
+  t.rows[2] = glm::vec4((2.f * (xz - wy)) * scale.x, (2.f * (yz + wx)) * scale.y, (1.f - 2.f * (xx + yy)) * scale.z, position.z);
+  return t;
+}
+
+glm::mat4 AffineTransform::toMat4() const
+{
+  return glm::mat4(
+    rows[0].x, rows[1].x, rows[2].x, 0.f,
+    rows[0].y, rows[1].y, rows[2].y, 0.f,
+    rows[0].z, rows[1].z, rows[2].z, 0.f,
+    rows[0].w, rows[1].w, rows[2].w, 1.f
+  );
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& other) const
+{
+  AffineTransform ret;
+  _compose(*this, other, ret);
+  return ret;
+}
+
+glm::mat4 AffineTransform::multiply(const glm::mat4& lhs, const AffineTransform& rhs)
+{
+  glm::mat4 ret;
+
+#ifdef AFFINE_TRANSFORM_SSE
+  __m128 c0 = _mm_loadu_ps(&lhs[0].x);
+  __m128 c1 = _mm_loadu_ps(&lhs[1].x);
+  __m128 c2 = _mm_loadu_ps(&lhs[2].x);
+  __m128 c3 = _mm_loadu_ps(&lhs[3].x);
+
+  // column j of the result is lhs * (column j of rhs), and rhs's last row is (0, 0, 0, 1)
+  for (int j = 0; j < 4; j++)
+  {
+    __m128 col = _mm_mul_ps(c0, _mm_set1_ps(rhs.rows[0][j]));
+    col = _mm_add_ps(col, _mm_mul_ps(c1, _mm_set1_ps(rhs.rows[1][j])));
+    col = _mm_add_ps(col, _mm_mul_ps(c2, _mm_set1_ps(rhs.rows[2][j])));
+    if (j == 3)
+      col = _mm_add_ps(col, c3);
+    _mm_storeu_ps(&ret[j].x, col);
+  }
+#else
+  for (int j = 0; j < 4; j++)
+  {
+    ret[j] = lhs[0] * rhs.rows[0][j] + lhs[1] * rhs.rows[1][j] + lhs[2] * rhs.rows[2][j];
+    if (j == 3)
+      ret[j] += lhs[3];
+  }
+#endif
+
+  return ret;
+}
+
+void AffineTransform::composeBatch(const AffineTransform* lhs, const AffineTransform* rhs, AffineTransform* out, int count)
+{
+  int i = 0;
+
+#ifdef AFFINE_TRANSFORM_AVX
+  for (; i + 1 < count; i += 2)
+  {
+    __m256 b0 = _load2(rhs[i].rows[0], rhs[i + 1].rows[0]);
+    __m256 b1 = _load2(rhs[i].rows[1], rhs[i + 1].rows[1]);
+    __m256 b2 = _load2(rhs[i].rows[2], rhs[i + 1].rows[2]);
+    __m256 a0 = _load2(lhs[i].rows[0], lhs[i + 1].rows[0]);
+    __m256 a1 = _load2(lhs[i].rows[1], lhs[i + 1].rows[1]);
+    __m256 a2 = _load2(lhs[i].rows[2], lhs[i + 1].rows[2]);
+
+    _store2(_composeRow2(a0, b0, b1, b2), out[i].rows[0], out[i + 1].rows[0]);
+    _store2(_composeRow2(a1, b0, b1, b2), out[i].rows[1], out[i + 1].rows[1]);
+    _store2(_composeRow2(a2, b0, b1, b2), out[i].rows[2], out[i + 1].rows[2]);
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    _compose(lhs[i], rhs[i], out[i]);
+  }
+}
+
+void AffineTransform::composeBatch(const AffineTransform& lhs, const AffineTransform* rhs, AffineTransform* out, int count)
+{
+  int i = 0;
+
+#ifdef AFFINE_TRANSFORM_AVX
+  __m256 a0 = _load2(lhs.rows[0], lhs.rows[0]);
+  __m256 a1 = _load2(lhs.rows[1], lhs.rows[1]);
+  __m256 a2 = _load2(lhs.rows[2], lhs.rows[2]);
+  for (; i + 1 < count; i += 2)
+  {
+    __m256 b0 = _load2(rhs[i].rows[0], rhs[i + 1].rows[0]);
+    __m256 b1 = _load2(rhs[i].rows[1], rhs[i + 1].rows[1]);
+    __m256 b2 = _load2(rhs[i].rows[2], rhs[i + 1].rows[2]);
+
+    _store2(_composeRow2(a0, b0, b1, b2), out[i].rows[0], out[i + 1].rows[0]);
+    _store2(_composeRow2(a1, b0, b1, b2), out[i].rows[1], out[i + 1].rows[1]);
+    _store2(_composeRow2(a2, b0, b1, b2), out[i].rows[2], out[i + 1].rows[2]);
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    _compose(lhs, rhs[i], out[i]);
+  }
+}
+
+bool AffineTransform::hasUniformScale(float epsilon) const
+{
+  glm::vec3 c0(rows[0].x, rows[1].x, rows[2].x);
+  glm::vec3 c1(rows[0].y, rows[1].y, rows[2].y);
+  glm::vec3 c2(rows[0].z, rows[1].z, rows[2].z);
+
+  // the columns have to be orthogonal and of equal length
+  float lenSq = glm::dot(c0, c0);
+  float tolerance = epsilon * lenSq;
+  return std::abs(glm::dot(c1, c1) - lenSq) <= tolerance
+    && std::abs(glm::dot(c2, c2) - lenSq) <= tolerance
+    && std::abs(glm::dot(c0, c1)) <= tolerance
+    && std::abs(glm::dot(c0, c2)) <= tolerance
+    && std::abs(glm::dot(c1, c2)) <= tolerance;
+}
+
+bool AffineTransform::isMirrored() const
+{
+  glm::vec3 r0(rows[0]), r1(rows[1]), r2(rows[2]);
+  return glm::dot(r0, glm::cross(r1, r2)) < 0.f;
+}
+
+glm::mat3 AffineTransform::normalMatrix() const
+{
+  glm::vec3 c0(rows[0].x, rows[1].x, rows[2].x);
+  glm::vec3 c1(rows[0].y, rows[1].y, rows[2].y);
+  glm::vec3 c2(rows[0].z, rows[1].z, rows[2].z);
+
+  if (hasUniformScale())
+  {
+    // (s * R)^-T = R / s, which is the same as the matrix over s^2
+    float invLenSq = 1.f / glm::dot(c0, c0);
+
+#ifdef AFFINE_TRANSFORM_SSE
+    alignas(16) glm::vec4 scaled[3];
+    __m128 s = _mm_set1_ps(invLenSq);
+    for (int r = 0; r < 3; r++)
+    {
+      _mm_store_ps(&scaled[r].x, _mm_mul_ps(_mm_load_ps(&rows[r].x), s));
+    }
+    return glm::mat3(
+      scaled[0].x, scaled[1].x, scaled[2].x,
+      scaled[0].y, scaled[1].y, scaled[2].y,
+      scaled[0].z, scaled[1].z, scaled[2].z
+    );
+#else
+    return glm::mat3(c0 * invLenSq, c1 * invLenSq, c2 * invLenSq);
+#endif
+  }
+
+  // the inverse transpose is the cofactor matrix over the determinant
+  glm::vec3 x = glm::cross(c1, c2);
+  glm::vec3 y = glm::cross(c2, c0);
+  glm::vec3 z = glm::cross(c0, c1);
+  float det = glm::dot(c0, x);
+  if (det == 0.f) return glm::mat3(1.f);
+
+  float invDet = 1.f / det;
+  return glm::mat3(x * invDet, y * invDet, z * invDet);
+}
+
+bool AffineTransform::isCpuSupported()
+{
+#if defined(AFFINE_TRANSFORM_AVX) && defined(_MSC_VER)
+  // AVX, and the OS saving the ymm registers on context switches (OSXSAVE, then XCR0 bits 1 and 2)
+  int info[4];
+  __cpuid(info, 1);
+  bool hasAvx = (info[2] & (1 << 28)) != 0;
+  bool hasXsave = (info[2] & (1 << 27)) != 0;
+  return hasAvx && hasXsave && (_xgetbv(0) & 6) == 6;
+#elif defined(AFFINE_TRANSFORM_AVX)
+  return __builtin_cpu_supports("avx");
+#else
+  return true;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AFFINE_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+// the project builds with /arch:AVX, which defines __AVX__. main checks the CPU with isCpuSupported before anything runs
+#if defined(AFFINE_TRANSFORM_SSE) && defined(__AVX__)
+#define AFFINE_TRANSFORM_AVX
+#include <immintrin.h>
+#endif
+
+// An affine transform stored as the top 3 rows of a 4x4 matrix - the last row is always (0, 0, 0, 1).
+// Each row is 16 byte aligned, so composing two transforms is a handful of SSE multiply-adds
+// instead of a full 4x4 matrix product.
+// Every kernel uses plain multiplies and adds in the same order (no FMA), so the SSE, AVX and
+// scalar paths give the same results bit for bit.
+struct alignas(16) AffineTransform
+{
+  // row r is (m[0][r], m[1][r], m[2][r], m[3][r]) of the equivalent glm::mat4
+  glm::vec4 rows[3];
+
+  AffineTransform();
+  explicit AffineTransform(const glm::mat4& m);
+
+  // T * R * S
+  static AffineTransform fromTRS(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+  glm::mat4 toMat4() const;
+  glm::vec3 getTranslation() const { return glm::vec3(rows[0].w, rows[1].w, rows[2].w); }
+
+  // this * other
+  AffineTransform operator*(const AffineTransform& other) const;
+
+  // lhs * rhs, for going from an affine transform into e.g. projection-view space
+  static glm::mat4 multiply(const glm::mat4& lhs, const AffineTransform& rhs);
+
+  // out[i] = lhs[i] * rhs[i]. out may alias either input
+  static void composeBatch(const AffineTransform* lhs, const AffineTransform* rhs, AffineTransform* out, int count);
+
+  // out[i] = lhs * rhs[i]. out may alias rhs
+  static void composeBatch(const AffineTransform& lhs, const AffineTransform* rhs, AffineTransform* out, int count);
+
+  // true if the linear part is a rotation times a uniform scale, within a relative epsilon
+  bool hasUniformScale(float epsilon = 1e-4f) const;
+
+  // true if the linear part flips handedness (negative determinant), which turns the winding of triangles around
+  bool isMirrored() const;
+
+  // inverse transpose of the upper 3x3, for transforming normals.
+  // With a uniform scale this is just the 3x3 divided by the squared scale; otherwise it's
+  // the cofactor matrix over the determinant. Neither goes through a general inverse
+  glm::mat3 normalMatrix() const;
+
+  // true if the CPU has every instruction set the kernels were compiled for
+  static bool isCpuSupported();
+};
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include "Bounds.h"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+// AABB implementation
+AABB::AABB()
+  : min(FLT_MAX), max(-FLT_MAX)
+{}
+
+AABB::AABB(const glm::vec3& min, const glm::vec3& max)
+  : min(min), max(max)
+{}
+
+float AABB::getSurfaceArea() const
+{
+  if (isEmpty()) return 0.f;
+
+  glm::vec3 d = max - min;
+  return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+void AABB::expand(const glm::vec3& point)
+{
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void AABB::expand(const AABB& other)
+{
+  min = glm::min(min, other.min);
+  max = glm::max(max, other.max);
+}
+
+AABB AABB::grown(float margin) const
+{
+  return AABB(min - glm::vec3(margin), max + glm::vec3(margin));
+}
+
+bool AABB::contains(const AABB& other) const
+{
+  return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+    && max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+}
+
+bool AABB::intersects(const AABB& other) const
+{
+  return min.x <= other.max.x && max.x >= other.min.x
+    && min.y <= other.max.y && max.y >= other.min.y
+    && min.z <= other.max.z && max.z >= other.min.z;
+}
+
+AABB AABB::transformed(const AffineTransform& transform) const
+{
+  if (isEmpty()) return AABB();
+
+  // transform the center, and project the extents onto each axis with the absolute matrix
+  glm::vec3 center = getCenter();
+  glm::vec3 extents = getExtents();
+
+  glm::vec3 newCenter, newExtents;
+  for (int r = 0; r < 3; r++)
+  {
+    const glm::vec4& row = transform.rows[r];
+    newCenter[r] = row.x * center.x + row.y * center.y + row.z * center.z + row.w;
+    newExtents[r] = std::abs(row.x) * extents.x + std::abs(row.y) * extents.y + std::abs(row.z) * extents.z;
+  }
+
+  return AABB(newCenter - newExtents, newCenter + newExtents);
+}
+
+AABB AABB::merge(const AABB& a, const AABB& b)
+{
+  return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+// BoundingSphere implementation
+bool BoundingSphere::intersects(const AABB& box) const
+{
+  glm::vec3 closest = glm::clamp(center, box.min, box.max);
+  glm::vec3 d = closest - center;
+  return glm::dot(d, d) <= radius * radius;
+}
+
+BoundingSphere BoundingSphere::transformed(const AffineTransform& transform) const
+{
+  BoundingSphere ret;
+  if (isEmpty()) return ret;
+
+  glm::vec3 c0(transform.rows[0].x, transform.rows[1].x, transform.rows[2].x);
+  glm::vec3 c1(transform.rows[0].y, transform.rows[1].y, transform.rows[2].y);
+  glm::vec3 c2(transform.rows[0].z, transform.rows[1].z, transform.rows[2].z);
+  float maxScaleSq = std::max(glm::dot(c0, c0), std::max(glm::dot(c1, c1), glm::dot(c2, c2)));
+
+  for (int r = 0; r < 3; r++)
+  {
+    const glm::vec4& row = transform.rows[r];
+    ret.center[r] = row.x * center.x + row.y * center.y + row.z * center.z + row.w;
+  }
+  ret.radius = radius * std::sqrt(maxScaleSq);
+  return ret;
+}
+
+BoundingSphere BoundingSphere::fromPoints(const std::vector<float>& xyz, const AABB& box)
+{
+  BoundingSphere ret;
+  if (box.isEmpty()) return ret;
+
+  ret.center = box.getCenter();
+  float maxDistSq = 0.f;
+  for (size_t i = 0; i + 2 < xyz.size(); i += 3)
+  {
+    glm::vec3 d = glm::vec3(xyz[i], xyz[i + 1], xyz[i + 2]) - ret.center;
+    maxDistSq = std::max(maxDistSq, glm::dot(d, d));
+  }
+  ret.radius = std::sqrt(maxDistSq);
+  return ret;
+}
+
+// Ray implementation
+Ray::Ray(const glm::vec3& origin, const glm::vec3& direction)
+  : origin(origin), direction(direction)
+{}
+
+bool Ray::intersects(const AABB& box, float maxDistance, float& tEnter) const
+{
+  float tMin = 0.f;
+  float tMax = maxDistance;
+
+  for (int a = 0; a < 3; a++)
+  {
+    if (std::abs(direction[a]) < 1e-12f)
+    {
+      // parallel to the slab: has to start inside it
+      if (origin[a] < box.min[a] || origin[a] > box.max[a]) return false;
+      continue;
+    }
+
+    float invD = 1.f / direction[a];
+    float t0 = (box.min[a] - origin[a]) * invD;
+    float t1 = (box.max[a] - origin[a]) * invD;
+    if (t0 > t1) std::swap(t0, t1);
+
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+    if (tMin > tMax) return false;
+  }
+
+  tEnter = tMin;
+  return true;
+}
+
+// Frustum implementation
+Frustum Frustum::fromMatrix(const glm::mat4& m)
+{
+  // Gribb & Hartmann: each plane is the 4th row of the matrix plus or minus one of the others
+  glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  Frustum f;
+  f.planes[0] = row3 + row0;
+  f.planes[1] = row3 - row0;
+  f.planes[2] = row3 + row1;
+  f.planes[3] = row3 - row1;
+  f.planes[4] = row3 + row2;
+  f.planes[5] = row3 - row2;
+
+  for (glm::vec4& plane : f.planes)
+  {
+    float len = glm::length(glm::vec3(plane));
+    if (len > 0.f) plane /= len;
+  }
+  return f;
+}
+
+Frustum::TestResult Frustum::test(const AABB& box) const
+{
+  glm::vec3 center = box.getCenter();
+  glm::vec3 extents = box.getExtents();
+
+  TestResult ret = TestResult::inside;
+  for (const glm::vec4& plane : planes)
+  {
+    // distance of the center, and how far the box reaches towards the plane
+    float d = glm::dot(glm::vec3(plane), center) + plane.w;
+    float r = glm::dot(glm::abs(glm::vec3(plane)), extents);
+
+    if (d + r < 0.f) return TestResult::outside;
+    if (d - r < 0.f) ret = TestResult::intersecting;
+  }
+  return ret;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const
+{
+  for (const glm::vec4& plane : planes)
+  {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+  }
+  return true;
+}
+
+// AABBBatch implementation
+void AABBBatch::resize(int count)
+{
+  _mCount = count;
+  int padded = (count + 7) & ~7;
+
+  // padding (and anything not set yet) is an empty box, which is outside every plane
+  centerX.assign(padded, 0.f);
+  centerY.assign(padded, 0.f);
+  centerZ.assign(padded, 0.f);
+  extentX.assign(padded, -FLT_MAX);
+  extentY.assign(padded, -FLT_MAX);
+  extentZ.assign(padded, -FLT_MAX);
+}
+
+void AABBBatch::set(int idx, const AABB& box)
+{
+  if (box.isEmpty())
+  {
+    centerX[idx] = centerY[idx] = centerZ[idx] = 0.f;
+    extentX[idx] = extentY[idx] = extentZ[idx] = -FLT_MAX;
+    return;
+  }
+
+  glm::vec3 center = box.getCenter();
+  glm::vec3 extents = box.getExtents();
+  centerX[idx] = center.x;
+  centerY[idx] = center.y;
+  centerZ[idx] = center.z;
+  extentX[idx] = extents.x;
+  extentY[idx] = extents.y;
+  extentZ[idx] = extents.z;
+}
+
+int Frustum::cull(const AABBBatch& boxes, unsigned char* visible) const
+{
+  int count = boxes.size();
+  int numVisible = 0;
+  int i = 0;
+
+#if defined(AFFINE_TRANSFORM_AVX)
+  // each plane's normal, its absolute value and distance, broadcast across all lanes
+  __m256 px[6], py[6], pz[6], ax[6], ay[6], az[6], pw[6];
+  for (int p = 0; p < 6; p++)
+  {
+    px[p] = _mm256_set1_ps(planes[p].x);
+    py[p] = _mm256_set1_ps(planes[p].y);
+    pz[p] = _mm256_set1_ps(planes[p].z);
+    pw[p] = _mm256_set1_ps(planes[p].w);
+    ax[p] = _mm256_set1_ps(std::fabs(planes[p].x));
+    ay[p] = _mm256_set1_ps(std::fabs(planes[p].y));
+    az[p] = _mm256_set1_ps(std::fabs(planes[p].z));
+  }
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (; i < count; i += 8)
+  {
+    __m256 cx = _mm256_loadu_ps(&boxes.centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&boxes.centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+    __m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+    __m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+    // a lane is out as soon as the whole box is behind any one plane
+    __m256 outside = zero;
+    for (int p = 0; p < 6; p++)
+    {
+      __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], cx), _mm256_mul_ps(py[p], cy)), _mm256_mul_ps(pz[p], cz)), pw[p]);
+      __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+    }
+
+    int mask = _mm256_movemask_ps(outside);
+    int lanes = std::min(8, count - i);
+    for (int k = 0; k < lanes; k++)
+    {
+      visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+      numVisible += visible[i + k];
+    }
+  }
+#elif defined(AFFINE_TRANSFORM_SSE)
+  __m128 px[6], py[6], pz[6], ax[6], ay[6], az[6], pw[6];
+  for (int p = 0; p < 6; p++)
+  {
+    px[p] = _mm_set1_ps(planes[p].x);
+    py[p] = _mm_set1_ps(planes[p].y);
+    pz[p] = _mm_set1_ps(planes[p].z);
+    pw[p] = _mm_set1_ps(planes[p].w);
+    ax[p] = _mm_set1_ps(std::fabs(planes[p].x));
+    ay[p] = _mm_set1_ps(std::fabs(planes[p].y));
+    az[p] = _mm_set1_ps(std::fabs(planes[p].z));
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  for (; i < count; i += 4)
+  {
+    __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+    __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+    __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+    __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+    __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+    __m128 outside = zero;
+    for (int p = 0; p < 6; p++)
+    {
+      __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)), _mm_mul_ps(pz[p], cz)), pw[p]);
+      __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+    }
+
+    int mask = _mm_movemask_ps(outside);
+    int lanes = std::min(4, count - i);
+    for (int k = 0; k < lanes; k++)
+    {
+      visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+      numVisible += visible[i + k];
+    }
+  }
+#else
+  for (; i < count; i++)
+  {
+    bool outside = false;
+    for (const glm::vec4& plane : planes)
+    {
+      float d = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w;
+      float r = std::fabs(plane.x) * boxes.extentX[i] + std::fabs(plane.y) * boxes.extentY[i] + std::fabs(plane.z) * boxes.extentZ[i];
+      if (d + r < 0.f)
+      {
+        outside = true;
+        break;
+      }
+    }
+    visible[i] = outside ? 0 : 1;
+    numVisible += visible[i];
+  }
+#endif
+
+  return numVisible;
+}
\ No newline at end of file
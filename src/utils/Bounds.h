@@ -0,0 +1,93 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "AffineTransform.h"
+
+// axis aligned bounding box. Starts out empty (min > max) until something is added
+struct AABB
+{
+  glm::vec3 min;
+  glm::vec3 max;
+
+  AABB();
+  AABB(const glm::vec3& min, const glm::vec3& max);
+
+  bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+  glm::vec3 getCenter() const { return (min + max) * .5f; }
+  glm::vec3 getExtents() const { return (max - min) * .5f; }
+  float getSurfaceArea() const;
+
+  void expand(const glm::vec3& point);
+  void expand(const AABB& other);
+  AABB grown(float margin) const;
+
+  bool contains(const AABB& other) const;
+  bool intersects(const AABB& other) const;
+
+  // bounds of this box after being transformed (still axis aligned, so it may grow)
+  AABB transformed(const AffineTransform& transform) const;
+
+  static AABB merge(const AABB& a, const AABB& b);
+};
+
+struct BoundingSphere
+{
+  glm::vec3 center = glm::vec3(0);
+  float radius = -1.f;
+
+  bool isEmpty() const { return radius < 0; }
+  bool intersects(const AABB& box) const;
+
+  // scaled by the largest axis scale of the transform
+  BoundingSphere transformed(const AffineTransform& transform) const;
+
+  // a sphere around the box's center, just big enough for the given points
+  static BoundingSphere fromPoints(const std::vector<float>& xyz, const AABB& box);
+};
+
+struct Ray
+{
+  glm::vec3 origin;
+  glm::vec3 direction;
+
+  Ray(const glm::vec3& origin, const glm::vec3& direction);
+
+  // slab test. On a hit, tEnter is the distance along the ray (in direction lengths) where it enters the box
+  bool intersects(const AABB& box, float maxDistance, float& tEnter) const;
+};
+
+// many boxes as centers and extents, one array per axis, so they can be tested several at a time.
+// The arrays are padded to a multiple of 8 with empty boxes, so SIMD loops never need a scalar tail
+struct AABBBatch
+{
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  int size() const { return _mCount; }
+  int paddedSize() const { return (int)centerX.size(); }
+
+  void resize(int count);
+  void set(int idx, const AABB& box);
+
+private:
+  int _mCount = 0;
+};
+
+// six planes (left, right, bottom, top, near, far) pointing inwards, as (normal, distance)
+struct Frustum
+{
+  glm::vec4 planes[6];
+
+  // extract the planes from a projection * view matrix
+  static Frustum fromMatrix(const glm::mat4& projView);
+
+  enum class TestResult { outside, intersecting, inside };
+
+  TestResult test(const AABB& box) const;
+  bool intersects(const AABB& box) const { return test(box) != TestResult::outside; }
+  bool intersects(const BoundingSphere& sphere) const;
+
+  // same test as intersects(AABB), 8 boxes at a time with AVX (the project's build) or 4 with SSE only.
+  // visible[i] is set to 1 or 0 for each box, and the number of visible boxes is returned
+  int cull(const AABBBatch& boxes, unsigned char* visible) const;
+};
\ No newline at end of file
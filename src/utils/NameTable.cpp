@@ -0,0 +1,47 @@
+#include "NameTable.h"
+#include <deque>
+
+const int NameTable::NONE;
+
+// function statics, so names can be interned during static initialization too
+static std::unordered_map<std::string, int>& _ids()
+{
+  static std::unordered_map<std::string, int> ids;
+  return ids;
+}
+
+// a deque, so references returned by getName stay valid as the table grows
+static std::deque<std::string>& _names()
+{
+  static std::deque<std::string> names;
+  return names;
+}
+
+int NameTable::intern(const std::string& name)
+{
+  if (name.empty()) return NONE;
+
+  auto it = _ids().find(name);
+  if (it != _ids().end()) return it->second;
+
+  int id = int(_names().size());
+  _names().push_back(name);
+  _ids()[name] = id;
+  return id;
+}
+
+int NameTable::find(const std::string& name)
+{
+  if (name.empty()) return NONE;
+
+  auto it = _ids().find(name);
+  if (it == _ids().end()) return NONE;
+  return it->second;
+}
+
+const std::string& NameTable::getName(int id)
+{
+  static const std::string empty;
+  if (id < 0 || id >= int(_names().size())) return empty;
+  return _names()[id];
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Interns strings into small integer ids, so names can be stored, hashed and compared as ints.
+// Ids are never released; there's one table for the whole program
+class NameTable
+{
+public:
+  // id of the empty name
+  static const int NONE = -1;
+
+  // id for name, adding it to the table if it isn't there yet
+  static int intern(const std::string& name);
+
+  // id for name, or NONE if it was never interned. Never allocates
+  static int find(const std::string& name);
+
+  // the string behind an id - empty for NONE
+  static const std::string& getName(int id);
+};
\ No newline at end of file
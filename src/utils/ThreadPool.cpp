@@ -0,0 +1,87 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+  : _mNextBegin(0)
+{
+  if (numThreads == 0)
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned int i = 1; i < numThreads; i++)
+  {
+    _mWorkers.emplace_back(&ThreadPool::_workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mIsStopping = true;
+  }
+  _mWorkReady.notify_all();
+
+  for (auto& worker : _mWorkers)
+    worker.join();
+}
+
+void ThreadPool::_runChunks()
+{
+  while (true)
+  {
+    int begin = _mNextBegin.fetch_add(_mGrainSize);
+    if (begin >= _mTaskCount) break;
+
+    int end = std::min(begin + _mGrainSize, _mTaskCount);
+    (*_mTask)(begin, end);
+  }
+}
+
+void ThreadPool::_workerLoop()
+{
+  unsigned int seenGeneration = 0;
+  std::unique_lock<std::mutex> lock(_mMutex);
+
+  while (true)
+  {
+    _mWorkReady.wait(lock, [&]() { return _mIsStopping || _mGeneration != seenGeneration; });
+    if (_mIsStopping) return;
+    seenGeneration = _mGeneration;
+
+    lock.unlock();
+    _runChunks();
+    lock.lock();
+
+    if (--_mBusyWorkers == 0)
+      _mWorkDone.notify_one();
+  }
+}
+
+void ThreadPool::parallelFor(int count, int grainSize, const std::function<void(int, int)>& task)
+{
+  if (count <= 0) return;
+
+  grainSize = std::max(1, grainSize);
+  if (_mWorkers.empty() || count <= grainSize)
+  {
+    task(0, count);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mTask = &task;
+    _mTaskCount = count;
+    _mGrainSize = grainSize;
+    _mNextBegin = 0;
+    _mBusyWorkers = _mWorkers.size();
+    _mGeneration++;
+  }
+  _mWorkReady.notify_all();
+
+  _runChunks();
+
+  std::unique_lock<std::mutex> lock(_mMutex);
+  _mWorkDone.wait(lock, [&]() { return _mBusyWorkers == 0; });
+  _mTask = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+// A fixed set of worker threads for splitting loops across cores.
+// The calling thread works too, so a pool of N threads runs N-1 workers.
+// Only one parallelFor should run at a time.
+class ThreadPool
+{
+private:
+  std::vector<std::thread> _mWorkers;
+  std::mutex _mMutex;
+  std::condition_variable _mWorkReady;
+  std::condition_variable _mWorkDone;
+
+  // current job
+  const std::function<void(int, int)>* _mTask = nullptr;
+  int _mTaskCount = 0;
+  int _mGrainSize = 1;
+  std::atomic<int> _mNextBegin;
+  int _mBusyWorkers = 0;
+
+  // bumped for every job, so workers know there is new work
+  unsigned int _mGeneration = 0;
+  bool _mIsStopping = false;
+
+  void _workerLoop();
+  void _runChunks();
+
+public:
+  // numThreads includes the calling thread; 0 uses every hardware thread
+  ThreadPool(unsigned int numThreads = 0);
+  ThreadPool(const ThreadPool& other) = delete;
+  virtual ~ThreadPool();
+
+  // number of threads that run a parallelFor, including the caller
+  unsigned int getNumThreads() const { return _mWorkers.size() + 1; }
+
+  // calls task(begin, end) over [0, count) in chunks of grainSize, and waits for all of them.
+  // Runs inline if there are no workers or the loop fits in one chunk
+  void parallelFor(int count, int grainSize, const std::function<void(int, int)>& task);
+};
\ No newline at end of file